@@ -1,3 +1,4 @@
+#define LOG_SYS LOG_SYS_VRS
 #include "GenVRSObs.h"
 #include <math.h>
 #include <string.h>
@@ -7,6 +8,7 @@
 #include "ephemeris.h"
 #include "model.h"
 #include "tides.h"
+#include "log.h"
 
 #ifdef ARM_MCU
 #pragma GCC diagnostic ignored "-Wunused-but-set-variable"
@@ -23,6 +25,35 @@
 #define RE             6378.0           /* km */
 #define HION           450.0            /* km */
 #define VTEC_INTP_MOD  4
+
+typedef struct {                        /* hpac polynomials of the satellites at a rover */
+    double val[SSR_NUM][2];             /* {stec,trop} polynomial values of ssr[i] */
+    int area[SSR_NUM];                  /* area (gad index) of ssr[i] (-1: none) */
+} hpac_poly_t;
+
+/* vrs signals per system, bias slot follows the spartn signal order ---------*/
+typedef struct {
+    int sys;                            /* navigation system */
+    unsigned char code[NFREQ];          /* obs code of vrs signals */
+    int bias[NFREQ];                    /* spartn code/phase bias slot */
+} vrs_sig_t;
+
+static const vrs_sig_t vrs_sig[] = {
+    { _SYS_GPS_, { CODE_L1C, CODE_L2W }, { 0, 1 } },   /* L1C, L2W */
+    { _SYS_GLO_, { CODE_L1C, CODE_L2C }, { 0, 1 } },   /* L1C, L2C */
+    { _SYS_GAL_, { CODE_L1C, CODE_L7Q }, { 0, 2 } },   /* E1C, E5bQ */
+    { _SYS_BDS_, { CODE_L1I, CODE_L7I }, { 0, 2 } }    /* B1I, B2I */
+};
+
+static const vrs_sig_t *get_vrs_sig(int sys)
+{
+    int i;
+    for (i = 0; i < (int)(sizeof(vrs_sig) / sizeof(vrs_sig[0])); i++)
+    {
+        if (vrs_sig[i].sys == sys) return vrs_sig + i;
+    }
+    return NULL;
+}
 /*****************************************************************************
 * From GLAB
 * Name        : gravitationalDelayCorrection
@@ -157,29 +188,147 @@ void dist_inv_unit_weighting(double *blh, double *gpt_bl, double *wdi)
 }
 
 
-void high_prcision_slant_atm_polynomial(gtime_t time, double *blh, int sat, sap_ssr_t *ssr, gad_ssr_t *gad, double *azel, int *gpt_idx, double *stec, double *stro)
+/* area polynomial kernel ------------------------------------------------------
+* evaluate c00 + c01*dlat + c10*dlon + c11*dlat*dlon for n coefficient sets
+* args   : double *coef     I   coefficient sets {c00,c01,c10,c11}, stride 4
+*          int    n         I   number of sets
+*          double dlat,dlon I   rover offset from the area centre (deg)
+*          double *val      O   polynomial values
+*-----------------------------------------------------------------------------*/
+static void hpac_poly_eval(const double *coef, int n, double dlat, double dlon, double *val)
+{
+    const double x[4] = { 1.0, dlat, dlon, dlat*dlon };
+    int i;
+    for (i = 0; i < n; i++, coef += 4)
+    {
+        val[i] = coef[0] * x[0] + coef[1] * x[1] + coef[2] * x[2] + coef[3] * x[3];
+    }
+}
+
+/* residual grid of an area, NULL: none ------------------------------------*/
+static const hpac_grid_t *hpac_area_grid(const hpac_grid_t *grid, int areaId)
+{
+    int i;
+    for (i = 0; i < HPAC_MAX_ARAE; i++)
+    {
+        if (grid[i].areaId == areaId) return &grid[i];
+    }
+    return NULL;
+}
+
+/* bilinear weights in the area residual grid -------------------------------
+* args   : gad_ssr_t *gad   I   area definition
+*          hpac_grid_t *grid I  residual grid of the area
+*          double *blh      I   rover position {lat,lon,h} (rad,m)
+*          int    *idx      O   grid points of the cell, k*nc_lon+l
+*          double *w        O   weights of the points
+* return : 1: grid of the area, 0: no grid or grid not matching the area nodes
+*-----------------------------------------------------------------------------*/
+static int hpac_grid_bilinear(const gad_ssr_t *gad, const hpac_grid_t *grid, const double *blh, int *idx, double *w)
+{
+    int k, l;
+    double y, x;
+    if (!grid || grid->npt <= 0 || grid->npt != gad->nc_lat*gad->nc_lon) return 0;
+    if (gad->spa_lat <= 0.0 || gad->spa_lon <= 0.0) return 0;
+
+    y = (gad->rap_lat - blh[0] * R2D) / gad->spa_lat;
+    x = (blh[1] * R2D - gad->rap_lon) / gad->spa_lon;
+    k = gad->nc_lat > 1 ? (int)floor(y) : 0;
+    l = gad->nc_lon > 1 ? (int)floor(x) : 0;
+    if (k > gad->nc_lat - 2) k = gad->nc_lat > 1 ? gad->nc_lat - 2 : 0;
+    if (l > gad->nc_lon - 2) l = gad->nc_lon > 1 ? gad->nc_lon - 2 : 0;
+    if (k < 0) k = 0;
+    if (l < 0) l = 0;
+    y = gad->nc_lat > 1 ? y - k : 0.0;
+    x = gad->nc_lon > 1 ? x - l : 0.0;
+    if (y < 0.0) y = 0.0; else if (y > 1.0) y = 1.0;
+    if (x < 0.0) x = 0.0; else if (x > 1.0) x = 1.0;
+
+    idx[0] = k * gad->nc_lon + l;
+    idx[1] = gad->nc_lon > 1 ? idx[0] + 1 : idx[0];
+    idx[2] = gad->nc_lat > 1 ? idx[0] + gad->nc_lon : idx[0];
+    idx[3] = gad->nc_lat > 1 ? idx[1] + gad->nc_lon : idx[1];
+    w[0] = (1.0 - y)*(1.0 - x);
+    w[1] = (1.0 - y)*x;
+    w[2] = y * (1.0 - x);
+    w[3] = y * x;
+    return 1;
+}
+
+/* area polynomials of all satellites at a rover ------------------------------
+* args   : sap_ssr_t *ssr   I   ssr corrections
+*          gad_ssr_t *gad   I   area definitions
+*          double *blh      I   rover position {lat,lon,h} (rad,m)
+*          hpac_poly_t *poly O  polynomial values and areas of the satellites
+* return : none
+* notes  : a satellite takes the first area of its list containing the rover,
+*          as find_nearest_gridpoints_ionocoef() selects it. the coefficient
+*          sets of the satellites of an area are evaluated in one
+*          hpac_poly_eval() call.
+*-----------------------------------------------------------------------------*/
+static void hpac_poly_area(const sap_ssr_t *ssr, const gad_ssr_t *gad, const double *blh, hpac_poly_t *poly)
+{
+    double coef[SSR_NUM * 8], val[SSR_NUM * 2], acp_lat, acp_lon;
+    int i, j, k, n, idx[SSR_NUM];
+
+    for (i = 0; i < SSR_NUM; i++) poly->area[i] = -1;
+
+    for (j = 0; j < RAP_NUM; j++)
+    {
+        if (blh[0] * R2D > gad[j].rap_lat || blh[1] * R2D < gad[j].rap_lon) continue;
+        if (blh[0] * R2D < gad[j].rap_lat - gad[j].nc_lat * gad[j].spa_lat ||
+            blh[1] * R2D > gad[j].rap_lon + gad[j].nc_lon * gad[j].spa_lon) continue;
+
+        for (i = n = 0; i < SSR_NUM; i++)
+        {
+            if (ssr[i].sat == 0 || poly->area[i] >= 0) continue;
+            for (k = 0; k < RAP_NUM && ssr[i].areaId[k] != 0; k++)
+            {
+                if (ssr[i].areaId[k] == gad[j].areaId) break;
+            }
+            if (k >= RAP_NUM || ssr[i].areaId[k] == 0) continue;
+            memcpy(coef + n * 8, ssr[i].stec_coef + k * 4, sizeof(double) * 4);
+            memcpy(coef + n * 8 + 4, ssr[i].tro_coef + k * 4, sizeof(double) * 4);
+            poly->area[i] = j;
+            idx[n++] = i;
+        }
+        if (n == 0) continue;
+
+        acp_lat = gad[j].rap_lat - gad[j].spa_lat*gad[j].nc_lat / 2.0;
+        acp_lon = gad[j].rap_lon + gad[j].spa_lon*gad[j].nc_lon / 2.0;
+        hpac_poly_eval(coef, 2 * n, blh[0] * R2D - acp_lat, blh[1] * R2D - acp_lon, val);
+        for (k = 0; k < n; k++)
+        {
+            poly->val[idx[k]][0] = val[k * 2];
+            poly->val[idx[k]][1] = val[k * 2 + 1];
+        }
+    }
+}
+
+void high_prcision_slant_atm_polynomial(gtime_t time, double *blh, int sat, sap_ssr_t *ssr, gad_ssr_t *gad, const hpac_grid_t *hgrid, const hpac_poly_t *poly, double *azel, int *gpt_idx, double *stec, double *stro)
 {
     int i, j, satidx=-1;
     int areaId;
-    double icoef[12]  = { 0.0 };
-    double tcoef[12]  = { 0.0 };
     double gpt_bl[8]  = { 0.0 };
     int    gpt_pos[8] = { 0 };
-    double lon_sp = 0.0, lat_sp = 0.0, rap_lon=0.0, rap_lat=0.0,acp_lon=0.0, acp_lat=0.0;
+    double lon_sp = 0.0, lat_sp = 0.0, rap_lon=0.0, rap_lat=0.0;
     double Ip[4] = { 0.0 }, Tp[4] = { 0.0 };
     double ion = 0.0, trop = 0.0;
     double wdi[4] = { 0.0 };
     double m_h, m_w, Th = 0.0, Tw = 0.0;;
+    const hpac_grid_t *grid;
+    *stec = 0.0;
+    *stro = 0.0;
     /* find satid */
     for (i = 0; i < SSR_NUM; i++)
     {
-        int sap_sat = (ssr[i].sys == 0 ? ssr[i].prn : MAXPRNGPS + ssr[i].prn);
-        if (sap_sat == sat)
+        if (ssr[i].sat == sat)
         {
             satidx = i;
             break;
         }
     }
+    if (satidx < 0 || poly->area[satidx] != gpt_idx[0]) return;
     int aid = -1;
     areaId = gad[gpt_idx[0]].areaId;
     for (i = 0; i < RAP_NUM; i++)
@@ -200,8 +349,6 @@ void high_prcision_slant_atm_polynomial(gtime_t time, double *blh, int sat, sap_
     lon_sp  = gad[gpt_idx[0]].spa_lon;
     rap_lat = gad[gpt_idx[0]].rap_lat;
     rap_lon = gad[gpt_idx[0]].rap_lon;
-    acp_lat = gad[gpt_idx[0]].rap_lat - gad[gpt_idx[0]].spa_lat*gad[gpt_idx[0]].nc_lat/2.0;
-    acp_lon = gad[gpt_idx[0]].rap_lon + gad[gpt_idx[0]].spa_lon*gad[gpt_idx[0]].nc_lon/2.0;
 
     //if (gpt_idx[3] * gpt_idx[4] > 0)
     //{
@@ -249,22 +396,32 @@ void high_prcision_slant_atm_polynomial(gtime_t time, double *blh, int sat, sap_
 
     //dist_inv_unit_weighting(blh, gpt_bl, wdi);
 
-    icoef[0] = ssr[satidx].stec_coef[0 + aid * 3];
-    icoef[1] = ssr[satidx].stec_coef[1 + aid * 3];
-    icoef[2] = ssr[satidx].stec_coef[2 + aid * 3];
-    tcoef[0] = ssr[satidx].tro_coef[0 + aid * 3];
-    tcoef[1] = ssr[satidx].tro_coef[1 + aid * 3];
-    tcoef[2] = ssr[satidx].tro_coef[2 + aid * 3];
-
-    //printf("atmcor: sat=%3i,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", sat, icoef[0], icoef[1], icoef[2], tcoef[0], tcoef[1], tcoef[2]);
-    *stec = 0.0;
+    /* polynomials of the area, evaluated for all satellites by hpac_poly_area() */
+    *stec = poly->val[satidx][0];
     *stro = 0.0;
+    trop  = poly->val[satidx][1];
 
-    *stec = icoef[0] + icoef[1] * (blh[0] * R2D - acp_lat) + icoef[2] * (blh[1] * R2D - acp_lon);
-    trop  = tcoef[0] + tcoef[1] * (blh[0] * R2D - acp_lat) + tcoef[2] * (blh[1] * R2D - acp_lon);
+    /* gridded residuals (SF040 == 2), the ionosphere row must be of the same epoch as the polynomial */
+    grid = hpac_area_grid(hgrid, areaId);
+    if (hpac_grid_bilinear(&gad[gpt_idx[0]], grid, blh, gpt_pos, wdi))
+    {
+        if (grid->tro_time > 0.0)
+        {
+            for (i = 0; i < 4; i++) trop += 0.004 * wdi[i] * grid->tro[gpt_pos[i]];
+        }
+        for (j = 0; j < grid->nsat; j++)
+        {
+            if (grid->sat[j] != sat) continue;
+            if (fabs(grid->time[j] - ssr[satidx].t0[5]) < 0.5)
+            {
+                for (i = 0; i < 4; i++) *stec += 0.04 * wdi[i] * grid->ion[j * grid->npt + gpt_pos[i]];
+            }
+            break;
+        }
+    }
     //printf("atmcor: sat=%3i,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", sat, Ip[i], Tp[i], wdi[i], gpt_bl[i * 2], blh[0] * R2D, gpt_bl[i * 2 + 1], blh[1] * R2D, acp_lat, acp_lon);
 
-    Th = ssr[satidx].ave_htd;
+    Th = ssr[satidx].ave_htd[aid];
     m_h=tropmapf(time, blh, azel, &m_w);
     //*stro = m_h*Th + m_w * Tw;
     *stro = m_h * Th + m_w * trop;
@@ -347,7 +504,7 @@ void compute_low_precision_ion_corr(int sat, obs_t *obs_vrs, vtec_t *vtec, doubl
     int    grid_id[8] = { 0 };
     double dist_deg = 0.0, min_dist=1.0e4;
     sys = satsys(sat, &prn);
-    if (fLOG) fprintf(fLOG, "ionpp:%c%02d,%6.2f,%6.2f,%6.2f,%6.2f\n", sys2char(sys), prn, lat_pp, lon_pp, blh[0] * R2D, blh[1] * R2D);
+    log_file(fLOG, "ionpp:%c%02d,%6.2f,%6.2f,%6.2f,%6.2f\n", sys2char(sys), prn, lat_pp, lon_pp, blh[0] * R2D, blh[1] * R2D);
     for (i = 0; i < AREA_NUM; i++)
     {
         if (lat_pp < vtec[i].rap_lat) continue;
@@ -425,21 +582,22 @@ void compute_low_precision_ion_corr(int sat, obs_t *obs_vrs, vtec_t *vtec, doubl
     {
         vtec_grid += w[i] * (vtec[loc].residual[grid_id[i * 2] * vtec[loc].nc_lon + grid_id[i * 2 + 1]] + vtec[loc].avg_vtec);
         wgt_grid  += w[i];
-        if (fLOG) fprintf(fLOG, "grid:%6.3f,%6.3f,%6.3f,%6.3f,%6.3f\n", grid_pt[i * 2], grid_pt[i * 2 + 1], vtec[loc].avg_vtec, vtec[loc].residual[grid_id[i * 2] * vtec[loc].nc_lon + grid_id[i * 2 + 1]], w[i]);
+        log_file(fLOG, "grid:%6.3f,%6.3f,%6.3f,%6.3f,%6.3f\n", grid_pt[i * 2], grid_pt[i * 2 + 1], vtec[loc].avg_vtec, vtec[loc].residual[grid_id[i * 2] * vtec[loc].nc_lon + grid_id[i * 2 + 1]], w[i]);
     } 
     *stec = mf*(vtec_grid/ wgt_grid);
 }
 
-void compute_high_precision_atm_corr(int sat, obs_t *obs_vrs, sap_ssr_t *ssr, gad_ssr_t *gad, double *azel, double maskElev, double *stec, double *stro)
+void compute_high_precision_atm_corr(int sat, obs_t *obs_vrs, sap_ssr_t *ssr, gad_ssr_t *gad, const hpac_grid_t *grid, const hpac_poly_t *poly, double *azel, double maskElev, double *stec, double *stro)
 {
     int i,j;
     double blh[3] = { 0 };
     int gpt_idx[5] = { 0 };
+    *stec = 0.0;
+    *stro = 0.0;
     ecef2pos(obs_vrs->pos, blh);
     int loc = -1;
     for (i = 0; i < SSR_NUM; i++)
     {
-        ssr[i].sat = ssr[i].prn + ssr[i].sys * 40;
         if (ssr[i].sat == sat)
         {
             loc = i;
@@ -449,6 +607,7 @@ void compute_high_precision_atm_corr(int sat, obs_t *obs_vrs, sap_ssr_t *ssr, ga
     if (loc == -1) return;
 
     find_nearest_gridpoints_ionocoef(blh, sat, gad, ssr[loc].areaId, gpt_idx);
+    if (gpt_idx[0] < 0) return;
 
     //printf("gad: sat=%3i,%3i,", sat, gad[gpt_idx[0]].areaId);
     int nlat = gpt_idx[1];
@@ -460,12 +619,12 @@ void compute_high_precision_atm_corr(int sat, obs_t *obs_vrs, sap_ssr_t *ssr, ga
     //printf("%6.2f, %6.2f,", arp_lat,                                        arp_lon + gpt_idx[4] * gad[gpt_idx[0]].spa_lon);
     //printf("%6.2f, %6.2f\n",arp_lat + gpt_idx[3] * gad[gpt_idx[0]].spa_lat, arp_lon + gpt_idx[4] * gad[gpt_idx[0]].spa_lon);
     
-    high_prcision_slant_atm_polynomial(obs_vrs->time, blh, sat, ssr, gad, azel, gpt_idx, stec, stro);
+    high_prcision_slant_atm_polynomial(obs_vrs->time, blh, sat, ssr, gad, grid, poly, azel, gpt_idx, stec, stro);
 
 }
 
 
-extern int gen_vobs_from_ssr(obs_t *obs_rov, sap_ssr_t *ssr, gad_ssr_t* gad, obs_t *obs_vrs, vec_t *vec_vrs, double maskElev)
+extern int gen_vobs_from_ssr(obs_t *obs_rov, astro_t *astro, sap_ssr_t *ssr, gad_ssr_t* gad, obs_t *obs_vrs, vec_t *vec_vrs, double maskElev)
 {
     int i,j,prn;
     double cbias[2] = { 0.0 }, pbias[2] = { 0.0 }, dr[3] = { 0.0 };
@@ -477,8 +636,9 @@ extern int gen_vobs_from_ssr(obs_t *obs_rov, sap_ssr_t *ssr, gad_ssr_t* gad, obs
     double grav_delay = 0.0;
     double soltide = 0.0;
 
-    /* earth tides correction */
-    tidedisp(obs_rov->time, &obs_rov->pos, 1, NULL, dr);
+    /* earth tides correction, the context also serves the wind-up below */
+    astro_update(astro, obs_rov->time);
+    tidedisp_astro(astro, obs_rov->pos, 1, NULL, dr);
 
     obs_vrs->time =  obs_rov->time;
     obs_vrs->n = obs_rov->n;
@@ -494,8 +654,8 @@ extern int gen_vobs_from_ssr(obs_t *obs_rov, sap_ssr_t *ssr, gad_ssr_t* gad, obs
        soltide = vec_vrs[i].e[0] * dr[0]+ vec_vrs[i].e[1] * dr[1]+ vec_vrs[i].e[2] * dr[2];
 
        /* phase windup model */
-       //model_phw(obs_rov->time, obs_rov->data[i].sat, NULL, 2, vec_vrs[i].rs, obs_vrs->pos, &phw);
-       model_phw_bnc(obs_rov->time, obs_rov->data[i].sat, NULL, 2, vec_vrs[i].rs, obs_vrs->pos, &phw);
+       //model_phw(astro, obs_rov->data[i].sat, NULL, 2, vec_vrs[i].rs, obs_vrs->pos, &phw);
+       model_phw_bnc(astro, obs_rov->data[i].sat, NULL, 2, vec_vrs[i].rs, obs_vrs->pos, &phw);
 
        /* gravitational delay correction */
        grav_delay = ShapiroCorrection(sys, obs_vrs->pos, vec_vrs[i].rs);
@@ -510,7 +670,6 @@ extern int gen_vobs_from_ssr(obs_t *obs_rov, sap_ssr_t *ssr, gad_ssr_t* gad, obs
        int loc = -1;
        for (j = 0; j < SSR_NUM; j++)
        {
-           ssr[j].sat = ssr[j].prn + ssr[j].sys * MAXPRNGPS;
            if (ssr[j].sat == obs_vrs->data[i].sat)
            {
                loc = j;
@@ -546,7 +705,7 @@ extern int gen_vobs_from_ssr(obs_t *obs_rov, sap_ssr_t *ssr, gad_ssr_t* gad, obs
     return 1;
 }
 
-extern int gen_obs_from_ssr(gtime_t time, double* rcvpos, sap_ssr_t *ssr, gad_ssr_t* gad, vtec_t *vtec, obs_t *obs_vrs, vec_t *vec_vrs, double maskElev, FILE *fLOG)
+extern int gen_obs_from_ssr(gtime_t time, double* rcvpos, astro_t *astro, sap_ssr_t *ssr, gad_ssr_t* gad, const hpac_grid_t *grid, vtec_t *vtec, obs_t *obs_vrs, vec_t *vec_vrs, double maskElev, FILE *fLOG)
 {
     obs_t obs_osr = { 0.0 };
     int i, j, prn;
@@ -559,13 +718,19 @@ extern int gen_obs_from_ssr(gtime_t time, double* rcvpos, sap_ssr_t *ssr, gad_ss
     double grav_delay = 0.0;
     double soltide = 0.0;
     double otload = 0.0;
+    int f1, f2;
+    const vrs_sig_t *sig;
+    double blh[3];
+    hpac_poly_t hpac;
 
-    /* earth tides correction */
-    tidedisp(time, rcvpos, 1, NULL, dr);
+    /* hpac area polynomials of all satellites */
+    ecef2pos(rcvpos, blh);
+    hpac_poly_area(ssr, gad, blh, &hpac);
 
-    //ComputeSolidEarthTideDisplacement(gpst2utc(time), rcvpos, dr);
+    /* earth tides and ocean loading correction, cached per rover */
+    tide_cache_disp(tide_cache_find(rcvpos), astro, time, rcvpos, dr, dotl);
 
-    tide_oload_trm(time, rcvpos, dotl);
+    //ComputeSolidEarthTideDisplacement(gpst2utc(time), rcvpos, dr);
 
     obs_vrs->time = time;
     int obstime = obs_vrs->time.time;
@@ -578,6 +743,9 @@ extern int gen_obs_from_ssr(gtime_t time, double* rcvpos, sap_ssr_t *ssr, gad_ss
         if (vec_vrs[i].azel[1]*R2D < maskElev) continue;
 
         int sys = satsys(vec_vrs[i].sat, &prn);
+        if (!(sig = get_vrs_sig(sys))) continue;
+        code2obs(sys, sig->code[0], &f1);
+        code2obs(sys, sig->code[1], &f2);
         obs_vrs->data[i].sat = vec_vrs[i].sat;
         obs_vrs->data[i].sys = sys;
         obs_vrs->data[i].prn = prn;
@@ -592,10 +760,10 @@ extern int gen_obs_from_ssr(gtime_t time, double* rcvpos, sap_ssr_t *ssr, gad_ss
         /* gravitational delay correction */
         grav_delay = ShapiroCorrection(sys, obs_vrs->pos, vec_vrs[i].rs);
 
-        tecu2m1 = tecu2meter(vec_vrs[i].sat, 0);
-        tecu2m2 = tecu2meter(vec_vrs[i].sat, 1);
+        tecu2m1 = tecu2meter(vec_vrs[i].sat, f1 - 1);
+        tecu2m2 = tecu2meter(vec_vrs[i].sat, f2 - 1);
         /* slant tropospheric and ionospheric delay from HPAC*/
-        compute_high_precision_atm_corr(vec_vrs[i].sat, obs_vrs, ssr, gad, &vec_vrs[i].azel, maskElev, &stec, &strop);
+        compute_high_precision_atm_corr(vec_vrs[i].sat, obs_vrs, ssr, gad, grid, &hpac, &vec_vrs[i].azel, maskElev, &stec, &strop);
         /* slant ionospheric delay from LPAC*/
         compute_low_precision_ion_corr(vec_vrs[i].sat, obs_vrs, vtec, &vec_vrs[i].azel, &stec_lpap, fLOG);
 
@@ -607,7 +775,6 @@ extern int gen_obs_from_ssr(gtime_t time, double* rcvpos, sap_ssr_t *ssr, gad_ss
         int loc = -1;
         for (j = 0; j < SSR_NUM; j++)
         {
-            ssr[j].sat = ssr[j].prn + ssr[j].sys * MAXPRNGPS;
             if (ssr[j].sat == vec_vrs[i].sat)
             {
                 loc = j;
@@ -616,17 +783,17 @@ extern int gen_obs_from_ssr(gtime_t time, double* rcvpos, sap_ssr_t *ssr, gad_ss
         }
         if (loc == -1) continue;
 
-        cbias[0] = ssr[loc].cbias[0];
-        cbias[1] = ssr[loc].cbias[1];
-        pbias[0] = ssr[loc].pbias[0];
-        pbias[1] = ssr[loc].pbias[1];
-        w1 = satwavelen(obs_vrs->data[i].sat, 0);
-        w2 = satwavelen(obs_vrs->data[i].sat, 1);
+        cbias[0] = ssr[loc].cbias[sig->bias[0]];
+        cbias[1] = ssr[loc].cbias[sig->bias[1]];
+        pbias[0] = ssr[loc].pbias[sig->bias[0]];
+        pbias[1] = ssr[loc].pbias[sig->bias[1]];
+        w1 = satwavelen(obs_vrs->data[i].sat, f1 - 1);
+        w2 = satwavelen(obs_vrs->data[i].sat, f2 - 1);
         obs_vrs->data[i].time    = time;
         obs_vrs->data[i].LLI[0]  = 0;
         obs_vrs->data[i].LLI[1]  = 0;
-        obs_vrs->data[i].code[0] = CODE_L1C;
-        obs_vrs->data[i].code[1] = CODE_L2C;
+        obs_vrs->data[i].code[0] = sig->code[0];
+        obs_vrs->data[i].code[1] = sig->code[1];
         obs_vrs->data[i].SNR[0]  = 140;
         obs_vrs->data[i].SNR[1]  = 140;
         obs_vrs->data[i].P[0]    =  vec_vrs[i].r - CLIGHT * vec_vrs[i].dts[0] + strop + tecu2m1 * stec  + cbias[0];          // -grav_delay
@@ -646,19 +813,19 @@ extern int gen_obs_from_ssr(gtime_t time, double* rcvpos, sap_ssr_t *ssr, gad_ss
     double ep[6];
     int sys;
     time2epoch(obs_vrs->time, ep);
-    if(fLOG)fprintf(fLOG, "%4.0f %2.0f %2.0f %2.0f %2.0f %4.1f %3i", ep[0], ep[1], ep[2], ep[3], ep[4], ep[5],nobs);
+    log_file(fLOG, "%4.0f %2.0f %2.0f %2.0f %2.0f %4.1f %3i", ep[0], ep[1], ep[2], ep[3], ep[4], ep[5],nobs);
 
     for (i = 0; i < obs_vrs->n; i++)
     {
         if (obs_vrs->data[i].P[0] == 0 || obs_vrs->data[i].P[1] == 0 || obs_vrs->data[i].L[0] == 0 || obs_vrs->data[i].L[1] == 0)   continue;
         sys = satsys(obs_vrs->data[i].sat, &prn);
-		if (fLOG)fprintf(fLOG, "%c%02d", sys2char(sys), prn);
+		log_file(fLOG, "%c%02d", sys2char(sys), prn);
     }
-	if (fLOG)fprintf(fLOG, "\n");
+	log_file(fLOG, "\n");
     for (i = 0; i < obs_vrs->n; i++)
     {
         if (obs_vrs->data[i].P[0] == 0 || obs_vrs->data[i].P[1] == 0 || obs_vrs->data[i].L[0] == 0 || obs_vrs->data[i].L[1] == 0)   continue;
-		if (fLOG)fprintf(fLOG, "%14.4f,%14.4f,%14.4f,%14.4f\n", obs_vrs->data[i].P[0], obs_vrs->data[i].P[1], obs_vrs->data[i].L[0], obs_vrs->data[i].L[1]);
+		log_file(fLOG, "%14.4f,%14.4f,%14.4f,%14.4f\n", obs_vrs->data[i].P[0], obs_vrs->data[i].P[1], obs_vrs->data[i].L[0], obs_vrs->data[i].L[1]);
     }
     return 1;
 }
@@ -712,17 +879,65 @@ extern int get_match_epoch(obs_t *obs_ref, obs_t *obs_rov, vec_t *vec_ref, vec_t
 }
 
 
-int gen_rtcm_vrsdata(obs_t* obs, rtcm_t* rtcm, unsigned char* buff)
+/* initialize bounded rtcm output ---------------------------------------------
+* args   : vrs_out_t *out   O   rtcm output
+*          unsigned char *buff I output buffer (NULL: count bytes only)
+*          size_t size      I   size of buff (bytes)
+*          vrs_iov_t *iov   I   message list (NULL: no list)
+*          int    maxiov    I   size of iov
+*-----------------------------------------------------------------------------*/
+void vrs_out_init(vrs_out_t *out, unsigned char *buff, size_t size, vrs_iov_t *iov, int maxiov)
 {
-	/* write generated VRS data to file, in realtime system, will write to the user */
+	out->buff = buff;
+	out->size = buff ? size : (size_t)-1;
+	out->nbyte = 0;
+	out->iov = iov;
+	out->maxiov = iov ? maxiov : 0;
+	out->niov = 0;
+}
+
+/* append the encoded message of rtcm to out ----------------------------------*/
+static int vrs_out_put(vrs_out_t *out, const rtcm_t *rtcm)
+{
+	if (rtcm->nbyte > out->size - out->nbyte) return 0;
+	if (out->iov && out->niov >= out->maxiov) return 0;
+	if (out->buff) memcpy(out->buff + out->nbyte, rtcm->buff, rtcm->nbyte);
+	if (out->iov)
+	{
+		out->iov[out->niov].iov_base = out->buff ? out->buff + out->nbyte : NULL;
+		out->iov[out->niov].iov_len = rtcm->nbyte;
+		out->niov++;
+	}
+	out->nbyte += rtcm->nbyte;
+	return 1;
+}
 
+/* generate rtcm vrs epoch into bounded output ----------------------------------
+* encode 1005 and the msm4 of each system with satellites and append them to
+* out, one list entry per message. several rovers may be appended to the same
+* out and sent with a single writev(). the epoch is written whole or not at all.
+* the lock time and phase offset of the signals restart at every epoch, so the
+* output of an epoch does not depend on the epochs encoded before it
+* args   : obs_t  *obs      I   vrs observation
+*          rtcm_t *rtcm     IO  rtcm encoder, kept per rover for the msm layouts
+*          vrs_out_t *out   IO  rtcm output
+* return : bytes appended (0: no satellite, -1: out of buffer or list space)
+*-----------------------------------------------------------------------------*/
+int gen_rtcm_vrsout(obs_t* obs, rtcm_t* rtcm, vrs_out_t* out)
+{
 	rtcm->time = obs->time;
 	int satNUM[4] = { 0 }, ns = 0, type[4] = { 1074, 1084 , 1094, 1124 };
-	int size_write = 0, j = 0;
+	int j = 0, niov = out->niov;
+	size_t nbyte = out->nbyte;
 
 	for (j = 0; j < (int)obs->n; ++j)
 	{
 		int prn = 0;
+		if (obs->data[j].sat > 0 && obs->data[j].sat <= MAXSAT)
+		{
+			memset(rtcm->lltime[obs->data[j].sat - 1], 0, sizeof(rtcm->lltime[0]));
+			memset(rtcm->cp[obs->data[j].sat - 1], 0, sizeof(rtcm->cp[0]));
+		}
 		int sys = satsys(obs->data[j].sat, &prn);
 		if (sys == _SYS_GPS_) {
 			++satNUM[0]; ++ns;
@@ -739,30 +954,38 @@ int gen_rtcm_vrsdata(obs_t* obs, rtcm_t* rtcm, unsigned char* buff)
 	}
 	if (ns > 0)
 	{
-		if (gen_rtcm3(rtcm, obs, 1005, 0) > 0)
-		{
-			if (buff)memcpy(buff + size_write, rtcm->buff, rtcm->nbyte);
-			size_write += rtcm->nbyte;
-		}
+		if (gen_rtcm3(rtcm, obs, 1005, 0) > 0 && !vrs_out_put(out, rtcm)) goto overflow;
 
 		int lastSYS = 0;
-		for (j = 0; j < 2; ++j)
+		for (j = 0; j < 4; ++j)
 		{
 			if (satNUM[j] > 0)
 				lastSYS = j;
 		}
 
-		for (j = 0; j < 2; ++j)
+		for (j = 0; j < 4; ++j)
 		{
+			if (satNUM[j] == 0) continue;
 			int syn = lastSYS == j ? 0 : 1;
-			if (gen_rtcm3(rtcm, obs, type[j], syn) > 0)
-			{
-				if (buff)memcpy(buff + size_write, rtcm->buff, rtcm->nbyte);
-				size_write += rtcm->nbyte;
-			}
+			if (gen_rtcm3(rtcm, obs, type[j], syn) > 0 && !vrs_out_put(out, rtcm)) goto overflow;
 		}
 	}
-	return size_write;
+	return (int)(out->nbyte - nbyte);
+
+overflow:
+	slog(LOG_INFO, 0, "vrs: epoch of %d satellites does not fit, %d of %d bytes used", ns, (int)nbyte, (int)out->size);
+	out->nbyte = nbyte;
+	out->niov = niov;
+	return -1;
+}
+
+/* generate rtcm vrs epoch into buffer, 0 if it does not fit in size bytes ---*/
+int gen_rtcm_vrsdata(obs_t* obs, rtcm_t* rtcm, unsigned char* buff, int size)
+{
+	/* write generated VRS data to file, in realtime system, will write to the user */
+	vrs_out_t out;
+	vrs_out_init(&out, buff, (size_t)size, NULL, 0);
+	return gen_rtcm_vrsout(obs, rtcm, &out) < 0 ? 0 : (int)out.nbyte;
 }
 
 int read_obs_rtcm(FILE *fRTCM, gnss_rtcm_t *rtcm, int stnID)
@@ -792,17 +1015,194 @@ int read_obs_rtcm(FILE *fRTCM, gnss_rtcm_t *rtcm, int stnID)
 	return ret;
 }
 
-int sread_eph_rtcm(unsigned char* buffer, uint32_t len, gnss_rtcm_t *rtcm, uint32_t ns_gps, uint32_t ns_g)
+/* advance the vrs time to the epoch of a correction state --------------------
+* args   : gtime_t  *teph    IO  vrs time, first second after the orbit
+*                                correction time (within 20 s)
+*          sap_ssr_t *ssr    I   corrections of the state
+* return : none
+* notes  : depends on the previous vrs time and the corrections only, so the
+*          vrs time of every epoch is known without generating the vrs
+*-----------------------------------------------------------------------------*/
+void vrs_epoch_time(gtime_t *teph, const sap_ssr_t *ssr)
+{
+	while (1)
+	{
+		int time = teph->time;
+		double time1 = fmod((double)time, DAY_SECONDS);
+		if (time1 - ssr[0].t0[1] < 20.0 && time1>ssr[0].t0[1])
+			break;
+
+		*teph = timeadd(*teph, 1.0);
+	}
+}
+/* generate and output the vrs epoch of a decoded correction state -------------
+* args   : gtime_t  *teph    IO  vrs time, advanced to the correction epoch
+*          double   *rovpos  I   station position (ecef)
+*          astro_t  *astro   IO  astronomical context of the epoch loop
+*          rtcm_t   *rtcm    IO  rtcm encoder of the epoch loop, keeps the msm
+*                                layouts between the epochs
+*          nav_t    *nav     I   ephemerides matching the corrections
+*          spartn_t *spartn  I   decoded correction state
+*          int       ns      I   satellites with corrections (sum of nav->nsys)
+*          FILE     *fRTCM   O   rtcm output
+*          FILE     *fLOG    O   correction log
+* return : 1: vrs output, 0: no satellite, -1: vrs epoch not encoded
+* notes  : nav and spartn are only read, so one state can be shared by the
+*          stations of a batch
+*-----------------------------------------------------------------------------*/
+int gen_vrs_epoch(gtime_t *teph, double *rovpos, astro_t *astro, rtcm_t *rtcm, nav_t *nav, spartn_t *spartn, int ns, FILE *fRTCM, FILE *fLOG)
+{
+	sap_ssr_t *sap_ssr  = spartn->ssr;
+	gad_ssr_t *sap_gad  = spartn->ssr_gad;
+	vtec_t    *sap_vtec = spartn->vtec;
+	obs_t obs_vrs = { 0.0 };
+	vec_t vec_vrs[MAXOBS] = { 0.0 };
+	int i, j, nsat;
+
+	for (i = 0; i < spartn->ssr_offset; i++)
+	{
+		if (sap_ssr[i].t0[0] > 0.0) ns++;
+	}
+	for (i = 0; i < ns; i++)
+	{
+		int nav_iod = -1;
+		int sys = sap_ssr[i].sys;
+		if (sys != SPARTN_GLO)
+		{
+			for (j = 0; j < nav->n; j++)
+			{
+				if (sap_ssr[i].sat == nav->eph[j].sat)
+				{
+					nav_iod = nav->eph[j].iode;
+					break;
+				}
+			}
+		}
+		else
+		{
+			for (j = 0; j < nav->ng; j++)
+			{
+				if (sap_ssr[i].sat == nav->geph[j].sat)
+				{
+					nav_iod = nav->geph[j].iode;
+					break;
+				}
+			}
+		}
+		if (nav_iod != sap_ssr[i].iod[0]) continue;
+		double nav_toe = (sys != SPARTN_GLO) ? fmod(nav->eph[j].toe.time, 86400) : fmod(nav->geph[j].toe.time, 86400);
+		log_file(fLOG, "ocb:%6.0f,%6.0f,%6.0f,%6.0f,%6.0f,%3i,%3i,%2i,%3i,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f\n",
+			sap_ssr[i].t0[0], sap_ssr[i].t0[1], sap_ssr[i].t0[2], sap_ssr[i].t0[4], nav_toe, nav_iod, sap_ssr[i].iod[0], sys, sap_ssr[i].prn,
+			sap_ssr[i].deph[0], sap_ssr[i].deph[1], sap_ssr[i].deph[2], sap_ssr[i].dclk,
+			sap_ssr[i].cbias[0], sap_ssr[i].cbias[1], sap_ssr[i].cbias[2], sap_ssr[i].pbias[0], sap_ssr[i].pbias[1], sap_ssr[i].pbias[2]);
+	}
+
+    for (i = 0; i < AREA_NUM; i++)
+    {
+        if (sap_vtec[i].time == 0.0) continue;
+        log_file(fLOG, "vtec:%6.0f,%3d,%4i,%4i,%3i,%3i,%6.2f,%6.2f,%6.2f\n",
+            sap_vtec[i].time, sap_vtec[i].areaId, sap_vtec[i].rap_lat, sap_vtec[i].rap_lon,  sap_vtec[i].nc_lat, sap_vtec[i].nc_lon,
+            sap_vtec[i].spa_lat, sap_vtec[i].spa_lon, sap_vtec[i].avg_vtec);
+        int nres = sap_vtec[i].nc_lon*sap_vtec[i].nc_lat;
+        log_file(fLOG, "vtec:");
+        for (j = 0; j < nres; j++)
+            log_file(fLOG, j<nres-1 ? "%6.2f,": "%6.2f", sap_vtec[i].residual[j]);
+        log_file(fLOG, "\n");
+    }
+
+	vrs_epoch_time(teph, sap_ssr);
+	memset(&obs_vrs, 0, sizeof(obs_vrs));
+
+	nsat = satposs_sap_rcv(*teph, rovpos, vec_vrs, nav, sap_ssr, EPHOPT_SSRSAP);
+	obs_vrs.time = *teph;
+	obs_vrs.n = nsat;
+	memcpy(obs_vrs.pos, rovpos, 3 * sizeof(double));
+	for (i = 0; i < nsat; i++)
+	{
+		obs_vrs.data[i].sat = vec_vrs[i].sat;
+	}
+	nsat = compute_vector_data(&obs_vrs, vec_vrs);
+	if (nsat == 0)  return 0;
+
+    gen_obs_from_ssr(*teph, rovpos, astro, sap_ssr, sap_gad, spartn->hpac_grid, sap_vtec, &obs_vrs, vec_vrs, 0.0, fLOG);
+
+	unsigned char buffer[4096] = { 0 };
+	int len = gen_rtcm_vrsdata(&obs_vrs, rtcm, buffer, sizeof(buffer));
+	if (len <= 0) return -1;
+	fwrite(buffer, 1, len, fRTCM);
+	return 1;
+}
+
+/* ssr and broadcast ephemeris paired by iode ------------------------------*/
+int match_ssr_nav_iode(sap_ssr_t *sap_ssr, nav_t *nav)
+{
+	int i, j, ng = 0;
+	for (i = 0; i < nav->ns; i++)
+	{
+		int sys = sap_ssr[i].sys;
+		if (sys != SPARTN_GLO)
+		{
+			for (j = 0; j < nav->n; j++)
+			{
+				if (sap_ssr[i].sat == nav->eph[j].sat && sap_ssr[i].iod[0] == nav->eph[j].iode)
+				{
+					ng++;
+					break;
+				}
+			}
+		}
+		else
+		{
+			for (j = 0; j < nav->ng; j++)
+			{
+				if (sap_ssr[i].sat == nav->geph[j].sat && sap_ssr[i].iod[0] == nav->geph[j].iode)
+				{
+					ng++;
+					break;
+				}
+			}
+		}
+	}
+
+	double ratio = (double)ng / nav->ns;
+	if (ng >= 10 && ratio > 0.8)
+		return 1;
+	else
+		return 0;
+}
+
+/* satellites with corrections per system, returns the total ----------------*/
+int ssr_count_sys(const sap_ssr_t *ssr, uint32_t *nsys)
+{
+	int i, ns = 0;
+	for (i = 0; i < NSYSSSR; i++) nsys[i] = 0;
+	for (i = 0; i < SSR_NUM; i++)
+	{
+		if (ssr[i].prn != 0 && ssr[i].sys < NSYSSSR)
+		{
+			nsys[ssr[i].sys]++;
+			ns++;
+		}
+	}
+	return ns;
+}
+
+/* ephemerides of every satellite with corrections are in ---------------------*/
+static int eph_complete(const nav_t *nav, const uint32_t *nsys)
+{
+	return nav->n_gps >= nsys[SPARTN_GPS] && nav->ng >= nsys[SPARTN_GLO] && nav->n_gal >= nsys[SPARTN_GAL] &&
+		nav->n_bds >= nsys[SPARTN_BDS] && nav->n_qzs >= nsys[SPARTN_QZS];
+}
+
+int sread_eph_rtcm(unsigned char* buffer, uint32_t len, gnss_rtcm_t *rtcm, const uint32_t *nsys)
 {
 	int ret = 0;
-	int iter_ssr = 0;
-	char c = ' ';
+	int nused = 0;
 	uint32_t n;
-	for (n = 0; n < len; ++n)
+	for (n = 0; n < len; n += nused)
 	{
-		c = buffer[n];
-		ret = input_rtcm3(c, 0, rtcm);
-		if (ret == 2 && rtcm->nav.n_gps >= ns_gps && rtcm->nav.ng >= ns_g)
+		ret = input_rtcm3_nav(&rtcm->rcv[0], buffer + n, len - n, &rtcm->nav, &nused);
+		if (ret == 2 && eph_complete(&rtcm->nav, nsys))
 		{
 			//break;
 		}
@@ -810,25 +1210,31 @@ int sread_eph_rtcm(unsigned char* buffer, uint32_t len, gnss_rtcm_t *rtcm, uint3
 	return ret;
 }
 
-int fread_eph_rtcm(FILE *fRTCM, gnss_rtcm_t *rtcm, int ns_gps, int ns_g)
+int fread_eph_rtcm(FILE *fRTCM, gnss_rtcm_t *rtcm, const uint32_t *nsys)
 {
 	int ret = 0;
-	int iter_ssr = 0;
-	size_t readCount = 0;
-	char buff = ' ';
+	int nused = 0;
+	size_t readCount = 0, n;
+	long pos;
+	unsigned char buff[4096];
 	while (!feof(fRTCM))
 	{
-		memset(&buff, 0, sizeof(buff));
-		readCount = fread(&buff, sizeof(char), 1, fRTCM);
+		pos = ftell(fRTCM);
+		readCount = fread(buff, sizeof(char), sizeof(buff), fRTCM);
 		if (readCount < 1)
 		{
 			/* file error or eof of file */
 			break;
 		}
-		ret = input_rtcm3(buff, 0, rtcm);
-		if (ret == 2 && rtcm->nav.n_gps >= ns_gps && rtcm->nav.ng >= ns_g)
+		for (n = 0; n < readCount; n += nused)
 		{
-			break;
+			ret = input_rtcm3_nav(&rtcm->rcv[0], buff + n, (int)(readCount - n), &rtcm->nav, &nused);
+			if (ret == 2 && eph_complete(&rtcm->nav, nsys))
+			{
+				/* leave the file right after the last ephemeris */
+				fseek(fRTCM, pos + (long)(n + nused), SEEK_SET);
+				return ret;
+			}
 		}
 	}
 	return ret;
@@ -838,7 +1244,7 @@ int sread_ssr_sapcorda(unsigned char* buffer, uint32_t len, raw_spartn_t *spartn
 {
 	int ret = 0;
 	uint8_t c = 0;
-	uint32_t n, i;
+	uint32_t n;
 
 	for (n = 0; n < len; ++n)
 	{
@@ -855,13 +1261,7 @@ int sread_ssr_sapcorda(unsigned char* buffer, uint32_t len, raw_spartn_t *spartn
 		if (ret == 1 && t1*t2*t3*t4*t5*t6 > 0.0 && spartn_out->type == 0 && spartn_out->eos == 1)
 		{
 			//printf("\n");
-			for (i = 0; i < SSR_NUM; i++)
-			{
-				if (spartn_out->ssr[i].prn != 0 && spartn_out->ssr[i].sys == 0)
-					ssr_num[0]++;
-				else if (spartn_out->ssr[i].prn != 0 && spartn_out->ssr[i].sys == 1)
-					ssr_num[1]++;
-			}
+			ssr_count_sys(spartn_out->ssr, ssr_num);
 		}
 	}
 	return ret;
@@ -875,7 +1275,6 @@ int fread_ssr_sapcorda(FILE *fSSR, raw_spartn_t *spartn, spartn_t *spartn_out, u
 	size_t frameSize = 0;
 	size_t frameCount = 0;
 	size_t readCount = 0;
-	int i;
 
 	while (!feof(fSSR))
 	{
@@ -900,13 +1299,7 @@ int fread_ssr_sapcorda(FILE *fSSR, raw_spartn_t *spartn, spartn_t *spartn_out, u
 
 		if (ret == 1 && t1*t2*t3*t4*t5*t6 > 0.0 && spartn_out->type == 0 && spartn_out->eos == 1)
 		{
-			for (i = 0; i < SSR_NUM; i++)
-			{
-				if (spartn_out->ssr[i].prn != 0 && spartn_out->ssr[i].sys == 0)
-					ssr_num[0]++;
-				else if (spartn_out->ssr[i].prn != 0 && spartn_out->ssr[i].sys == 1)
-					ssr_num[1]++;
-			}
+			ssr_count_sys(spartn_out->ssr, ssr_num);
 
 			frameSize = 0;
 			frameCount++;
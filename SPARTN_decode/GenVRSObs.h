@@ -3,6 +3,7 @@
 
 #include "rtcm.h"
 #include "ephemeris.h"
+#include "tides.h"
 
 #include <stdio.h>
 
@@ -10,16 +11,38 @@
 extern "C" {
 #endif
 
+#define VRS_MAXMSG 5        /* max rtcm messages per vrs epoch (1005 + 4 msm) */
 
-int gen_vobs_from_ssr(obs_t *obs_rov, sap_ssr_t *ssr, gad_ssr_t *gad, obs_t *obs_vrs, vec_t *vec_vrs, double maskElev);
+typedef struct {            /* rtcm message in an output buffer (same layout as struct iovec) */
+    void *iov_base;         /* start of the message */
+    size_t iov_len;         /* message length (bytes) */
+} vrs_iov_t;
 
-int gen_obs_from_ssr(gtime_t time, double* rcvpos, sap_ssr_t *ssr, gad_ssr_t* gad, vtec_t *vtec, obs_t *obs_vrs, vec_t *vec_vrs, double maskElev, FILE *fLOG);
+typedef struct {            /* bounded rtcm output, appended epoch by epoch */
+    unsigned char *buff;    /* output buffer (caller provided, NULL: count only) */
+    size_t size;            /* size of buff (bytes) */
+    size_t nbyte;           /* bytes written */
+    vrs_iov_t *iov;         /* message list into buff (caller provided, NULL: none) */
+    int maxiov;             /* size of iov */
+    int niov;               /* messages listed */
+} vrs_out_t;
 
-int gen_rtcm_vrsdata(obs_t * obs, rtcm_t * rtcm, unsigned char * buff);
+int gen_vobs_from_ssr(obs_t *obs_rov, astro_t *astro, sap_ssr_t *ssr, gad_ssr_t *gad, obs_t *obs_vrs, vec_t *vec_vrs, double maskElev);
+
+int gen_obs_from_ssr(gtime_t time, double* rcvpos, astro_t *astro, sap_ssr_t *ssr, gad_ssr_t* gad, const hpac_grid_t *grid, vtec_t *vtec, obs_t *obs_vrs, vec_t *vec_vrs, double maskElev, FILE *fLOG);
+
+void vrs_out_init(vrs_out_t *out, unsigned char *buff, size_t size, vrs_iov_t *iov, int maxiov);
+int gen_rtcm_vrsout(obs_t *obs, rtcm_t *rtcm, vrs_out_t *out);
+int gen_rtcm_vrsdata(obs_t * obs, rtcm_t * rtcm, unsigned char * buff, int size);
+
+void vrs_epoch_time(gtime_t *teph, const sap_ssr_t *ssr);
+int gen_vrs_epoch(gtime_t *teph, double *rovpos, astro_t *astro, rtcm_t *rtcm, nav_t *nav, spartn_t *spartn, int ns, FILE *fRTCM, FILE *fLOG);
+int match_ssr_nav_iode(sap_ssr_t *sap_ssr, nav_t *nav);
 
 int read_obs_rtcm(FILE *fRTCM, gnss_rtcm_t *rtcm, int stnID);
-int sread_eph_rtcm(unsigned char * buffer, uint32_t len, gnss_rtcm_t * rtcm, uint32_t ns_gps, uint32_t ns_g);
-int fread_eph_rtcm(FILE *fRTCM, gnss_rtcm_t *rtcm, int ns_gps, int ns_g);
+int sread_eph_rtcm(unsigned char * buffer, uint32_t len, gnss_rtcm_t * rtcm, const uint32_t * nsys);
+int fread_eph_rtcm(FILE *fRTCM, gnss_rtcm_t *rtcm, const uint32_t *nsys);
+int ssr_count_sys(const sap_ssr_t *ssr, uint32_t *nsys);
 int sread_ssr_sapcorda(unsigned char * buffer, uint32_t len, raw_spartn_t * spartn, spartn_t * spartn_out, uint32_t * ssr_num);
 int fread_ssr_sapcorda(FILE *fSSR, raw_spartn_t *raw_spartn, spartn_t *spartn, uint32_t *ssr_num);
 int read_ssr_from_file(FILE *fRTCM, gnss_rtcm_t *rtcm);
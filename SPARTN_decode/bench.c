@@ -0,0 +1,353 @@
+/*------------------------------------------------------------------------------
+* bench.c : throughput benchmark of the SPARTN to RTCM pipeline
+*
+* stages are timed separately:
+*   input_spartn_data  : frames/s over an in-memory stream (framing+decoding)
+*   decoders           : messages/s by message type (the byte completing a frame)
+*   satposs_sap_rcv    : satellites/s
+*   gen_obs_from_ssr   : epochs/s
+*   gen_rtcm_vrsdata   : bytes/s
+* and the latency from rover position to rtcm output (satposs_sap_rcv through
+* gen_rtcm_vrsdata, the work done by merge_ssr_to_obs per gga) is kept per
+* epoch for percentiles.
+*-----------------------------------------------------------------------------*/
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "spartn_sim.h"
+#include "ephemeris.h"
+#include "GenVRSObs.h"
+#include "model.h"
+
+#define BENCH_VRS_BUFF  4096            /* rtcm output buffer as in gga_ssr2osr_main */
+#define BENCH_OCB_RATE  5               /* synthetic message rates (s) */
+#define BENCH_HPAC_RATE 30
+#define BENCH_GAD_RATE  30
+#define BENCH_LPAC_RATE 30
+#define BENCH_ROV_SPAN  1.0             /* extent of the synthetic rover grid (deg) */
+
+static const char *msg_name[4] = { "OCB", "HPAC", "GAD", "LPAC" };
+
+/* monotonic time (s) --------------------------------------------------------*/
+extern double bench_tick(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq = { 0 };
+	LARGE_INTEGER count;
+	if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1E-9;
+#endif
+}
+
+/* framing and decoding of an in-memory stream --------------------------------
+* a first untimed pass finds the byte completing each frame, the timed passes
+* then time those calls separately to get the per decoder cost
+*-----------------------------------------------------------------------------*/
+extern void bench_spartn_buff(bench_t *bench, const uint8_t *buff, int len, int nloop)
+{
+	static raw_spartn_t spartn;
+	static spartn_t spartn_out;
+	int *iend, *type, i, k, n = 0, loop;
+	double t0, t1;
+
+	if (len <= 0) return;
+	if (!(iend = (int *)malloc(sizeof(int)*(len / 8 + 1)))) return;
+	if (!(type = (int *)malloc(sizeof(int)*(len / 8 + 1)))) {
+		free(iend);
+		return;
+	}
+	memset(&spartn, 0, sizeof(spartn));
+	memset(&spartn_out, 0, sizeof(spartn_out));
+	for (i = 0; i < len; i++) {
+		if (input_spartn_data(&spartn, &spartn_out, buff[i]) != 1) continue;
+		iend[n] = i;
+		type[n++] = spartn_out.type;
+	}
+	for (loop = 0; loop < nloop; loop++) {
+		memset(&spartn, 0, sizeof(spartn));
+		memset(&spartn_out, 0, sizeof(spartn_out));
+		t0 = bench_tick();
+		for (i = 0, k = 0; i < len; i++) {
+			if (k < n && i == iend[k]) {
+				t1 = bench_tick();
+				input_spartn_data(&spartn, &spartn_out, buff[i]);
+				if (type[k] < 4) {
+					bench->msg[type[k]].t += bench_tick() - t1;
+					bench->msg[type[k]].n += 1.0;
+				}
+				k++;
+			}
+			else input_spartn_data(&spartn, &spartn_out, buff[i]);
+		}
+		bench->frame.t += bench_tick() - t0;
+		bench->frame.n += n;
+	}
+	free(iend);
+	free(type);
+}
+
+/* one vrs epoch, returns rtcm bytes ------------------------------------------*/
+extern int bench_vrs_epoch(bench_t *bench, gtime_t teph, double *rovpos, nav_t *nav, spartn_t *spartn)
+{
+	static obs_t obs_vrs;
+	static vec_t vec_vrs[MAXOBS];
+	unsigned char buffer[BENCH_VRS_BUFF] = { 0 };
+	double t0, t1, t2, t3;
+	int i, nsat, len;
+
+	memset(&obs_vrs, 0, sizeof(obs_vrs));
+	t0 = bench_tick();
+	nsat = satposs_sap_rcv(teph, rovpos, vec_vrs, nav, spartn->ssr, EPHOPT_SSRSAP);
+	bench->satpos.t += bench_tick() - t0;
+	bench->satpos.n += nsat;
+
+	obs_vrs.time = teph;
+	obs_vrs.n = nsat;
+	memcpy(obs_vrs.pos, rovpos, 3 * sizeof(double));
+	for (i = 0; i < nsat; i++) obs_vrs.data[i].sat = vec_vrs[i].sat;
+	if (compute_vector_data(&obs_vrs, vec_vrs) == 0) return 0;
+
+	t1 = bench_tick();
+	gen_obs_from_ssr(teph, rovpos, &bench->astro, spartn->ssr, spartn->ssr_gad, spartn->hpac_grid, spartn->vtec, &obs_vrs, vec_vrs, 0.0, NULL);
+	t2 = bench_tick();
+	len = gen_rtcm_vrsdata(&obs_vrs, &bench->out_rtcm, buffer, sizeof(buffer));
+	t3 = bench_tick();
+
+	bench->obs.t += t2 - t1;
+	bench->obs.n += 1.0;
+	bench->rtcm.t += t3 - t2;
+	bench->rtcm.n += len;
+	if (bench->nlat < BENCH_MAXLAT) bench->lat[bench->nlat++] = t3 - t0;
+	return len;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double d = *(const double *)a - *(const double *)b;
+	return d < 0.0 ? -1 : (d > 0.0 ? 1 : 0);
+}
+
+static void print_stage(FILE *fp, const char *name, const char *unit, const bench_stage_t *s)
+{
+	fprintf(fp, "%-20s %-10s %12.0f %10.3f %14.1f\n", name, unit, s->n, s->t, s->t > 0.0 ? s->n / s->t : 0.0);
+}
+
+/* print benchmark report -----------------------------------------------------*/
+extern void bench_report(const bench_t *bench, const char *title, FILE *fp)
+{
+	double *lat;
+	int i, n = bench->nlat;
+
+	fprintf(fp, "bench: %s\n", title);
+	fprintf(fp, "%-20s %-10s %12s %10s %14s\n", "stage", "unit", "count", "time(s)", "rate(/s)");
+	print_stage(fp, "input_spartn_data", "frames", &bench->frame);
+	for (i = 0; i < 4; i++) print_stage(fp, msg_name[i], "messages", &bench->msg[i]);
+	print_stage(fp, "satposs_sap_rcv", "sats", &bench->satpos);
+	print_stage(fp, "gen_obs_from_ssr", "epochs", &bench->obs);
+	print_stage(fp, "gen_rtcm_vrsdata", "bytes", &bench->rtcm);
+
+	if (n <= 0 || !(lat = (double *)malloc(sizeof(double)*n))) return;
+	memcpy(lat, bench->lat, sizeof(double)*n);
+	qsort(lat, n, sizeof(double), cmp_double);
+	fprintf(fp, "latency(ms) n=%d p50=%.3f p90=%.3f p99=%.3f max=%.3f\n", n,
+		lat[(int)(0.50*(n - 1))] * 1E3, lat[(int)(0.90*(n - 1))] * 1E3, lat[(int)(0.99*(n - 1))] * 1E3, lat[n - 1] * 1E3);
+	free(lat);
+}
+
+static uint8_t *read_file(const char *file, int *len)
+{
+	FILE *fp;
+	uint8_t *buff;
+	long n;
+
+	*len = 0;
+	if (!(fp = fopen(file, "rb"))) return NULL;
+	fseek(fp, 0, SEEK_END);
+	n = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (n <= 0 || !(buff = (uint8_t *)malloc(n))) {
+		fclose(fp);
+		return NULL;
+	}
+	*len = (int)fread(buff, 1, n, fp);
+	fclose(fp);
+	return buff;
+}
+
+/* benchmark on recorded spartn and rtcm ephemeris ----------------------------
+* ssr and ephemeris are paired epoch by epoch as in gga_ssr2osr_main
+*-----------------------------------------------------------------------------*/
+extern int bench_file(const char *ssrfile, const char *ephfile, double *ep, double *rovpos, int nloop, FILE *fout)
+{
+	static bench_t bench;
+	static gnss_rtcm_t rtcm;
+	static raw_spartn_t spartn;
+	static spartn_t spartn_out;
+	nav_t *nav = &rtcm.nav;
+	sap_ssr_t *sap_ssr = spartn_out.ssr;
+	gtime_t teph = epoch2time(ep);
+	FILE *fSSR, *fEPH;
+	uint8_t *buff;
+	int i, len, eof = 0;
+
+	memset(&bench, 0, sizeof(bench));
+	if (!(buff = read_file(ssrfile, &len))) return -1;
+	bench_spartn_buff(&bench, buff, len, nloop);
+	free(buff);
+
+	if (ephfile && (fSSR = fopen(ssrfile, "rb"))) {
+		if ((fEPH = fopen(ephfile, "rb"))) {
+			memset(&rtcm, 0, sizeof(rtcm));
+			memset(&spartn, 0, sizeof(spartn));
+			memset(&spartn_out, 0, sizeof(spartn_out));
+			set_approximate_time((int)ep[0], (int)time2doy(teph), rtcm.rcv);
+			while (!eof) {
+				memset(nav->nsys, 0, sizeof(nav->nsys));
+				fread_ssr_sapcorda(fSSR, &spartn, &spartn_out, nav->nsys);
+				for (nav->ns = 0, i = 0; i < NSYSSSR; i++) nav->ns += nav->nsys[i];
+				if (feof(fSSR)) break;
+				while (1) {
+					if (fread_eph_rtcm(fEPH, &rtcm, nav->nsys) != 2 && feof(fEPH)) {
+						eof = 1;
+						break;
+					}
+					if (match_ssr_nav_iode(sap_ssr, nav)) break;
+				}
+				if (eof) break;
+
+				while (1) {
+					double time1 = fmod((double)teph.time, DAY_SECONDS);
+					if (time1 - sap_ssr[0].t0[1] < 20.0 && time1 > sap_ssr[0].t0[1]) break;
+					teph = timeadd(teph, 1.0);
+				}
+				bench_vrs_epoch(&bench, teph, rovpos, nav, &spartn_out);
+			}
+			fclose(fEPH);
+		}
+		fclose(fSSR);
+	}
+	bench_report(&bench, ssrfile, fout ? fout : stdout);
+	return 0;
+}
+
+/* rovers on a grid centered on rovpos, NULL: error ---------------------------*/
+static double *bench_rovers(const double *rovpos, int nrov)
+{
+	double pos[3], p[3], step, *rr;
+	int i, n = (int)ceil(sqrt((double)nrov));
+
+	if (!(rr = (double *)malloc(sizeof(double) * 3 * nrov))) return NULL;
+	ecef2pos(rovpos, pos);
+	step = n > 1 ? BENCH_ROV_SPAN / (n - 1) : 0.0;
+	for (i = 0; i < nrov; i++) {
+		p[0] = pos[0] + ((i % n) - (n - 1) / 2.0) * step * D2R;
+		p[1] = pos[1] + ((i / n) - (n - 1) / 2.0) * step * D2R;
+		p[2] = pos[2];
+		pos2ecef(p, rr + 3 * i);
+	}
+	return rr;
+}
+
+/* benchmark on a synthetic stream --------------------------------------------
+* satellites and iode are taken from the ephemeris file, areas are placed
+* around the rover so the vrs stages run on the decoded corrections. the vrs
+* of nrov rovers spread over BENCH_ROV_SPAN around the rover is generated at
+* each epoch, with more rovers than TIDE_NCACHE the tide cache misses are
+* timed as well
+*-----------------------------------------------------------------------------*/
+extern int bench_sim(const char *ephfile, double *ep, double *rovpos, int nsat, int narea, int nsec, int nrov, FILE *fout)
+{
+	static bench_t bench;
+	static gnss_rtcm_t rtcm;
+	static raw_spartn_t spartn;
+	static spartn_t spartn_out;
+	static uint8_t epoch[64 * 1024];
+	spartn_sim_t sim = { 0 };
+	gtime_t time0 = epoch2time(ep);
+	uint32_t tod;
+	uint8_t *buff = NULL, *p;
+	int *off, i, j, k, n, len = 0, size = 0, nocb;
+	double pos[3], *rov;
+	char title[64];
+	FILE *fEPH;
+
+	if (nsec <= 0 || nrov <= 0 || !(off = (int *)malloc(sizeof(int)*(nsec + 1)))) return -1;
+	if (!(rov = bench_rovers(rovpos, nrov))) {
+		free(off);
+		return -1;
+	}
+	memset(&bench, 0, sizeof(bench));
+	memset(&rtcm, 0, sizeof(rtcm));
+	if (ephfile && (fEPH = fopen(ephfile, "rb"))) {
+		set_approximate_time((int)ep[0], (int)time2doy(time0), rtcm.rcv);
+		while (!feof(fEPH)) fread_eph_rtcm(fEPH, &rtcm, rtcm.nav.nsys);
+		fclose(fEPH);
+		sim.nav = &rtcm.nav;
+	}
+	ecef2pos(rovpos, pos);
+	sim.nsat = nsat;
+	sim.nsys = 2;
+	sim.narea = narea;
+	sim.ocb_rate = BENCH_OCB_RATE;
+	sim.hpac_rate = BENCH_HPAC_RATE;
+	sim.gad_rate = BENCH_GAD_RATE;
+	sim.lpac_rate = BENCH_LPAC_RATE;
+	sim.lat = pos[0] * R2D - 0.75;
+	sim.lon = pos[1] * R2D - 0.75;
+	sim.seed = 1;
+
+	/* start on a full set of messages */
+	tod = (uint32_t)fmod((double)time0.time, DAY_SECONDS);
+	tod -= tod % BENCH_GAD_RATE;
+	time0 = timeadd(time0, -fmod((double)time0.time, DAY_SECONDS) + tod);
+
+	for (i = 0; i < nsec; i++) {
+		off[i] = len;
+		n = sim_spartn_epoch(&sim, (tod + i) % DAY_SECONDS, epoch, sizeof(epoch));
+		if (n < 0) {
+			fprintf(stderr, "bench_sim: synthetic message not encoded at %u s\n", (tod + i) % DAY_SECONDS);
+			free(buff);
+			free(off);
+			free(rov);
+			return -1;
+		}
+		if (len + n > size) {
+			size = (len + n) * 2;
+			if (!(p = (uint8_t *)realloc(buff, size))) break;
+			buff = p;
+		}
+		memcpy(buff + len, epoch, n);
+		len += n;
+	}
+	off[i] = len;
+	nsec = i;
+	bench_spartn_buff(&bench, buff, len, 1);
+
+	if (sim.nav) {
+		memset(&spartn, 0, sizeof(spartn));
+		memset(&spartn_out, 0, sizeof(spartn_out));
+		for (i = 0; i < nsec; i++) {
+			for (j = off[i], nocb = 0; j < off[i + 1]; j++) {
+				if (input_spartn_data(&spartn, &spartn_out, buff[j]) == 1 && spartn_out.type == 0 && spartn_out.eos) nocb = 1;
+			}
+			if (!nocb) continue;
+			for (k = 0; k < nrov; k++) bench_vrs_epoch(&bench, timeadd(time0, i), rov + 3 * k, &rtcm.nav, &spartn_out);
+		}
+	}
+	sprintf(title, "synthetic, %d rovers", nrov);
+	bench_report(&bench, title, fout ? fout : stdout);
+	free(buff);
+	free(off);
+	free(rov);
+	return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdio.h>
+#include "spartn.h"
+#include "rtcm.h"
+#include "tides.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCH_MAXLAT    86400           /* max number of latency samples */
+
+typedef struct {
+	double t;                           /* elapsed time (s) */
+	double n;                           /* processed units */
+} bench_stage_t;
+
+typedef struct {
+	bench_stage_t frame;                /* input_spartn_data, frames */
+	bench_stage_t msg[4];               /* decoders by message type, messages */
+	bench_stage_t satpos;               /* satposs_sap_rcv, satellites */
+	bench_stage_t obs;                  /* gen_obs_from_ssr, epochs */
+	bench_stage_t rtcm;                 /* gen_rtcm_vrsdata, bytes */
+	astro_t astro;                      /* astronomical context of the epochs */
+	rtcm_t out_rtcm;                    /* rtcm encoder of the epochs */
+	int nlat;                           /* number of latency samples */
+	double lat[BENCH_MAXLAT];           /* rover position to rtcm latency (s) */
+} bench_t;
+
+double bench_tick(void);
+void bench_spartn_buff(bench_t *bench, const uint8_t *buff, int len, int nloop);
+int bench_vrs_epoch(bench_t *bench, gtime_t teph, double *rovpos, nav_t *nav, spartn_t *spartn);
+void bench_report(const bench_t *bench, const char *title, FILE *fp);
+
+int bench_file(const char *ssrfile, const char *ephfile, double *ep, double *rovpos, int nloop, FILE *fout);
+int bench_sim(const char *ephfile, double *ep, double *rovpos, int nsat, int narea, int nsec, int nrov, FILE *fout);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
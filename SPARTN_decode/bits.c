@@ -94,6 +94,15 @@ int32_t getbits(const uint8_t *buff, int pos, int len) {
 	return (int32_t)(bits | (~0u << len)); /* extend sign */
 }
 
+void putbitu(uint8_t *buff, int pos, int len, uint32_t data) {
+	int i;
+	if (len <= 0 || 32 < len) return;
+	for (i = pos + len - 1; i >= pos; i--, data >>= 1) {
+		if (data & 1u) buff[i / 8] |= (uint8_t)(1u << (7 - i % 8));
+		else           buff[i / 8] &= (uint8_t)~(1u << (7 - i % 8));
+	}
+}
+
 
 // int main()
 // {
@@ -11,6 +11,7 @@ void bits_to_bytes_array(uint8_t *bits_array, uint8_t *bytes_array, uint32_t arr
 
 uint32_t getbitu(const uint8_t *buff, int pos, int len);
 int32_t getbits(const uint8_t *buff, int pos, int len);
+void putbitu(uint8_t *buff, int pos, int len, uint32_t data);
 /*--------------------------------------------------------------------*/
 #ifdef __cplusplus
 }
@@ -602,7 +602,7 @@ extern void satposs_sap(obs_t *obs, vec_t *vec, nav_t *nav, sap_ssr_t *ssr, int
 {
     gtime_t teph = obs->time, time[MAXOBS] = { 0 };
     double dt, pr, e[3] = { 0 };
-    int i, j, sys = 0, prn = 0, sap_sat, idx=-1;
+    int i, j, sys = 0, prn = 0, idx=-1;
     for (i = 0; i < obs->n; i++)
     {
         vec[i].sat = obs->data[i].sat;
@@ -618,8 +618,7 @@ extern void satposs_sap(obs_t *obs, vec_t *vec, nav_t *nav, sap_ssr_t *ssr, int
         idx = -1;
         for (j = 0; j < nav->ns; j++)
         {
-            sap_sat = (ssr[j].sys == 0 ? ssr[j].prn : MAXPRNGPS + ssr[j].prn);
-            if (obs->data[i].sat == sap_sat)
+            if (obs->data[i].sat == ssr[j].sat)
             {
                 idx = j;
                 break;
@@ -662,11 +661,11 @@ extern int nav_ssr_unpair(nav_t *nav, sap_ssr_t *ssr, int *unpair_sat, int *unpa
     int n = 0, i, j;
     for (i = 0; i < SSR_NUM; ++i)
     {
-        if (ssr[i].sys == 0)
+        if (ssr[i].sys != SPARTN_GLO)
         {
             for (j = 0; j < nav->n; j++)
             {
-                if (ssr[i].sat == nav->eph[j].sat && ssr[i].iod[0] != nav->eph[j].iode)
+                if (ssr[i].sat == nav->eph[j].sat && ssr[i].iod[0] != nav->eph[j].iode && n < MAXOBS)
                 {
                     unpair_nav[n] = j;
                     unpair_ssr[n] = i;
@@ -679,9 +678,9 @@ extern int nav_ssr_unpair(nav_t *nav, sap_ssr_t *ssr, int *unpair_sat, int *unpa
         {
             for (j = 0; j < nav->ng; j++)
             {
-                if (ssr[i].sat == nav->geph[j].sat  && ssr[i].iod[0] != nav->geph[j].iode)
+                if (ssr[i].sat == nav->geph[j].sat  && ssr[i].iod[0] != nav->geph[j].iode && n < MAXOBS)
                 {
-                    unpair_nav[n] = j+100;
+                    unpair_nav[n] = j;
                     unpair_ssr[n] = i;
                     unpair_sat[n] = nav->geph[j].sat;
                     ++n;
@@ -697,11 +696,11 @@ static int match_nav_ssr(nav_t *nav, sap_ssr_t *ssr, int *inav, int *issr)
     int n=0, i, j;
     for (i = 0; i < SSR_NUM; ++i)
     {
-        if (ssr[i].sys == 0)
+        if (ssr[i].sys != SPARTN_GLO)
         {
             for (j = 0; j < nav->n; j++)
             {
-                if (ssr[i].sat == nav->eph[j].sat && ssr[i].iod[0]== nav->eph[j].iode)
+                if (ssr[i].sat == nav->eph[j].sat && ssr[i].iod[0]== nav->eph[j].iode && n < MAXOBS)
                 {
                     inav[n] = j;
                     issr[n] = i;
@@ -713,9 +712,9 @@ static int match_nav_ssr(nav_t *nav, sap_ssr_t *ssr, int *inav, int *issr)
         {
             for (j = 0; j < nav->ng; j++)
             {
-                if (ssr[i].sat == nav->geph[j].sat  && ssr[i].iod[0] == nav->geph[j].iode)
+                if (ssr[i].sat == nav->geph[j].sat  && ssr[i].iod[0] == nav->geph[j].iode && n < MAXOBS)
                 {
-                    inav[n] = j+100;
+                    inav[n] = j+MAXEPH;
                     issr[n] = i;
                     ++n;
                 }
@@ -725,46 +724,77 @@ static int match_nav_ssr(nav_t *nav, sap_ssr_t *ssr, int *inav, int *issr)
     return n;
 }
 
+/* light-time iteration histogram ----------------------------------------------
+* lt_hist[n] counts satellites whose transmission time was solved with n calls
+* of satpos() (n=0: no orbit at first guess), counted per thread
+*-----------------------------------------------------------------------------*/
+static THREAD_LOCAL unsigned int lt_hist[LT_NHIST] = { 0 };
+
+extern void get_lighttime_hist(unsigned int *hist)
+{
+    int i;
+    for (i = 0; i < LT_NHIST; i++) hist[i] = lt_hist[i];
+}
+
+extern void reset_lighttime_hist(void)
+{
+    int i;
+    for (i = 0; i < LT_NHIST; i++) lt_hist[i] = 0;
+}
+
+/* satellite positions at signal transmission time ---------------------------
+* solve light-time with a fixed number of satpos() calls:
+*   pass 1 : satpos() at teph-0.075s
+*   pass 2 : satpos() at teph-tau1, receiver rotated by earth rotation
+*   final  : newton step with satellite velocity, rs-=v*(tau2-tau1)
+* the first guess is off by <0.02s, pass 2 reduces this to |rdot|/c*0.02s
+* (<1e-7s for |rdot|<1km/s), the velocity step leaves a residual of
+* |rdot|/c*1e-7s (<1e-12s, <0.3mm) and a position error of |a|*dt^2/2
+* (<1e-13m), far below the ssr orbit accuracy
+*-----------------------------------------------------------------------------*/
 extern int satposs_sap_rcv(gtime_t teph, double *rcvpos, vec_t *vec, nav_t *nav, sap_ssr_t *ssr, int ephopt)
 {
     gtime_t time[MAXOBS] = { 0 };
     int inav[MAXOBS] = { 0 }, issr[MAXOBS] = { 0 };
-    double dt, pr, e[3] = { 0 },r=0.0;
-    int i, j, sys = 0, prn = 0, nsat = 0;;
-    double rho = 0.0;
+    double tt, dtt, dPhi, xRec, yRec, rho = 0.0;
+    int i, j, niter, nsat = 0;
     int nobs = match_nav_ssr(nav, ssr, inav, issr);
 
     for (i = 0; i < nobs; i++)
     {
         vec[i].sat = ssr[issr[i]].sat;
-        sys = satsys(ssr[issr[i]].sat, &prn);
-        double tt = 0.075, tmpt=0.0;
-        while (1)
+
+        /* pass 1: first guess of light-time */
+        niter = 0;
+        tt = 0.075;
+        time[i] = timeadd(teph, -tt);
+        if (satpos(time[i], teph, vec[i].sat, ephopt, nav, &ssr[issr[i]], vec[i].rs, vec[i].dts, &vec[i].var, &vec[i].svh))
         {
-        // Correction station position due to Earth Rotation
-        // -------------------------------------------------
-            double dPhi = OMGE * rho /  CLIGHT;
-            double xRec = rcvpos[0] * cos(dPhi) - rcvpos[1] * sin(dPhi);
-            double yRec = rcvpos[1] * cos(dPhi) + rcvpos[0] * sin(dPhi);
-            double zRec = rcvpos[2];
+            niter++;
+            rho = sqrt(SQR(vec[i].rs[0] - rcvpos[0]) + SQR(vec[i].rs[1] - rcvpos[1]) + SQR(vec[i].rs[2] - rcvpos[2]));
+            tt = rho / CLIGHT;
 
-            /* transmission time by satellite clock */
+            /* pass 2: satellite position at improved transmission time */
             time[i] = timeadd(teph, -tt);
+            if (satpos(time[i], teph, vec[i].sat, ephopt, nav, &ssr[issr[i]], vec[i].rs, vec[i].dts, &vec[i].var, &vec[i].svh))
+            {
+                niter++;
 
-            /* satellite position and clock at transmission time */
-            if (!satpos(time[i], teph, vec[i].sat, ephopt, nav, &ssr[issr[i]], vec[i].rs, vec[i].dts, &vec[i].var, &vec[i].svh))
-                break;
-
-            rho  = sqrt(SQR(vec[i].rs[0] - xRec) + SQR(vec[i].rs[1] - yRec) + SQR(vec[i].rs[2] - zRec));
+                // Correction station position due to Earth Rotation
+                // -------------------------------------------------
+                dPhi = OMGE * rho / CLIGHT;
+                xRec = rcvpos[0] * cos(dPhi) - rcvpos[1] * sin(dPhi);
+                yRec = rcvpos[1] * cos(dPhi) + rcvpos[0] * sin(dPhi);
+                rho = sqrt(SQR(vec[i].rs[0] - xRec) + SQR(vec[i].rs[1] - yRec) + SQR(vec[i].rs[2] - rcvpos[2]));
 
-            tmpt = rho / CLIGHT;
-            if (fabs(tmpt - tt) < 1.0e-8)
-            {
-                break;
+                /* newton step with satellite velocity instead of another satpos() */
+                dtt = rho / CLIGHT - tt;
+                for (j = 0; j < 3; j++) vec[i].rs[j] -= vec[i].rs[j + 3] * dtt;
+                vec[i].dts[0] -= vec[i].dts[1] * dtt;
+                time[i] = timeadd(time[i], -dtt);
             }
-            else
-                tt = tmpt;
         }
+        lt_hist[niter]++;
     
         /* if no precise clock available, use broadcast clock instead */
         if (vec[i].dts[0] == 0.0)
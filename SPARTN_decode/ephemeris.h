@@ -17,6 +17,7 @@ extern "C" {
 #define EPHOPT_SSRCOM  4                   /* ephemeris option: broadcast + SSR_COM */
 #define EPHOPT_LEX     5                   /* ephemeris option: QZSS LEX ephemeris */
 #define EPHOPT_SSRSAP  6                   /* ephemeris option: broadcast + SAPCORDA SSR */
+#define LT_NHIST       3                   /* size of light-time iteration histogram */
     
 typedef struct {
 	int	   sat;        /*prn*/
@@ -42,6 +43,10 @@ void satposs_sap(obs_t *obs, vec_t *vec, nav_t *nav, sap_ssr_t *ssr, int ephopt)
 /* compute satellit position using Sapcorda SSR and rover position*/
 int satposs_sap_rcv(gtime_t teph, double *rcvpos, vec_t *vec, nav_t *nav, sap_ssr_t *ssr, int ephopt);
 
+/* light-time iteration histogram (satpos() calls per satellite) */
+void get_lighttime_hist(unsigned int *hist);
+void reset_lighttime_hist(void);
+
 int compute_vector_data(obs_t* obs, vec_t* vec);
 
 int nav_ssr_unpair(nav_t *nav, sap_ssr_t *ssr, int *unpair_sat, int *unpair_nav, int *unpair_ssr);
@@ -7,10 +7,24 @@
 extern "C" {
 #endif
 
+#define GGA_OUT_MAXLEN 1200	/* out_buffer size assumed by input_gga */
+
 
 	void input_ssr(unsigned char* buffer, uint32_t len);
 	void input_eph(unsigned char* buffer, uint32_t len);
 	void input_gga(char* buffer, unsigned char* out_buffer, uint32_t* len);
+	/* returns 0, or NMEA_ERR_* of model.h for a malformed sentence */
+	int input_gga_ex(char* buffer, unsigned char* out_buffer, uint32_t size, uint32_t* len);
+
+	/* snapshot of the decoded state written to file every interval s (0: SSRSNAP_INTERVAL),
+	   restored from file first if not older than maxage s (0: SSRSNAP_MAXAGE),
+	   returns 1 if the state was restored */
+	int set_ssr_state_file(const char* file, double interval, double maxage);
+	/* write a snapshot now, returns 0 on error */
+	int save_ssr_state(const char* file);
+	/* ocean tide loading grid file (otl_grid_write()) used instead of the builtin grid,
+	   required with OTL_NO_BUILTIN_GRID, returns 0 on error */
+	int set_otl_grid_file(const char* file);
 
 	void input_ssr_test(unsigned char* buffer, uint32_t len);
 	void input_gga_test(char* buffer, unsigned char* out_buffer, uint32_t* len);
@@ -1,79 +1,155 @@
 #include "log.h"
 #include <stdarg.h>
+#include <string.h>
 
 FILE*  table_file = NULL;
 
-void slog(int level, int tab, const char *format, ...) {
-#ifdef LOG
-	if (level >= LOG_DEBUG) {
-		va_list ap;
-		int i;
-		char buffer[2048] = { 0 };
-		char tab_buffer[128] = { 0 };
-		va_start(ap, format); vsprintf(buffer, format, ap); va_end(ap);
-		for (i = 0; i < tab; i++) {
-			tab_buffer[i] = ' ';
-		}
-		printf("%s%s \n", tab_buffer, buffer);
+int log_level[LOG_SYS_NUM] = { LOG_OFF, LOG_OFF, LOG_OFF, LOG_OFF, LOG_OFF, LOG_OFF, LOG_OFF };
+FILE* log_table[LOG_SYS_NUM] = { NULL };
+int log_table_level = LOG_OFF;
+
+static const char* log_sys_name[LOG_SYS_NUM] = { "frame", "ocb", "hpac", "gad", "lpac", "vrs", "rtcm" };
+
+void slog_out(int tab, const char *format, ...) {
+	va_list ap;
+	int i;
+	char buffer[2048] = { 0 };
+	char tab_buffer[128] = { 0 };
+	va_start(ap, format);
+	if (log_async_put(LOG_REC_SLOG, NULL, tab, format, &ap)) { va_end(ap); return; }
+	vsnprintf(buffer, sizeof(buffer), format, ap); va_end(ap);
+	for (i = 0; i < tab && i < (int)sizeof(tab_buffer) - 1; i++) {
+		tab_buffer[i] = ' ';
 	}
-#endif // LOG
+	printf("%s%s \n", tab_buffer, buffer);
 }
 
 void open_table_file(const char* filename) {
-#ifdef TABLE_LOG
 	table_file = fopen(filename, "w");
-#endif // TABLE_LOG
 }
 
 void close_table_file() {
-#ifdef TABLE_LOG
+	log_async_drain();
 	if (table_file) {
 		fclose(table_file);
 		table_file = NULL;
 	}
-#endif // TABLE_LOG
 }
 
 void table_log(const char *format, ...) {
-#ifdef TABLE_LOG
 	va_list ap;
 	char buffer[2048] = { 0 };
-	va_start(ap, format); vsprintf(buffer, format, ap); va_end(ap);
+	if (log_table_level >= LOG_OFF) return;
+	va_start(ap, format);
+	if (log_async_put(LOG_REC_TABLE, NULL, 0, format, &ap)) { va_end(ap); return; }
+	vsnprintf(buffer, sizeof(buffer), format, ap); va_end(ap);
 	if (table_file) {
 		fprintf(table_file, "%s \n", buffer);
 	}
 	else {
 		printf("%s \n", buffer);
 	}
-#endif // TABLE_LOG
 }
 
+//"-" routes the table to stdout
 void open_table_file_ex(FILE ** file, const char * filename)
 {
-#ifdef TABLE_LOG
-	*file = fopen(filename, "w");
-#endif // TABLE_LOG
+	*file = strcmp(filename, "-") ? fopen(filename, "w") : stdout;
 }
 
 void close_table_file_ex(FILE ** file) {
-#ifdef TABLE_LOG
-	if (*file) {
+	log_async_drain();
+	if (*file && *file != stdout) {
 		fclose(*file);
-		*file = NULL;
 	}
-#endif // TABLE_LOG
+	*file = NULL;
 }
 
-void table_log_ex(FILE * file,const char *format, ...) {
-#ifdef TABLE_LOG
+void table_log_out(FILE * file,const char *format, ...) {
 	va_list ap;
 	char buffer[2048] = { 0 };
-	va_start(ap, format); vsprintf(buffer, format, ap); va_end(ap);
-	if (file) {
-		fprintf(file, "%s \n", buffer);
+	va_start(ap, format);
+	if (log_async_put(LOG_REC_TABLE_EX, file, 0, format, &ap)) { va_end(ap); return; }
+	vsnprintf(buffer, sizeof(buffer), format, ap); va_end(ap);
+	fprintf(file, "%s \n", buffer);
+}
+
+int log_sys_index(const char *name) {
+	int i;
+	for (i = 0; i < LOG_SYS_NUM; i++) {
+		if (!strcmp(name, log_sys_name[i])) return i;
 	}
-	else {
-		printf("%s \n", buffer);
+	return -1;
+}
+
+//table sink of a subsystem, an open sink is closed first
+int log_table_open(int sys, const char *filename) {
+	if (sys < 0 || sys >= LOG_SYS_NUM || !filename) return -1;
+	log_table_close(sys);
+	open_table_file_ex(&log_table[sys], filename);
+	return log_table[sys] ? 0 : -1;
+}
+
+void log_table_close(int sys) {
+	if (sys < 0 || sys >= LOG_SYS_NUM || !log_table[sys]) return;
+	close_table_file_ex(&log_table[sys]);
+}
+
+/* configure levels and table sinks from a comma separated list ----------------
+* items  : <sys>=<level>        level of a subsystem, debug|info|off
+*          *=<level>            level of all subsystems
+*          <sys>.table=<file>   table sink of a subsystem, "-": stdout
+*          <sys>.table=off      close the table sink
+*          table=<level>        level of table_log(), off by default
+* sys    : frame|ocb|hpac|gad|lpac|vrs|rtcm
+* notes  : items apply in order, "*=info,hpac=debug" keeps hpac at debug
+* return : number of items not understood
+*-----------------------------------------------------------------------------*/
+int log_config(const char *spec) {
+	char item[256], *key, *val, *dot;
+	const char *p = spec, *q;
+	int i, sys, level, nerr = 0;
+	size_t len;
+	if (!spec) return 0;
+	for (; *p; p = *q ? q + 1 : q) {
+		q = strchr(p, ',');
+		if (!q) q = p + strlen(p);
+		len = (size_t)(q - p) < sizeof(item) ? (size_t)(q - p) : sizeof(item) - 1;
+		memcpy(item, p, len); item[len] = '\0';
+		if (!(val = strchr(item, '='))) { if (len) nerr++; continue; }
+		*val++ = '\0';
+		key = item;
+		if ((dot = strchr(key, '.')) != NULL) *dot++ = '\0';
+		sys = strcmp(key, "*") ? log_sys_index(key) : LOG_SYS_NUM;
+		if (!strcmp(key, "table") && !dot) sys = LOG_SYS_NUM + 1;
+		if (sys < 0) { nerr++; continue; }
+		if (dot) {
+			if (strcmp(dot, "table") || sys == LOG_SYS_NUM) { nerr++; continue; }
+			if (!strcmp(val, "off")) log_table_close(sys);
+			else if (log_table_open(sys, val) < 0) nerr++;
+			continue;
+		}
+		if      (!strcmp(val, "debug")) level = LOG_DEBUG;
+		else if (!strcmp(val, "info"))  level = LOG_INFO;
+		else if (!strcmp(val, "off"))   level = LOG_OFF;
+		else { nerr++; continue; }
+		if (sys > LOG_SYS_NUM) { log_table_level = level; continue; }
+		for (i = 0; i < LOG_SYS_NUM; i++) {
+			if (i == sys || sys == LOG_SYS_NUM) log_level[i] = level;
+		}
 	}
-#endif // TABLE_LOG
-}
\ No newline at end of file
+	return nerr;
+}
+
+void log_file(FILE * file, const char * format, ...) {
+	va_list ap;
+	if (!file) return;
+	va_start(ap, format);
+	if (!log_async_put(LOG_REC_FILE, file, 0, format, &ap)) vfprintf(file, format, ap);
+	va_end(ap);
+}
+
+void log_file_flush(FILE * file) {
+	if (!file) return;
+	if (!log_async_put(LOG_REC_FLUSH, file, 0, NULL, NULL)) fflush(file);
+}
@@ -2,24 +2,70 @@
 #define _LOG_H_
 
 #include <stdio.h>
+#include <stdarg.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-//#define LOG
-//#define TABLE_LOG
+//subsystems with their own level and table sink, see log_config()
+#define LOG_SYS_FRAME	0
+#define LOG_SYS_OCB		1
+#define LOG_SYS_HPAC	2
+#define LOG_SYS_GAD		3
+#define LOG_SYS_LPAC	4
+#define LOG_SYS_VRS		5
+#define LOG_SYS_RTCM	6
+#define LOG_SYS_NUM		7
+
+//subsystem of the slog() calls of a file, define it before including log.h
+#ifndef LOG_SYS
+#define LOG_SYS LOG_SYS_FRAME
+#endif
 
 #define LOG_DEBUG 1
 #define LOG_INFO 2
-void slog(int level, int tab, const char *format, ...);
+#define LOG_OFF 3
+
+extern int log_level[LOG_SYS_NUM];		//messages below the level are dropped, LOG_OFF by default
+extern FILE* log_table[LOG_SYS_NUM];	//table sink, NULL: table output disabled
+extern int log_table_level;				//table_log() writes below LOG_OFF, LOG_OFF by default
+
+//disabled call sites cost one compare, the arguments are not evaluated
+#define SLOG(sys, level, tab, ...) do { if ((level) >= log_level[sys]) slog_out(tab, __VA_ARGS__); } while (0)
+#define slog(level, tab, ...) SLOG(LOG_SYS, level, tab, __VA_ARGS__)
+#define table_log_ex(file, ...) do { if (file) table_log_out(file, __VA_ARGS__); } while (0)
+
+void slog_out(int tab, const char *format, ...);
 void open_table_file(const char* filename);
 void close_table_file();
 void table_log(const char *format, ...);
 
 void open_table_file_ex(FILE** file, const char* filename);
 void close_table_file_ex(FILE** file);
-void table_log_ex(FILE * file, const char * format, ...);
+void table_log_out(FILE * file, const char * format, ...);
+
+int log_sys_index(const char *name);
+int log_table_open(int sys, const char *filename);
+void log_table_close(int sys);
+int log_config(const char *spec);
+
+//plain fprintf to an output file, e.g. fLOG of gen_obs_from_ssr
+void log_file(FILE * file, const char * format, ...);
+void log_file_flush(FILE * file);
+
+//asynchronous backend (log_async.cpp): while started, the functions above
+//queue binary records to a writer thread instead of writing themselves.
+//the format is kept by pointer and must outlive the record (string literals)
+#define LOG_REC_SLOG		0
+#define LOG_REC_TABLE		1
+#define LOG_REC_TABLE_EX	2
+#define LOG_REC_FILE		3
+#define LOG_REC_FLUSH		4
+int log_async_start(void);
+void log_async_stop(void);
+void log_async_drain(void);
+int log_async_put(int kind, FILE * file, int tab, const char * format, va_list * ap);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,353 @@
+/*------------------------------------------------------------------------------
+* log_async.cpp : asynchronous backend of slog/table_log/log_file
+*
+* every producer thread owns a single-producer/single-consumer ring of binary
+* records. a record keeps the format pointer and the raw arguments; the
+* writer thread formats it and does the file I/O, so a producer never blocks
+* on disk. when a ring is full, log_file() output waits for space and the
+* other records are dropped and counted. a record the binary form cannot
+* hold is written synchronously by the caller, once the ring of its thread
+* is empty.
+* records of one thread keep their order, records of different threads are
+* interleaved in the order the writer drains them.
+* log_async_stop() joins the writer after the records of the producers still
+* inside log_async_put() are written, it is also run at exit.
+*-----------------------------------------------------------------------------*/
+#include "log.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <chrono>
+
+#define LOG_RING_SIZE	256			/* records per thread, power of 2 */
+#define LOG_MAXARG		24			/* arguments kept in binary form */
+#define LOG_STRLEN		192			/* copied %s arguments */
+#define LOG_IDLE_MS		2			/* writer sleep when all rings are empty */
+
+enum { LOG_ARG_INT, LOG_ARG_LLONG, LOG_ARG_DBL, LOG_ARG_STR, LOG_ARG_PTR };
+
+typedef struct {
+	FILE* file;						/* target, NULL: stdout or table_file */
+	const char* fmt;				/* format, NULL: LOG_REC_FLUSH */
+	uint8_t kind;					/* LOG_REC_* */
+	uint8_t tab;					/* slog indent */
+	uint8_t narg;
+	uint8_t type[LOG_MAXARG];
+	union { long long i; double d; const void* p; uint16_t s; } arg[LOG_MAXARG];
+	char text[LOG_STRLEN];
+} log_rec_t;
+
+typedef struct log_ring {
+	std::atomic<size_t> head;		/* consumer */
+	std::atomic<size_t> tail;		/* producer */
+	std::atomic<int> orphan;		/* owner thread has exited */
+	log_rec_t rec[LOG_RING_SIZE];
+} log_ring_t;
+
+static std::mutex s_ring_lock;					/* ring list, taken once per thread */
+static std::vector<log_ring_t*> s_rings;
+static std::atomic<int> s_running(0);
+static std::atomic<int> s_active(0);			/* producers inside log_async_put */
+static std::atomic<int> s_atexit(0);
+static std::atomic<unsigned> s_dropped(0);
+static std::thread s_writer;
+
+extern "C" FILE* table_file;
+
+/* release the ring of an exiting thread for reuse */
+struct log_ring_owner {
+	log_ring_t* ring;
+	log_ring_owner() : ring(NULL) {}
+	~log_ring_owner() { if (ring) ring->orphan.store(1, std::memory_order_release); }
+};
+static thread_local log_ring_owner t_owner;
+
+static log_ring_t* thread_ring()
+{
+	if (t_owner.ring) return t_owner.ring;
+	std::lock_guard<std::mutex> lock(s_ring_lock);
+	for (size_t i = 0; i < s_rings.size(); i++) {
+		log_ring_t* r = s_rings[i];
+		if (r->orphan.load(std::memory_order_acquire) &&
+			r->head.load(std::memory_order_acquire) == r->tail.load(std::memory_order_acquire)) {
+			r->orphan.store(0, std::memory_order_relaxed);
+			return t_owner.ring = r;
+		}
+	}
+	log_ring_t* r = new(std::nothrow) log_ring_t;
+	if (!r) return NULL;
+	r->head.store(0); r->tail.store(0); r->orphan.store(0);
+	s_rings.push_back(r);
+	return t_owner.ring = r;
+}
+
+/* skip a conversion spec after '%', returns its argument type, -1: none (%%), -2: unsupported */
+static int scan_spec(const char** pp, int* nstar)
+{
+	const char* p = *pp;
+	int ll = 0, l = 0;
+	*nstar = 0;
+	if (*p == '%') { *pp = p + 1; return -1; }
+	while (*p && strchr("-+ #0", *p)) p++;
+	if (*p == '*') { (*nstar)++; p++; } else while (*p >= '0' && *p <= '9') p++;
+	if (*p == '.') {
+		p++;
+		if (*p == '*') { (*nstar)++; p++; } else while (*p >= '0' && *p <= '9') p++;
+	}
+	for (;; p++) {
+		if (*p == 'l') { if (l) ll = 1; l = 1; }
+		else if (*p == 'j' || *p == 'z' || *p == 't' || *p == 'q') ll = 1;
+		else if (*p == 'I' && p[1] == '6' && p[2] == '4') { ll = 1; p += 2; }
+		else if (*p != 'h' && *p != 'L') break;
+	}
+	*pp = *p ? p + 1 : p;
+	switch (*p) {
+	case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+		return ll ? LOG_ARG_LLONG : (l ? LOG_ARG_LLONG + 16 : LOG_ARG_INT);
+	case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+		return LOG_ARG_DBL;
+	case 's': return LOG_ARG_STR;
+	case 'p': return LOG_ARG_PTR;
+	}
+	return -2;
+}
+
+/* capture the arguments of fmt into rec, 0: format not supported in binary form */
+static int capture_args(log_rec_t* rec, const char* fmt, va_list ap)
+{
+	const char* p = fmt;
+	int n = 0, nstar, type, k;
+	size_t ns = 0, len;
+	while ((p = strchr(p, '%')) != NULL) {
+		p++;
+		if ((type = scan_spec(&p, &nstar)) == -1) continue;
+		if (type == -2 || n + nstar + 1 > LOG_MAXARG) return 0;
+		for (k = 0; k < nstar; k++) {
+			rec->type[n] = LOG_ARG_INT; rec->arg[n++].i = va_arg(ap, int);
+		}
+		switch (type) {
+		case LOG_ARG_INT:       rec->arg[n].i = va_arg(ap, int); break;
+		case LOG_ARG_LLONG:     rec->arg[n].i = va_arg(ap, long long); break;
+		case LOG_ARG_LLONG + 16: rec->arg[n].i = va_arg(ap, long); type = LOG_ARG_LLONG; break;
+		case LOG_ARG_DBL:       rec->arg[n].d = va_arg(ap, double); break;
+		case LOG_ARG_PTR:       rec->arg[n].p = va_arg(ap, void*); break;
+		case LOG_ARG_STR: {
+			const char* s = va_arg(ap, const char*);
+			if (!s) s = "(null)";
+			len = strlen(s);
+			if (ns + len + 1 > LOG_STRLEN) return 0;
+			memcpy(rec->text + ns, s, len + 1);
+			rec->arg[n].s = (uint16_t)ns;
+			ns += len + 1;
+		} break;
+		}
+		rec->type[n++] = (uint8_t)type;
+	}
+	rec->narg = (uint8_t)n;
+	return 1;
+}
+
+/* format a binary record, the writer side of capture_args */
+static int format_rec(const log_rec_t* rec, char* buff, int size)
+{
+	const char* p = rec->fmt, *q;
+	char spec[40];
+	int n = 0, i = 0, nstar, k, star[2] = { 0 }, m;
+	while (*p && n < size - 1) {
+		if (*p != '%') { buff[n++] = *p++; continue; }
+		q = p + 1;
+		if (scan_spec(&q, &nstar) == -1) { buff[n++] = '%'; p = q; continue; }
+		for (k = 0; k < nstar; k++) star[k] = (int)rec->arg[i++].i;
+		/* spec with the length modifier rewritten for the stored type */
+		m = 0;
+		for (const char* s = p; s < q - 1 && m < (int)sizeof(spec) - 4; s++) {
+			if (strchr("hlLjzqt", *s) || (*s == 'I' && s[1] == '6')) { if (*s == 'I') s += 2; continue; }
+			spec[m++] = *s;
+		}
+		if (rec->type[i] == LOG_ARG_LLONG) { spec[m++] = 'l'; spec[m++] = 'l'; }
+		spec[m++] = q[-1]; spec[m] = '\0';
+		int rest = size - n;
+#define LOG_SPRINTF(v) (nstar == 2 ? snprintf(buff + n, rest, spec, star[0], star[1], v) : \
+		nstar == 1 ? snprintf(buff + n, rest, spec, star[0], v) : snprintf(buff + n, rest, spec, v))
+		switch (rec->type[i]) {
+		case LOG_ARG_INT:   k = LOG_SPRINTF((int)rec->arg[i].i); break;
+		case LOG_ARG_LLONG: k = LOG_SPRINTF(rec->arg[i].i); break;
+		case LOG_ARG_DBL:   k = LOG_SPRINTF(rec->arg[i].d); break;
+		case LOG_ARG_PTR:   k = LOG_SPRINTF(rec->arg[i].p); break;
+		default:            k = LOG_SPRINTF(rec->text + rec->arg[i].s); break;
+		}
+#undef LOG_SPRINTF
+		i++;
+		if (k < 0) break;
+		n += k < rest ? k : rest - 1;
+		p = q;
+	}
+	buff[n] = '\0';
+	return n;
+}
+
+static void write_rec(const log_rec_t* rec)
+{
+	char buff[4096];
+	FILE* fp;
+	if (rec->kind == LOG_REC_FLUSH) {
+		if (rec->file) fflush(rec->file);
+		return;
+	}
+	format_rec(rec, buff, sizeof(buff));
+	switch (rec->kind) {
+	case LOG_REC_SLOG:
+		printf("%*s%s \n", rec->tab, "", buff);
+		break;
+	case LOG_REC_TABLE:
+		fp = table_file ? table_file : stdout;
+		fprintf(fp, "%s \n", buff);
+		break;
+	case LOG_REC_TABLE_EX:
+		fprintf(rec->file ? rec->file : stdout, "%s \n", buff);
+		break;
+	case LOG_REC_FILE:
+		fputs(buff, rec->file);
+		break;
+	}
+}
+
+/* drain all rings once, returns number of records written */
+static int drain_rings()
+{
+	int n = 0;
+	std::vector<log_ring_t*> rings;
+	{
+		std::lock_guard<std::mutex> lock(s_ring_lock);
+		rings = s_rings;
+	}
+	for (size_t i = 0; i < rings.size(); i++) {
+		log_ring_t* r = rings[i];
+		size_t h = r->head.load(std::memory_order_relaxed);
+		size_t t = r->tail.load(std::memory_order_acquire);
+		for (; h != t; h++, n++) {
+			write_rec(&r->rec[h & (LOG_RING_SIZE - 1)]);
+			r->head.store(h + 1, std::memory_order_release);
+		}
+	}
+	return n;
+}
+
+static void writer_main()
+{
+	unsigned dropped = 0, d;
+	while (s_running.load(std::memory_order_acquire)) {
+		if (drain_rings() == 0) {
+			/* a producer may be waiting for space in its ring */
+			if (s_active.load(std::memory_order_relaxed) > 0) std::this_thread::yield();
+			else std::this_thread::sleep_for(std::chrono::milliseconds(LOG_IDLE_MS));
+		}
+		if ((d = s_dropped.load(std::memory_order_relaxed)) != dropped) {
+			fprintf(stderr, "log: %u records dropped\n", d - dropped);
+			dropped = d;
+		}
+	}
+	/* stopped: producers that saw the backend running still queue */
+	while (s_active.load() > 0) {
+		if (drain_rings() == 0) std::this_thread::yield();
+	}
+	drain_rings();
+}
+
+/* wait until at most n records of the ring are queued, the writer drains
+   until no producer is left in log_async_put */
+static void ring_wait(log_ring_t* r, size_t t, size_t n)
+{
+	while (t - r->head.load(std::memory_order_acquire) > n) {
+		std::this_thread::yield();
+	}
+}
+
+static int ring_put(int kind, FILE* file, int tab, const char* format, va_list* ap)
+{
+	log_ring_t* r = thread_ring();
+	if (!r) return 0;
+	size_t t = r->tail.load(std::memory_order_relaxed);
+	if (t - r->head.load(std::memory_order_acquire) >= LOG_RING_SIZE) {
+		/* output files are data, not diagnostics: never dropped */
+		if (kind != LOG_REC_FILE && kind != LOG_REC_FLUSH) {
+			s_dropped.fetch_add(1, std::memory_order_relaxed);
+			return 1;
+		}
+		ring_wait(r, t, LOG_RING_SIZE - 1);
+	}
+	log_rec_t* rec = &r->rec[t & (LOG_RING_SIZE - 1)];
+	rec->kind = (uint8_t)kind;
+	rec->file = file;
+	rec->tab = (uint8_t)(tab < 0 ? 0 : (tab > 127 ? 127 : tab));
+	rec->narg = 0;
+	rec->fmt = format;
+	if (format) {
+		va_list aq;
+		va_copy(aq, *ap);
+		int ok = capture_args(rec, format, aq);
+		va_end(aq);
+		if (!ok) return 0;
+	}
+	r->tail.store(t + 1, std::memory_order_release);
+	return 1;
+}
+
+/* queue a record, 0: not queued (caller writes synchronously) */
+extern "C" int log_async_put(int kind, FILE* file, int tab, const char* format, va_list* ap)
+{
+	int ret = 0;
+	if (s_running.load(std::memory_order_acquire)) {
+		s_active.fetch_add(1);
+		if (s_running.load()) ret = ring_put(kind, file, tab, format, ap);
+		s_active.fetch_sub(1);
+		if (ret) return ret;
+	}
+	/* written by the caller: the records the thread queued before go first */
+	if (t_owner.ring) ring_wait(t_owner.ring, t_owner.ring->tail.load(std::memory_order_relaxed), 0);
+	return 0;
+}
+
+/* start the writer, log_async_stop() is registered to run at exit so that a
+   host which never stops the backend does not exit with a joinable writer */
+extern "C" int log_async_start(void)
+{
+	if (s_running.exchange(1)) return 0;
+	try {
+		s_writer = std::thread(writer_main);
+	}
+	catch (...) {
+		s_running.store(0);
+		return -1;
+	}
+	if (!s_atexit.exchange(1)) atexit(log_async_stop);
+	return 0;
+}
+
+extern "C" void log_async_stop(void)
+{
+	if (!s_running.exchange(0)) return;
+	if (s_writer.joinable()) s_writer.join();
+}
+
+/* wait until every queued record is written, used before a file is closed */
+extern "C" void log_async_drain(void)
+{
+	int pending;
+	if (!s_running.load(std::memory_order_acquire)) return;
+	do {
+		pending = 0;
+		{
+			std::lock_guard<std::mutex> lock(s_ring_lock);
+			for (size_t i = 0; i < s_rings.size(); i++) {
+				if (s_rings[i]->head.load(std::memory_order_acquire) != s_rings[i]->tail.load(std::memory_order_acquire)) pending = 1;
+			}
+		}
+		if (pending) std::this_thread::sleep_for(std::chrono::milliseconds(LOG_IDLE_MS));
+	} while (pending && s_running.load(std::memory_order_acquire));
+}
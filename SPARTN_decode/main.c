@@ -1,80 +1,53 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "spartn.h"
 #include "log.h"
 #include "rinex.h"
 #include "ephemeris.h"
 #include "GenVRSObs.h"
 #include "model.h"
+#include "bench.h"
+#include "ssr_archive.h"
+#include "spartn_index.h"
+#include "vrs_batch.h"
+
+#ifdef _WIN32
+#define fseek64 _fseeki64
+#else
+#define fseek64 fseeko
+#endif
 
 #define SPARTN_2_RTCM
 //#define READ_RTCM
 //#define READ_RINEX
 
-int match_ssr_nav_iode(sap_ssr_t *sap_ssr, nav_t *nav)
-{
-	int i, j, ng = 0;
-	for (i = 0; i < nav->ns; i++)
-	{
-		int nav_iod = -1;
-		int sys = sap_ssr[i].sys;
-		if (sys == 0)
-		{
-			for (j = 0; j < nav->n; j++)
-			{
-				if (sap_ssr[i].prn == nav->eph[j].sat && sap_ssr[i].iod[0] == nav->eph[j].iode)
-				{
-					ng++;
-					break;
-				}
-			}
-		}
-		else if (sys == 1)
-		{
-			for (j = 0; j < nav->ng; j++)
-			{
-				if (sap_ssr[i].prn + 40 == nav->geph[j].sat && sap_ssr[i].iod[0] == nav->geph[j].iode)
-				{
-					ng++;
-					break;
-				}
-			}
-		}
-	}
-
-	double ratio = (double)ng / nav->ns;
-	if (ng >= 10 && ratio > 0.8)
-		return 1;
-	else
-		return 0;
-}
-
-int gga_ssr2osr_main(FILE *fSSR, FILE *fEPH, FILE *fRTCM, FILE *fLOG, double *ep, double *rovpos)
+/* fSSR != NULL: decode fSSR, appending to arch if not NULL,
+   fSSR == NULL: replay arch from the epoch at or before ep,
+   nsec > 0: output the window [ep, ep + nsec) only, earlier epochs warm up the corrections */
+int gga_ssr2osr_main(FILE *fSSR, FILE *fEPH, FILE *fRTCM, FILE *fLOG, double *ep, double *rovpos, double nsec, ssrarch_t *arch)
 {
 	gnss_rtcm_t rtcm = { 0 };
 	nav_t *nav = &rtcm.nav;
 	obs_t *rov = rtcm.obs;
-	obs_t obs_vrs = { 0.0 };
-	vec_t vec_vrs[MAXOBS] = { 0.0 };
 	gtime_t time0 = epoch2time(ep);
 	double cur_time = (int)time0.time;
 	int doy = time2doy(time0);
 	int year = ep[0];
 	set_approximate_time(year, doy, rtcm.rcv);
-	if (fSSR == NULL)  return 0;
+	if (fSSR == NULL && arch == NULL)  return 0;
 	if (fEPH == NULL)  return 0;
-#ifdef TABLE_LOG
-	open_ocb_table_file(NULL);
-	open_hpac_table_file(NULL);
-	open_gad_table_file(NULL);
-	open_lpac_table_file(NULL);
-#endif
+	if (!otl_grid_ready())
+	{
+		printf("no ocean tide loading grid, set a grid file first (type 13)\n");
+		return 0;
+	}
 	raw_spartn_t spartn;
 	memset(&spartn, 0, sizeof(spartn));
-	spartn_t spartn_out;
+	static spartn_t spartn_out;
 	memset(&spartn_out, 0, sizeof(spartn_t));
+	static rtcm_t out_rtcm;
+	memset(&out_rtcm, 0, sizeof(rtcm_t));
 	sap_ssr_t *sap_ssr  = &spartn_out.ssr;
-	gad_ssr_t *sap_gad  = &spartn_out.ssr_gad;
-    vtec_t    *sap_vtec = &spartn_out.vtec;
 
 	printf("spartn_t = %zd\n", sizeof(spartn_t));
 
@@ -87,25 +60,37 @@ int gga_ssr2osr_main(FILE *fSSR, FILE *fEPH, FILE *fRTCM, FILE *fLOG, double *ep
 	//printf("GAD_area_t = %zd\n", sizeof(GAD_area_t));
 	//printf("LPAC_area_t = %zd\n", sizeof(LPAC_area_t));
 
-	int i, j, nsat;
+	int i;
 	int rov_ret, ret_nav, num_ssr = -1;
 	double blh[3] = { 0.0 }, dr[3] = { 0.0 };
 	gtime_t teph = epoch2time(ep);
+	astro_t astro = { 0 };
 	double obs_time = 0.0;
 	int nc = 0;
+	int karch = (fSSR == NULL) ? ssrarch_find(arch, time0) : 0;
+	if (karch < 0) karch = 0;
 	while (1)
 	{
 		nav->ns = 0;
-		nav->nsys[0] = 0;
-		nav->nsys[1] = 0;
-		fread_ssr_sapcorda(fSSR, &spartn, &spartn_out, nav->nsys);
-		nav->ns = nav->nsys[0] + nav->nsys[1];
-		if (feof(fSSR)) break;
+		memset(nav->nsys, 0, sizeof(nav->nsys));
+		if (fSSR == NULL)
+		{
+			/* decoded state from the archive */
+			if (!ssrarch_read(arch, karch++, &spartn_out)) break;
+			ssr_count_sys(sap_ssr, nav->nsys);
+		}
+		else
+		{
+			fread_ssr_sapcorda(fSSR, &spartn, &spartn_out, nav->nsys);
+		}
+		for (i = 0; i < NSYSSSR; i++) nav->ns += nav->nsys[i];
+		if (fSSR != NULL && feof(fSSR)) break;
+		if (fSSR != NULL && arch != NULL) ssrarch_append(arch, &spartn_out);
 		int epffEPH = 0;
 		while (1)
 		{
 			/* read broadcast eph data one byte */
-			ret_nav = fread_eph_rtcm(fEPH, &rtcm, nav->nsys[0], nav->nsys[1]);
+			ret_nav = fread_eph_rtcm(fEPH, &rtcm, nav->nsys);
 			if (ret_nav != 2)
 			{
 				/* can not find the complete epoch data */
@@ -122,89 +107,16 @@ int gga_ssr2osr_main(FILE *fSSR, FILE *fEPH, FILE *fRTCM, FILE *fLOG, double *ep
 		}
 		if (epffEPH == 1) break;
 
-		for (i = 0; i < spartn_out.ssr_offset; i++)
+		if (nsec > 0.0)
 		{
-			if (sap_ssr[i].t0[0] > 0.0) nav->ns++;
+			double dt = sap_ssr[0].t0[1] - fmod((double)time0.time, DAY_SECONDS);
+			if (dt < -DAY_SECONDS / 2) dt += DAY_SECONDS;
+			else if (dt > DAY_SECONDS / 2) dt -= DAY_SECONDS;
+			if (dt < 0.0) continue;
+			if (dt >= nsec) break;
 		}
-		for (i = 0; i < nav->ns; i++)
-		{
-			int nav_iod = -1;
-			int sys = sap_ssr[i].sys;
-			if (sys == 0)
-			{
-				for (j = 0; j < nav->n; j++)
-				{
-					if (sap_ssr[i].prn == nav->eph[j].sat)
-					{
-						nav_iod = nav->eph[j].iode;
-						break;
-					}
-				}
-			}
-			else if (sys == 1)
-			{
-				for (j = 0; j < nav->ng; j++)
-				{
-					if (sap_ssr[i].prn + 40 == nav->geph[j].sat)
-					{
-						nav_iod = nav->geph[j].iode;
-						break;
-					}
-				}
-			}
-			if (nav_iod != sap_ssr[i].iod[0]) continue;
-			double nav_toe = (sys == 0) ? fmod(nav->eph[j].toe.time, 86400) : fmod(nav->geph[j].toe.time, 86400);
-			fprintf(fLOG, "ocb:%6.0f,%6.0f,%6.0f,%6.0f,%6.0f,%3i,%3i,%2i,%3i,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f\n",
-				sap_ssr[i].t0[0], sap_ssr[i].t0[1], sap_ssr[i].t0[2], sap_ssr[i].t0[4], nav_toe, nav_iod, sap_ssr[i].iod[0], sys, sap_ssr[i].prn,
-				sap_ssr[i].deph[0], sap_ssr[i].deph[1], sap_ssr[i].deph[2], sap_ssr[i].dclk,
-				sap_ssr[i].cbias[0], sap_ssr[i].cbias[1], sap_ssr[i].cbias[2], sap_ssr[i].pbias[0], sap_ssr[i].pbias[1], sap_ssr[i].pbias[2]);
-		}
-
-        for (i = 0; i < AREA_NUM; i++)
-        {
-            if (sap_vtec[i].time == 0.0) continue;
-            fprintf(fLOG, "vtec:%6.0f,%3d,%4i,%4i,%3i,%3i,%6.2f,%6.2f,%6.2f\n",
-                sap_vtec[i].time, sap_vtec[i].areaId, sap_vtec[i].rap_lat, sap_vtec[i].rap_lon,  sap_vtec[i].nc_lat, sap_vtec[i].nc_lon,
-                sap_vtec[i].spa_lat, sap_vtec[i].spa_lon, sap_vtec[i].avg_vtec);
-            int nres = sap_vtec[i].nc_lon*sap_vtec[i].nc_lat;
-            fprintf(fLOG, "vtec:");
-            for (j = 0; j < nres; j++)
-                fprintf(fLOG, j<nres-1 ? "%6.2f,": "%6.2f", sap_vtec[i].residual[j]);
-            fprintf(fLOG, "\n");
-        }
 
-		while (1)
-		{
-			int time = teph.time;
-			double time1 = fmod((double)time, DAY_SECONDS);
-			if (time1 - sap_ssr[0].t0[1] < 20.0 && time1>sap_ssr[0].t0[1])
-				break;
-
-			teph = timeadd(teph, 1.0);
-		}
-		memset(&obs_vrs, 0, sizeof(obs_vrs));
-
-		nsat = satposs_sap_rcv(teph, rovpos, vec_vrs, nav, sap_ssr, EPHOPT_SSRSAP);
-		obs_vrs.time = teph;
-		obs_vrs.n = nsat;
-		memcpy(obs_vrs.pos, rovpos, 3 * sizeof(double));
-		for (i = 0; i < nsat; i++)
-		{
-			obs_vrs.data[i].sat = vec_vrs[i].sat;
-		}
-		nsat = compute_vector_data(&obs_vrs, vec_vrs);
-		if (nsat == 0)  continue;
-
-        int vrs_ret = gen_obs_from_ssr(teph, rovpos, sap_ssr, sap_gad, sap_vtec, &obs_vrs, vec_vrs, 0.0, fLOG);
-
-		rtcm_t out_rtcm = { 0 };
-		unsigned char buffer[1200] = { 0 };
-		int len = gen_rtcm_vrsdata(&obs_vrs, &out_rtcm, buffer);
-		fwrite(buffer, 1, len, fRTCM);
-
-		//obs_t obs_test = { 0 };
-		//decode_rtcm3(&out_rtcm, &obs_test, NULL);
-		nc++;
+		if (gen_vrs_epoch(&teph, rovpos, &astro, &out_rtcm, nav, &spartn_out, nav->ns, fRTCM, fLOG) > 0) nc++;
 	}
 	return 0;
 }
@@ -230,6 +142,43 @@ void correction_diff(FILE *fCOR, FILE *fLOG, FILE *fDIF)
 
 }
 
+typedef struct {            /* stations of consecutive type 0 lines in batch mode */
+    int nthread;            /* worker threads (0: number of cores), <0: batch mode off */
+    char ssr[255];          /* ssr and eph files and start time shared by the stations */
+    char eph[255];
+    double ep[6];
+    vrs_station_t *sta;     /* queued stations */
+    int n, nmax;
+} vrs_queue_t;
+
+static void vrs_queue_flush(vrs_queue_t *q)
+{
+    if (q->n > 0 && vrs_batch(q->ssr, q->eph, q->ep, q->sta, q->n, q->nthread) < 0)
+        printf("batch error: %s, %s\n", q->ssr, q->eph);
+    q->n = 0;
+}
+
+/* queue a station, the queue is run first if the station needs other streams */
+static int vrs_queue_add(vrs_queue_t *q, const char *ssr, const char *eph, const double *ep, const char *rtcm, const char *log, const double *pos)
+{
+    vrs_station_t *p;
+    if (q->n > 0 && (strcmp(q->ssr, ssr) || strcmp(q->eph, eph) || memcmp(q->ep, ep, sizeof(q->ep)))) vrs_queue_flush(q);
+    if (q->n >= q->nmax) {
+        q->nmax = q->nmax <= 0 ? 64 : q->nmax * 2;
+        if (!(p = (vrs_station_t *)realloc(q->sta, sizeof(vrs_station_t)*q->nmax))) return 0;
+        q->sta = p;
+    }
+    snprintf(q->ssr, sizeof(q->ssr), "%s", ssr);
+    snprintf(q->eph, sizeof(q->eph), "%s", eph);
+    memcpy(q->ep, ep, sizeof(q->ep));
+    memset(q->sta + q->n, 0, sizeof(vrs_station_t));
+    snprintf(q->sta[q->n].rtcm, sizeof(q->sta[q->n].rtcm), "%s", rtcm);
+    snprintf(q->sta[q->n].log, sizeof(q->sta[q->n].log), "%s", log);
+    memcpy(q->sta[q->n].pos, pos, sizeof(q->sta[q->n].pos));
+    q->n++;
+    return 1;
+}
+
 int process(const char *fname, const char *root_dir)
 {
     FILE *fSSR = { NULL };
@@ -242,12 +191,16 @@ int process(const char *fname, const char *root_dir)
     char fname2[255] = { 0 };
     char fname3[255] = { 0 };
     char fname4[255] = { 0 };
+    char fname5[255] = { 0 };
     char inp_dir[255] = { 0 };
     char out_dir[255] = { 0 };
     int year = 0, doy = 0, line = 0, type = 0, isPrint = 0, isObs = 0, num = 0;
     double ep[6] = { 0 };
     double rovpos[3] = { 0.0 };
     double refpos[3] = { 0.0 };
+    vrs_queue_t queue;
+    memset(&queue, 0, sizeof(queue));
+    queue.nthread = -1;
     if (root_dir) {
         strncpy(inp_dir, root_dir, strlen(root_dir));
     }
@@ -262,13 +215,43 @@ int process(const char *fname, const char *root_dir)
         memset(fname2, 0, sizeof(fname2));
         memset(fname3, 0, sizeof(fname3));
         memset(fname4, 0, sizeof(fname4));
+        memset(fname5, 0, sizeof(fname5));
         year = 0;
         doy = 0;
         type = 0;
         num = sscanf(buffer, "%i", &type);
-        num = sscanf(buffer, "%i", &type);
+        if (type != 0) vrs_queue_flush(&queue);
         switch (type) {
         case 0: /* RTK data process */
+        {
+            strncpy(fname1, inp_dir, strlen(inp_dir));
+            strncpy(fname2, inp_dir, strlen(inp_dir));
+            strncpy(fname3, inp_dir, strlen(inp_dir));
+            strncpy(fname4, inp_dir, strlen(inp_dir));
+            strncpy(fname5, inp_dir, strlen(inp_dir));
+            num = sscanf(buffer, "%i,%[^\,],%[^\,],%[^\,],%[^\,],%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%[^\,\r\n]", &type, fname1 + strlen(inp_dir), fname2 + strlen(inp_dir), fname3 + strlen(inp_dir), fname4 + strlen(inp_dir),
+                &refpos[0], &refpos[1], &refpos[2], &ep[0], &ep[1], &ep[2], &ep[3], &ep[4], &ep[5], fname5 + strlen(inp_dir));
+            if (queue.nthread >= 0 && num < 15)
+            {
+                vrs_queue_add(&queue, fname1, fname2, ep, fname3, fname4, refpos);
+                break;
+            }
+            fSSR = fopen(fname1, "rb");
+            fEPH = fopen(fname2, "rb");
+            FILE * fRTCM_OUT = fopen(fname3, "wb");
+            FILE * fLOG = fopen(fname4, "wb");
+            ssrarch_t *arch = NULL;
+            if (num == 15) {
+                char idx[sizeof(fname5) + 8];
+                snprintf(idx, sizeof(idx), "%s.idx", fname5);
+                remove(idx); /* a fresh archive, not continued */
+                arch = ssrarch_create(fname5, epoch2time(ep));
+            }
+            gga_ssr2osr_main(fSSR, fEPH, fRTCM_OUT, fLOG, ep, refpos, 0.0, arch);
+            ssrarch_close(arch);
+
+        }break;
+        case 9: /* RTK data process, corrections replayed from an archive of case 0 */
         {
             strncpy(fname1, inp_dir, strlen(inp_dir));
             strncpy(fname2, inp_dir, strlen(inp_dir));
@@ -276,13 +259,58 @@ int process(const char *fname, const char *root_dir)
             strncpy(fname4, inp_dir, strlen(inp_dir));
             num = sscanf(buffer, "%i,%[^\,],%[^\,],%[^\,],%[^\,],%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf", &type, fname1 + strlen(inp_dir), fname2 + strlen(inp_dir), fname3 + strlen(inp_dir), fname4 + strlen(inp_dir),
                 &refpos[0], &refpos[1], &refpos[2], &ep[0], &ep[1], &ep[2], &ep[3], &ep[4], &ep[5]);
+            ssrarch_t *arch = ssrarch_open(fname1);
+            fEPH = fopen(fname2, "rb");
+            FILE * fRTCM_OUT = fopen(fname3, "wb");
+            FILE * fLOG = fopen(fname4, "wb");
+            gga_ssr2osr_main(NULL, fEPH, fRTCM_OUT, fLOG, ep, refpos, 0.0, arch);
+            ssrarch_close(arch);
+
+        }break;
+        case 10: /* RTK data process on a time window, ssr file seeked with its frame index */
+        {
+            double nsec = 0.0;
+            spartn_index_t sidx;
+            strncpy(fname1, inp_dir, strlen(inp_dir));
+            strncpy(fname2, inp_dir, strlen(inp_dir));
+            strncpy(fname3, inp_dir, strlen(inp_dir));
+            strncpy(fname4, inp_dir, strlen(inp_dir));
+            num = sscanf(buffer, "%i,%[^\,],%[^\,],%[^\,],%[^\,],%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf", &type, fname1 + strlen(inp_dir), fname2 + strlen(inp_dir), fname3 + strlen(inp_dir), fname4 + strlen(inp_dir),
+                &refpos[0], &refpos[1], &refpos[2], &ep[0], &ep[1], &ep[2], &ep[3], &ep[4], &ep[5], &nsec);
             fSSR = fopen(fname1, "rb");
+            if (fSSR != NULL && spartn_index_open(fname1, &sidx) > 0)
+            {
+                int k = spartn_index_warm(&sidx, fmod((double)epoch2time(ep).time, DAY_SECONDS), SIDX_WARM_AGE);
+                if (k >= 0 && fseek64(fSSR, (long long)sidx.entry[k].off, SEEK_SET))
+                {
+                    printf("seek error: %s, decoded from the start\n", fname1);
+                    rewind(fSSR);
+                }
+                spartn_index_free(&sidx);
+            }
             fEPH = fopen(fname2, "rb");
             FILE * fRTCM_OUT = fopen(fname3, "wb");
             FILE * fLOG = fopen(fname4, "wb");
-            gga_ssr2osr_main(fSSR, fEPH, fRTCM_OUT, fLOG, ep, refpos);
+            gga_ssr2osr_main(fSSR, fEPH, fRTCM_OUT, fLOG, ep, refpos, nsec, NULL);
 
         }break;
+        case 11: /* batch mode for the following type 0 lines */
+        {
+            num = sscanf(buffer, "%i,%i", &type, &queue.nthread);
+            if (num < 2) queue.nthread = 0;
+        }break;
+        case 12: /* RTK data process of one station in time chunks run in parallel */
+        {
+            int nchunk = 0, nthread = 0;
+            strncpy(fname1, inp_dir, strlen(inp_dir));
+            strncpy(fname2, inp_dir, strlen(inp_dir));
+            strncpy(fname3, inp_dir, strlen(inp_dir));
+            strncpy(fname4, inp_dir, strlen(inp_dir));
+            num = sscanf(buffer, "%i,%[^\,],%[^\,],%[^\,],%[^\,],%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%i,%i", &type, fname1 + strlen(inp_dir), fname2 + strlen(inp_dir), fname3 + strlen(inp_dir), fname4 + strlen(inp_dir),
+                &refpos[0], &refpos[1], &refpos[2], &ep[0], &ep[1], &ep[2], &ep[3], &ep[4], &ep[5], &nchunk, &nthread);
+            if (vrs_chunked(fname1, fname2, ep, refpos, fname3, fname4, nchunk, nthread) < 0)
+                printf("chunked error: %s, %s\n", fname1, fname2);
+        }break;
         case 1: /* RTK data process */
         {
             gnss_rtcm_t rtcm = { 0 };
@@ -294,10 +322,9 @@ int process(const char *fname, const char *root_dir)
             while (1)
             {
                 nav->ns = 0;
-                nav->nsys[0] = 0;
-                nav->nsys[1] = 0;
+                memset(nav->nsys, 0, sizeof(nav->nsys));
                 /* read broadcast eph data one byte */
-                int ret_nav = fread_eph_rtcm(fEPH, &rtcm, nav->nsys[0], nav->nsys[1]);
+                int ret_nav = fread_eph_rtcm(fEPH, &rtcm, nav->nsys);
                 if (ret_nav != 2)
                 {
                     /* can not find the complete epoch data */
@@ -305,6 +332,46 @@ int process(const char *fname, const char *root_dir)
                 }
             }
 
+        }break;
+        case 5: /* benchmark on recorded data */
+        {
+            int nloop = 1;
+            strncpy(fname1, inp_dir, strlen(inp_dir));
+            strncpy(fname2, inp_dir, strlen(inp_dir));
+            strncpy(fname3, inp_dir, strlen(inp_dir));
+            num = sscanf(buffer, "%i,%[^\,],%[^\,],%[^\,],%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%i", &type, fname1 + strlen(inp_dir), fname2 + strlen(inp_dir), fname3 + strlen(inp_dir),
+                &refpos[0], &refpos[1], &refpos[2], &ep[0], &ep[1], &ep[2], &ep[3], &ep[4], &ep[5], &nloop);
+            FILE * fOUT = fopen(fname3, "w");
+            bench_file(fname1, fname2, ep, refpos, nloop > 0 ? nloop : 1, fOUT);
+            if (fOUT) fclose(fOUT);
+        }break;
+        case 51: /* benchmark on synthetic data */
+        {
+            int nsat = 12, narea = 4, nsec = 3600, nrov = 1;
+            strncpy(fname1, inp_dir, strlen(inp_dir));
+            strncpy(fname2, inp_dir, strlen(inp_dir));
+            num = sscanf(buffer, "%i,%[^\,],%[^\,],%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%i,%i,%i,%i", &type, fname1 + strlen(inp_dir), fname2 + strlen(inp_dir),
+                &refpos[0], &refpos[1], &refpos[2], &ep[0], &ep[1], &ep[2], &ep[3], &ep[4], &ep[5], &nsat, &narea, &nsec, &nrov);
+            FILE * fOUT = fopen(fname2, "w");
+            bench_sim(fname1, ep, refpos, nsat, narea, nsec, nrov > 0 ? nrov : 1, fOUT);
+            if (fOUT) fclose(fOUT);
+        }break;
+        case 13: /* ocean tide loading grid file, used instead of the builtin grid */
+        {
+            strncpy(fname1, inp_dir, strlen(inp_dir));
+            num = sscanf(buffer, "%i,%[^,\r\n]", &type, fname1 + strlen(inp_dir));
+            if (!otl_grid_open(fname1)) printf("otl grid open error: %s\n", fname1);
+        }break;
+        case 14: /* write the builtin ocean tide loading grid to a grid file */
+        {
+            int gtype = OTL_GRID_INT16;
+            strncpy(fname1, inp_dir, strlen(inp_dir));
+            num = sscanf(buffer, "%i,%[^,\r\n],%i", &type, fname1 + strlen(inp_dir), &gtype);
+#ifndef OTL_NO_BUILTIN_GRID
+            if (!otl_grid_write(fname1, gtype)) printf("otl grid write error: %s\n", fname1);
+#else
+            printf("otl grid write error: no builtin grid\n");
+#endif
         }break;
         case 4: /* input directory, effective after this command */
         {
@@ -330,12 +397,17 @@ int process(const char *fname, const char *root_dir)
         }
         ++line;
     }
+    vrs_queue_flush(&queue);
+    free(queue.sta);
     if (fINI != NULL) fclose(fINI);
     return 0;
 }
 
 int main()
 {
+    log_config(getenv("SPARTN_LOG"));
+    log_async_start();
     process("..\\data.ini", NULL);
+    log_async_stop();
     return 0;
 }
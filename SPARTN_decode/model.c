@@ -598,4 +598,137 @@ int print_nmea_gst(double *ep, float *var_llh, char *buff)
 	p += sprintf(p, "*%02X%c%c", sum, 0x0D, 0x0A);
 
 	return p - (char *)buff;
-}
\ No newline at end of file
+}
+
+/* NMEA fixed-point field: digits with optional sign and decimals, returns
+ * number of decimals (-1: empty or malformed), value = *mant / 10^ndec */
+static int nmea_fixed(const char *p, const char *end, int64_t *mant)
+{
+	int sign = 1, ndec = -1, ndig = 0;
+	int64_t m = 0;
+
+	if (p < end && (*p == '-' || *p == '+')) sign = *p++ == '-' ? -1 : 1;
+	for (; p < end; p++)
+	{
+		if (*p == '.' && ndec < 0) { ndec = 0; continue; }
+		if (*p < '0' || *p > '9' || ndig >= 18) return -1;
+		m = m * 10 + (*p - '0');
+		ndig++;
+		if (ndec >= 0) ndec++;
+	}
+	if (ndig == 0) return -1;
+	*mant = sign * m;
+	return ndec < 0 ? 0 : ndec;
+}
+
+static double nmea_pow10(int n)
+{
+	static const double p10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+		1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+	return p10[n];
+}
+
+/* (d)ddmm.mmmm to degree, integer degrees and minutes split before scaling */
+static int nmea_dmm(const char *p, const char *end, double *deg)
+{
+	int64_t m, unit;
+	int ndec = nmea_fixed(p, end, &m);
+	if (ndec < 0 || m < 0 || ndec > 12) return 0;
+	unit = (int64_t)nmea_pow10(ndec);
+	*deg = (double)(m / (100 * unit)) + (double)(m % (100 * unit)) / (60.0 * unit);
+	return 1;
+}
+
+static int nmea_num(const char *p, const char *end, double *val)
+{
+	int64_t m;
+	int ndec = nmea_fixed(p, end, &m);
+	if (ndec < 0) return 0;
+	*val = (double)m / nmea_pow10(ndec);
+	return 1;
+}
+
+static int nmea_hex(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+/* decode NMEA GGA -------------------------------------------------------------
+* decode a $--GGA sentence (GPGGA, GNGGA, ...) in place without allocation
+* args   : char   *buff     I   sentence, terminated by '\0', CR or LF
+*          nmea_gga_t *gga  O   decoded fields
+* return : 1: ok, NMEA_ERR_FORMAT, NMEA_ERR_CHECKSUM or NMEA_ERR_FIELD
+* notes  : the checksum is verified when present. pos[2] is the ellipsoidal
+*          height, altitude plus geoid separation
+*-----------------------------------------------------------------------------*/
+extern int decode_nmea_gga(const char *buff, nmea_gga_t *gga)
+{
+	const char *fld[NMEA_GGA_NFLD], *end[NMEA_GGA_NFLD], *p;
+	unsigned char sum = 0;
+	double lat, lon, alt, sep = 0.0, val;
+	int n = 0, hi, lo;
+
+	if (!buff || buff[0] != '$') return NMEA_ERR_FORMAT;
+
+	/* header $ttGGA, talker is any two upper case letters */
+	if (buff[1] < 'A' || buff[1] > 'Z' || buff[2] < 'A' || buff[2] > 'Z' ||
+		strncmp(buff + 3, "GGA,", 4) != 0) return NMEA_ERR_FORMAT;
+
+	/* split fields and accumulate the checksum in one pass */
+	fld[n++] = buff + 1;
+	for (p = buff + 1; *p && *p != '*' && *p != '\r' && *p != '\n'; p++)
+	{
+		sum ^= (unsigned char)*p;
+		if (*p != ',' || n > NMEA_GGA_NFLD) continue;
+		end[n - 1] = p;
+		if (n < NMEA_GGA_NFLD) fld[n] = p + 1;
+		n++;
+	}
+	if (n > NMEA_GGA_NFLD) n = NMEA_GGA_NFLD;
+	else end[n - 1] = p;
+	if (*p == '*')
+	{
+		if ((hi = nmea_hex(p[1])) < 0 || (lo = nmea_hex(p[2])) < 0) return NMEA_ERR_CHECKSUM;
+		if (((hi << 4) | lo) != sum) return NMEA_ERR_CHECKSUM;
+	}
+	if (n < 12) return NMEA_ERR_FORMAT;
+
+#define NMEA_FLD(i) fld[i], end[i]
+
+	memset(gga, 0, sizeof(nmea_gga_t));
+	if (!nmea_dmm(NMEA_FLD(2), &lat) || !nmea_dmm(NMEA_FLD(4), &lon) ||
+		!nmea_num(NMEA_FLD(9), &alt)) return NMEA_ERR_FIELD;
+	if (end[3] - fld[3] != 1 || (*fld[3] != 'N' && *fld[3] != 'S')) return NMEA_ERR_FIELD;
+	if (end[5] - fld[5] != 1 || (*fld[5] != 'E' && *fld[5] != 'W')) return NMEA_ERR_FIELD;
+	nmea_num(NMEA_FLD(11), &sep);
+
+	if (nmea_num(NMEA_FLD(1), &val))
+	{
+		int hms = (int)(val / 100.0);
+		gga->tod = (hms / 100) * 3600.0 + (hms % 100) * 60.0 + (val - hms * 100.0);
+	}
+	if (nmea_num(NMEA_FLD(6), &val)) gga->quality = (int)val;
+	if (nmea_num(NMEA_FLD(7), &val)) gga->nsat = (int)val;
+	nmea_num(NMEA_FLD(8), &gga->hdop);
+	if (n > 13) nmea_num(NMEA_FLD(13), &gga->age);
+
+	gga->pos[0] = (*fld[3] == 'S' ? -lat : lat) * D2R;
+	gga->pos[1] = (*fld[5] == 'W' ? -lon : lon) * D2R;
+	gga->pos[2] = alt + sep;
+#undef NMEA_FLD
+	return 1;
+}
+
+extern const char *nmea_errmsg(int ret)
+{
+	switch (ret)
+	{
+	case NMEA_ERR_FORMAT:   return "not a GGA sentence";
+	case NMEA_ERR_CHECKSUM: return "checksum error";
+	case NMEA_ERR_FIELD:    return "invalid position field";
+	}
+	return "";
+}
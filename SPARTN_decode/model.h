@@ -29,6 +29,24 @@ void deg2dms(double deg, double *dms, int ndec);
 int print_nmea_gga(double *ep, double *xyz, int nsat, int type, double dop, double age, char *buff);
 int print_nmea_gst(double *ep, float* var_llh, char* buff);
 
+/* input NMEA GGA */
+#define NMEA_GGA_NFLD      15       /* fields of GGA including the header */
+#define NMEA_ERR_FORMAT    -1       /* not a GGA sentence or too few fields */
+#define NMEA_ERR_CHECKSUM  -2       /* checksum mismatch */
+#define NMEA_ERR_FIELD     -3       /* empty or malformed position field */
+
+typedef struct {
+	double tod;                     /* utc time of day (s) */
+	double pos[3];                  /* latitude, longitude (rad), ellipsoidal height (m) */
+	int    quality;                 /* fix quality */
+	int    nsat;                    /* satellites in use */
+	double hdop;                    /* horizontal dilution of precision */
+	double age;                     /* age of differential corrections (s) */
+} nmea_gga_t;
+
+int decode_nmea_gga(const char *buff, nmea_gga_t *gga);
+const char *nmea_errmsg(int ret);
+
 #ifdef __cplusplus
 }
 #endif
@@ -408,22 +408,13 @@ void adjday_glot(gtime_t *time, double tod)
     *time = utc2gpst(timeadd(*time, -10800.0));
 }
 
-extern void trace(int level, const char *format, ...)
+extern void trace_out(int level, const char *format, ...)
 {
-#ifdef _TRACE_
     va_list ap;
 
-    char buffer[255];
-
-    if (level > 4)
-    {
-        va_start(ap, format);
-        vsprintf(buffer, format, ap);
-        va_end(ap);
-        printf("%s", buffer);
-        //OutputDebugString(buffer);
-    }
-#endif
+    va_start(ap, format);
+    if (!log_async_put(LOG_REC_FILE, stdout, 0, format, &ap)) vprintf(format, ap);
+    va_end(ap);
 }
 
 #ifdef QT_QML_DEBUG
@@ -542,16 +533,24 @@ int rtcm_getbits(const unsigned char *buff, int pos, int len)
 *-----------------------------------------------------------------------------*/
 void setbitu(unsigned char *buff, int pos, int len, unsigned int data)
 {
-    unsigned int mask = 1u << (len - 1);
-    int i;
+    unsigned char *p = buff + pos / 8;
+    unsigned int mask;
+    int n = 8 - pos % 8; /* bits left in the current byte */
     if (len <= 0 || 32 < len)
         return;
-    for (i = pos; i < pos + len; i++, mask >>= 1)
+    /* write by byte, keeping the bits outside the field */
+    while (len >= n)
     {
-        if (data & mask)
-            buff[i / 8] |= 1u << (7 - i % 8);
-        else
-            buff[i / 8] &= ~(1u << (7 - i % 8));
+        len -= n;
+        mask = (1u << n) - 1;
+        *p = (unsigned char)((*p & ~mask) | ((data >> len) & mask));
+        p++;
+        n = 8;
+    }
+    if (len > 0)
+    {
+        mask = ((1u << len) - 1) << (n - len);
+        *p = (unsigned char)((*p & ~mask) | ((data << (n - len)) & mask));
     }
 }
 void setbits(unsigned char *buff, int pos, int len, int data)
@@ -795,7 +794,7 @@ static char codepris[7][MAXFREQ][16] = {
 
     {"CPYWMNSL", "PYWCMNDSLX", "IQX", "", "", "", ""}, /* GPS 1:L1, 2:L2, 3:L5 */
     {"PC", "PC", "IQX", "", "", "", ""},               /* GLO 1:G1, 2:G2, 3:G3 */
-    {"ABXZ", "IQX", "IQX", "IQX", "ABCXZ", "", ""},    /* GAL 1:E1, 2:E5b, 3:E5a, 4:E5(a+b), 5:E6 */
+    {"CABXZ", "IQX", "IQX", "IQX", "ABCXZ", "", ""},   /* GAL 1:E1, 2:E5b, 3:E5a, 4:E5(a+b), 5:E6 */
     {"CSLXZ", "SLX", "IQX", "SLX", "", "", ""},        /* QZS 1:L1, 2:L2, 3:L5, 4:LEX */
     {"C", "IQX", "", "", "", "", ""},                  /* SBS 1:L1, 2:L5 */
     {"IQX", "IQX", "IQX", "", "", "", ""},             /* BDS 1:B1, 2:B3, 3:B2 */
@@ -2503,7 +2502,7 @@ static int decode_type1045(rtcm_t *rtcm, nav_t *nav)
 {
     eph_t eph = {0};
     double toc, sqrtA, ws;
-    int i = 24 + 12, prn, sat, week, e5a_hs, e5a_dvs, rsv, sys = _SYS_GAL_, wk;
+    int i = 24 + 12, prn, sat, week, e5a_hs, e5a_dvs, sys = _SYS_GAL_, wk;
 
     if (i + 484 <= rtcm->len * 8)
     {
@@ -2561,7 +2560,7 @@ static int decode_type1045(rtcm_t *rtcm, nav_t *nav)
         i += 2; /* OSHS */
         e5a_dvs = rtcm_getbitu(rtcm->buff, i, 1);
         i += 1; /* OSDVS */
-        rsv = rtcm_getbitu(rtcm->buff, i, 7);
+        i += 7; /* reserved */
     }
     else
     {
@@ -2701,8 +2700,8 @@ static int decode_type1046(rtcm_t *rtcm, nav_t *nav)
 static int decode_type1042(rtcm_t *rtcm, nav_t *nav)
 {
     eph_t eph = {0};
-    double toc, sqrtA, ws;
-    int i = 24 + 12, prn, sat, week, sys = _SYS_BDS_, wk;
+    double toc, sqrtA;
+    int i = 24 + 12, prn, sat, week, sys = _SYS_BDS_;
 
     if (i + 499 <= rtcm->len * 8)
     {
@@ -2785,6 +2784,7 @@ static int decode_type1042(rtcm_t *rtcm, nav_t *nav)
     eph.toc = bdt2gpst(bdt2time(eph.week, toc));      /* bdt -> gpst */
     eph.ttr = rtcm->time;
     eph.A = sqrtA * sqrtA;
+    eph.iode = (int)fmod(eph.toes / 720.0, 240.0); /* iode of bds ssr: toe/720 mod 240 */
 
     if (add_eph(&eph, nav) == 1)
 		++nav->n_bds;
@@ -4850,6 +4850,156 @@ extern int input_rtcm3(unsigned char data, unsigned int stnID, gnss_rtcm_t *gnss
     return ret;
 }
 
+/* decode rtcm3 navigation frame -----------------------------------------------
+* check parity of a complete frame in place and decode it if it is an
+* ephemeris message. only ephemeris frames are moved to the message buffer
+* args   : rtcm_t *rtcm     IO  rtcm control struct
+*          unsigned char *frame I frame starting at the preamble
+*          int    len       I   frame length without parity (bytes)
+*          nav_t  *nav      IO  navigation data
+* return : status (-1: parity error, 0: no message, 2: input ephemeris)
+*-----------------------------------------------------------------------------*/
+static int decode_rtcm3_nav(rtcm_t *rtcm, const unsigned char *frame, int len, nav_t *nav)
+{
+    unsigned int crc = ((unsigned int)frame[len] << 16) | ((unsigned int)frame[len + 1] << 8) | frame[len + 2];
+    int type = (frame[3] << 4) | (frame[4] >> 4);
+
+    if (rtk_crc24q(frame, len) != crc)
+    {
+        trace(2, "rtcm3 parity error: len=%d\n", len);
+        return -1;
+    }
+    rtcm->type = type;
+    switch (type)
+    {
+    case 63:
+    case 1019:
+    case 1020:
+    case 1042:
+    case 1044:
+    case 1045:
+    case 1046:
+        break;
+    default:
+        return 0;
+    }
+    if (frame != rtcm->buff)
+    {
+        memcpy(rtcm->buff, frame, len + 3);
+    }
+    rtcm->len = len;
+    return decode_rtcm3(rtcm, NULL, nav);
+}
+
+/* input rtcm3 navigation messages from buffer ----------------------------------
+* scan a block of rtcm3 data for frames and decode the ephemeris messages
+* (1019,1020,1042,1044,1045,1046)
+* args   : rtcm_t *rtcm     IO  rtcm control struct
+*          unsigned char *data I rtcm3 data
+*          int    len       I   data length (bytes)
+*          nav_t  *nav      IO  navigation data
+*          int    *nused    O   number of bytes used
+* return : status (0: no message, 2: input ephemeris)
+* notes  : frames are found by preamble and length and checked by crc-24q in
+*          the input buffer, other messages are skipped without copy. on a
+*          parity error the scan resyncs at the byte after the preamble.
+*          a frame split across blocks is kept in the message buffer as by
+*          input_rtcm3_data() and completed by the next call, if it fails
+*          the resync starts in the kept bytes.
+*          the scan returns after the first ephemeris, call again with
+*          data+*nused for the rest of the block.
+*-----------------------------------------------------------------------------*/
+extern int input_rtcm3_nav(rtcm_t *rtcm, const unsigned char *data, int len, nav_t *nav, int *nused)
+{
+    const unsigned char *p = data, *end = data + len;
+    unsigned int i, nold;
+    int n = 0, ret = 0;
+
+    rtcm->type = 0;
+
+    /* complete the frame carried over from the last block */
+    while (rtcm->nbyte > 0)
+    {
+        nold = rtcm->nbyte;
+        p = data;
+        if (rtcm->nbyte < 3)
+        {
+            n = MIN(3 - (int)rtcm->nbyte, (int)(end - p));
+            memcpy(rtcm->buff + rtcm->nbyte, p, n);
+            rtcm->nbyte += n;
+            p += n;
+            if (rtcm->nbyte < 3)
+            {
+                *nused = len;
+                return 0;
+            }
+        }
+        rtcm->len = (((rtcm->buff[1] & 0x3) << 8) | rtcm->buff[2]) + 3;
+        if (!(rtcm->buff[1] & 0xFC))
+        {
+            n = MIN((int)(rtcm->len + 3 - rtcm->nbyte), (int)(end - p));
+            memcpy(rtcm->buff + rtcm->nbyte, p, n);
+            rtcm->nbyte += n;
+            p += n;
+            if (rtcm->nbyte < rtcm->len + 3)
+            {
+                *nused = len;
+                return 0;
+            }
+            if ((ret = decode_rtcm3_nav(rtcm, rtcm->buff, rtcm->len, nav)) >= 0)
+            {
+                rtcm->nbyte = 0;
+                if (ret == 2)
+                {
+                    *nused = (int)(p - data);
+                    return ret;
+                }
+                break;
+            }
+        }
+        /* not a frame or parity error: resync at the next preamble of the
+           carried bytes and scan the block again */
+        for (i = 1; i < nold && rtcm->buff[i] != RTCM3PREAMB; i++);
+        memmove(rtcm->buff, rtcm->buff + i, nold - i);
+        rtcm->nbyte = nold - i;
+        p = data;
+    }
+    ret = 0;
+    while (p < end)
+    {
+        /* synchronize frame */
+        if (*p != RTCM3PREAMB && !(p = (const unsigned char *)memchr(p, RTCM3PREAMB, end - p)))
+        {
+            p = end;
+            break;
+        }
+        if (end - p >= 3 && (p[1] & 0xFC))
+        {
+            p++;
+            continue;
+        }
+        if (end - p < 3 || end - p < (n = (((p[1] & 0x3) << 8) | p[2]) + 3) + 3)
+        {
+            /* partial frame, keep for the next block */
+            rtcm->nbyte = (unsigned int)(end - p);
+            memcpy(rtcm->buff, p, rtcm->nbyte);
+            if (rtcm->nbyte >= 3) rtcm->len = n;
+            p = end;
+            break;
+        }
+        if ((ret = decode_rtcm3_nav(rtcm, p, n, nav)) < 0)
+        {
+            ret = 0;
+            p++;
+            continue;
+        }
+        p += n + 3;
+        if (ret == 2) break;
+    }
+    *nused = (int)(p - data);
+    return ret;
+}
+
 /* transform ecef to geodetic postion ------------------------------------------
 * transform ecef position to geodetic position
 * args   : double *r        I   ecef position {x,y,z} (m)
@@ -12,6 +12,7 @@ extern "C" {
 
 /* by Dr. Yudan Yi */
 #include "rtklib_core.h"
+#include "log.h"
 
 #ifndef WIN32
 #define ARM_MCU
@@ -238,19 +239,19 @@ extern "C" {
 
 /* do not define different MAX for post-process verion vs. real-time, this will hide the performance issue, and potential bug */
 /* increase MAXOBS, there are satellite in China now */
-#define MAXOBS 24
+#define MAXOBS 64
 #define GPS_ON
 #define GLO_ON
-//#define GAL_ON
-//#define BDS_ON
+#define GAL_ON
+#define BDS_ON
 
 //#define RTCM_SSR
 //define _PC_
 #ifdef _PC_
-#define MAXEPH 100
+#define MAXEPH 128
 #define MAXEPH_R 24
 #else
-#define MAXEPH   30
+#define MAXEPH   128
 #define MAXEPH_R 24
 #endif
 #define MAXSSR 24
@@ -338,6 +339,8 @@ typedef struct {        /* SSR correction type */
     unsigned char update; /* update flag (0:no update,1:update) */
 } ssr_t;
 
+#define NSYSSSR 5 /* systems of nav_t.nsys, in spartn order (gps,glo,gal,bds,qzs) */
+
 typedef struct {        /* navigation data type */
     unsigned int n;         /* number of broadcast ephemeris */
     unsigned int ng;       /* number of glonass ephemeris */
@@ -346,7 +349,7 @@ typedef struct {        /* navigation data type */
 	unsigned int n_bds;
 	unsigned int n_qzs;
 	unsigned int ns;
-    unsigned int nsys[2];
+    unsigned int nsys[NSYSSSR]; /* satellites with ssr corrections per system */
     eph_t eph[MAXEPH];         /* GPS/QZS/GAL ephemeris */
     geph_t geph[MAXEPH_R];     /* GLONASS ephemeris */  
     unsigned char ephsat;
@@ -365,6 +368,24 @@ typedef struct {             /* observation data */
     unsigned int staid;      /* station id */
 } obs_t;
 
+#define NSYSMSM 6 /* number of msm systems (gps,glo,gal,qzs,sbs,bds) */
+
+typedef struct {        /* msm satellite/signal layout of a system */
+    int valid;          /* layout valid flag */
+    int n;              /* number of obs data of the system */
+    unsigned char idx[MAXOBS]; /* obs data index */
+    unsigned char sat[MAXOBS]; /* satellite number */
+    unsigned char code[MAXOBS][NFREQ+NEXOBS]; /* obs code */
+    signed char k[MAXOBS];     /* msm satellite index (-1: none) */
+    unsigned char freq[MAXOBS][NFREQ+NEXOBS]; /* frequency index (0: no msm signal) */
+    unsigned char cell[MAXOBS][NFREQ+NEXOBS]; /* msm cell number */
+    int nsat, nsig, ncell; /* number of satellites, signals and cells */
+    int ncmask;         /* number of cell mask bits */
+    uint64_t satmask;   /* satellite mask */
+    uint32_t sigmask;   /* signal mask */
+    uint64_t cellmask;  /* cell mask */
+} msm_layout_t;
+
 typedef struct {        /* RTCM control struct type */
     gtime_t time;       /* message time */
     char msmtype[6][128]; /* msm signal types */
@@ -379,6 +400,7 @@ typedef struct {        /* RTCM control struct type */
 	double cp[MAXSAT][NFREQ + NEXOBS]; /* carrier-phase measurement, used in encode */
 	gtime_t lltime[MAXSAT][NFREQ + NEXOBS]; /* last lock time */
 	int seqno;          /* sequence number for rtcm 2 or iods msm */
+	msm_layout_t msm[NSYSMSM]; /* msm layout of the last encoded epoch */
 } rtcm_t;
 
 
@@ -392,9 +414,13 @@ typedef struct {
 	double time;
 } gnss_rtcm_t;
 
-void trace   (int level, const char *format, ...);
+/* rtklib trace levels 1-2 are logged at LOG_INFO, 3-5 at LOG_DEBUG of LOG_SYS_RTCM */
+#define TRACE_LEVEL(level) ((level) <= 2 ? LOG_INFO : LOG_DEBUG)
+#define trace(level, ...) do { if (TRACE_LEVEL(level) >= log_level[LOG_SYS_RTCM]) trace_out(level, __VA_ARGS__); } while (0)
+void trace_out(int level, const char *format, ...);
 
 int input_rtcm3_data(rtcm_t *rtcm, unsigned char data, obs_t *obs, nav_t *nav);
+int input_rtcm3_nav(rtcm_t *rtcm, const unsigned char *data, int len, nav_t *nav, int *nused);
 
 /* interface to GNSS db */
 int input_rtcm3(unsigned char data, unsigned int stnID, gnss_rtcm_t *gnss);
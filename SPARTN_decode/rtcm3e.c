@@ -95,6 +95,7 @@ static void setbitg(unsigned char *buff, int pos, int len, int value)
     setbitu(buff,pos,1,value<0?1:0);
     setbitu(buff,pos+1,len-1,value<0?-value:value);
 }
+#if 0
 /* set signed 38 bit field ---------------------------------------------------*/
 static void set38bits(unsigned char *buff, int pos, double value)
 {
@@ -103,6 +104,59 @@ static void set38bits(unsigned char *buff, int pos, double value)
     setbits(buff,pos  ,32,word_h);
     setbitu(buff,pos+32,6,word_l);
 }
+#endif
+/* bit writer -----------------------------------------------------------------
+* fields are shifted into a 64 bit accumulator and written to the buffer by
+* whole bytes, instead of bit by bit. the output is the same as setbitu()/
+* setbits() at consecutive positions. setbitu()/setbits() are left for the
+* disabled encoders
+*-----------------------------------------------------------------------------*/
+typedef struct {
+    unsigned char *buff; /* buffer */
+    unsigned char *p;   /* next byte to write */
+    uint64_t acc;       /* accumulator (pending bits in lsb) */
+    int nacc;           /* number of pending bits (0-7 between fields) */
+} bitw_t;
+
+static void bitw_init(bitw_t *w, unsigned char *buff, int pos)
+{
+    w->buff=buff;
+    w->p=buff+pos/8;
+    w->nacc=pos%8;
+    w->acc=w->nacc?*w->p>>(8-w->nacc):0;
+}
+static void bitw_putu(bitw_t *w, int len, unsigned int data)
+{
+    if (len<=0||32<len) return;
+    w->acc=(w->acc<<len)|(data&(0xFFFFFFFFu>>(32-len)));
+    w->nacc+=len;
+    while (w->nacc>=8) {
+        w->nacc-=8;
+        *w->p++=(unsigned char)(w->acc>>w->nacc);
+    }
+}
+static void bitw_puts(bitw_t *w, int len, int data)
+{
+    unsigned int u=(unsigned int)data;
+    if (data<0) u|=1u<<(len-1); else u&=~(1u<<(len-1)); /* set sign bit */
+    bitw_putu(w,len,u);
+}
+/* signed 38 bit field ------------------------------------------------------*/
+static void bitw_put38(bitw_t *w, double value)
+{
+    int word_h=(int)floor(value/64.0);
+    unsigned int word_l=(unsigned int)(value-word_h*64.0);
+    bitw_puts(w,32,word_h);
+    bitw_putu(w, 6,word_l);
+}
+/* write pending bits and return bit position --------------------------------*/
+static int bitw_flush(bitw_t *w)
+{
+    if (w->nacc>0) {
+        *w->p=(unsigned char)((w->acc<<(8-w->nacc))&0xFF)|(*w->p&(0xFF>>w->nacc));
+    }
+    return (int)(w->p-w->buff)*8+w->nacc;
+}
 #if 0
 /* lock time -----------------------------------------------------------------*/
 static int locktime(gtime_t time, gtime_t *lltime, unsigned char LLI)
@@ -525,24 +579,25 @@ static int encode_type1004(rtcm_t *rtcm, int sync)
 static int encode_type1005(rtcm_t *rtcm, obs_t *obs, int sync)
 {
     double *p= obs->pos;
-    int i=24;
+    bitw_t w;
     
     trace(3,"encode_type1005: sync=%d\n",sync);
     
-    setbitu(rtcm->buff,i,12,1005       ); i+=12; /* message no */
-    setbitu(rtcm->buff,i,12, obs->staid); i+=12; /* ref station id */
-    setbitu(rtcm->buff,i, 6,0          ); i+= 6; /* itrf realization year */
-    setbitu(rtcm->buff,i, 1,1          ); i+= 1; /* gps indicator */
-    setbitu(rtcm->buff,i, 1,1          ); i+= 1; /* glonass indicator */
-    setbitu(rtcm->buff,i, 1,0          ); i+= 1; /* galileo indicator */
-    setbitu(rtcm->buff,i, 1,0          ); i+= 1; /* ref station indicator */
-    set38bits(rtcm->buff,i,p[0]/0.0001 ); i+=38; /* antenna ref point ecef-x */
-    setbitu(rtcm->buff,i, 1,1          ); i+= 1; /* oscillator indicator */
-    setbitu(rtcm->buff,i, 1,0          ); i+= 1; /* reserved */
-    set38bits(rtcm->buff,i,p[1]/0.0001 ); i+=38; /* antenna ref point ecef-y */
-    setbitu(rtcm->buff,i, 2,0          ); i+= 2; /* quarter cycle indicator */
-    set38bits(rtcm->buff,i,p[2]/0.0001 ); i+=38; /* antenna ref point ecef-z */
-    rtcm->nbit=i;
+    bitw_init(&w,rtcm->buff,24);
+    bitw_putu (&w,12,1005       ); /* message no */
+    bitw_putu (&w,12, obs->staid); /* ref station id */
+    bitw_putu (&w, 6,0          ); /* itrf realization year */
+    bitw_putu (&w, 1,1          ); /* gps indicator */
+    bitw_putu (&w, 1,1          ); /* glonass indicator */
+    bitw_putu (&w, 1,0          ); /* galileo indicator */
+    bitw_putu (&w, 1,0          ); /* ref station indicator */
+    bitw_put38(&w,p[0]/0.0001   ); /* antenna ref point ecef-x */
+    bitw_putu (&w, 1,1          ); /* oscillator indicator */
+    bitw_putu (&w, 1,0          ); /* reserved */
+    bitw_put38(&w,p[1]/0.0001   ); /* antenna ref point ecef-y */
+    bitw_putu (&w, 2,0          ); /* quarter cycle indicator */
+    bitw_put38(&w,p[2]/0.0001   ); /* antenna ref point ecef-z */
+    rtcm->nbit=bitw_flush(&w);
     return 1;
 }
 #if 0
@@ -1775,25 +1830,100 @@ static void gen_msm_index(rtcm_t *rtcm, obs_t *obs, int sys, int *nsat, int *nsi
         if (cell_ind[i]&&*ncell<64) cell_ind[i]=++(*ncell);
     }
 }
+/* msm layout of a system ----------------------------------------------------*/
+static msm_layout_t *msm_layout(rtcm_t *rtcm, int sys)
+{
+    switch (sys) {
+        case _SYS_GPS_: return rtcm->msm+0;
+        case _SYS_GLO_: return rtcm->msm+1;
+        case _SYS_GAL_: return rtcm->msm+2;
+        case _SYS_QZS_: return rtcm->msm+3;
+        case _SYS_SBS_: return rtcm->msm+4;
+        case _SYS_BDS_: return rtcm->msm+5;
+    }
+    return NULL;
+}
+/* generate msm layout ---------------------------------------------------------
+* generate satellite, signal and cell mask and the satellite index and cell
+* number of each signal of the obs data of a system. the layout of the last
+* epoch is kept in rtcm->msm and reused while the satellites and signals of
+* the system are unchanged, which is the usual case between epochs
+*-----------------------------------------------------------------------------*/
+static const msm_layout_t *gen_msm_layout(rtcm_t *rtcm, obs_t *obs, int sys)
+{
+    msm_layout_t *lay;
+    unsigned char sat_ind[64]={0},sig_ind[32]={0},cell_ind[32*64]={0};
+    int i,j,n=0,sat,sig,f;
+    
+    if (!(lay=msm_layout(rtcm,sys))) return NULL;
+    
+    /* check satellites and signals against the last epoch */
+    if (lay->valid) {
+        for (i=0;i<(int)obs->n;i++) {
+            if (!to_satid(sys,obs->data[i].sat)) continue;
+            if (n>=lay->n||lay->idx[n]!=i||lay->sat[n]!=obs->data[i].sat||
+                memcmp(lay->code[n],obs->data[i].code,NFREQ+NEXOBS)) break;
+            n++;
+        }
+        if (i>=(int)obs->n&&n==lay->n) return lay;
+    }
+    /* generate msm satellite, signal and cell index */
+    gen_msm_index(rtcm,obs,sys,&lay->nsat,&lay->nsig,&lay->ncell,sat_ind,sig_ind,
+                  cell_ind);
+    
+    lay->satmask=lay->cellmask=0;
+    lay->sigmask=0;
+    for (i=0;i<64;i++) {
+        lay->satmask=(lay->satmask<<1)|(sat_ind[i]?1:0);
+    }
+    for (i=0;i<32;i++) {
+        lay->sigmask=(lay->sigmask<<1)|(sig_ind[i]?1:0);
+    }
+    for (i=0;i<lay->nsat*lay->nsig&&i<64;i++) {
+        lay->cellmask=(lay->cellmask<<1)|(cell_ind[i]?1:0);
+    }
+    lay->ncmask=i;
+    
+    for (i=n=0;i<(int)obs->n&&n<MAXOBS;i++) {
+        if (!(sat=to_satid(sys,obs->data[i].sat))) continue;
+        
+        lay->idx[n]=(unsigned char)i;
+        lay->sat[n]=obs->data[i].sat;
+        memcpy(lay->code[n],obs->data[i].code,NFREQ+NEXOBS);
+        lay->k[n]=(signed char)(sat_ind[sat-1]-1);
+        
+        for (j=0;j<NFREQ+NEXOBS;j++) {
+            lay->freq[n][j]=lay->cell[n][j]=0;
+            if (!(sig=to_sigid(sys,obs->data[i].code[j],&f))) continue;
+            
+            lay->freq[n][j]=(unsigned char)f;
+            lay->cell[n][j]=cell_ind[sig_ind[sig-1]-1+lay->k[n]*lay->nsig];
+        }
+        n++;
+    }
+    lay->n=n;
+    lay->valid=1;
+    return lay;
+}
 /* generate msm satellite data fields ----------------------------------------*/
-static void gen_msm_sat(rtcm_t *rtcm, obs_t *obs, int sys, int nsat,
-                        const unsigned char *sat_ind, double *rrng,
+static void gen_msm_sat(rtcm_t *rtcm, obs_t *obs, int sys,
+                        const msm_layout_t *lay, double *rrng,
                         double *rrate, unsigned char *info)
 {
     obsd_t *data;
     double lambda,rrng_s,rrate_s;
-    int i,j,k,sat,sig,f,fcn;
+    int i,j,k,f,fcn;
     
     for (i=0;i<64;i++) rrng[i]=rrate[i]=0.0;
     
-    for (i=0;i<(int)obs->n;i++) {
-        data=obs->data+i;
-        if (!(sat=to_satid(sys,data->sat))) continue;
+    for (i=0;i<lay->n;i++) {
+        data=obs->data+lay->idx[i];
         fcn=fcn_glo(data->sat,rtcm);
         
         for (j=0;j<NFREQ+NEXOBS;j++) {
-            if (!(sig=to_sigid(sys,data->code[j],&f))) continue;
-            k=sat_ind[sat-1]-1;
+            if (!lay->cell[i][j]) continue;
+            k=lay->k[i];
+            f=lay->freq[i][j];
             lambda=satwavelen(data->sat,f-1);
             
             /* rough range (ms) and rough phase-range-rate (m/s) */
@@ -1808,33 +1938,29 @@ static void gen_msm_sat(rtcm_t *rtcm, obs_t *obs, int sys, int nsat,
     }
 }
 /* generate msm signal data fields -------------------------------------------*/
-static void gen_msm_sig(rtcm_t *rtcm, obs_t *obs, int sys, int nsat, int nsig, int ncell,
-                        const unsigned char *sat_ind,
-                        const unsigned char *sig_ind,
-                        const unsigned char *cell_ind, const double *rrng,
-                        const double *rrate, double *psrng, double *phrng,
-                        double *rate, double *lock, unsigned char *half,
-                        float *cnr)
+static void gen_msm_sig(rtcm_t *rtcm, obs_t *obs, const msm_layout_t *lay,
+                        const double *rrng, const double *rrate, double *psrng,
+                        double *phrng, double *rate, double *lock,
+                        unsigned char *half, float *cnr)
 {
     obsd_t *data;
     double lambda,psrng_s,phrng_s,rate_s,lt;
-    int i,j,k,sat,sig,cell,f,LLI;
+    int i,j,k,cell,f,LLI;
     
-    for (i=0;i<ncell;i++) {
+    for (i=0;i<lay->ncell;i++) {
         if (psrng) psrng[i]=0.0;
         if (phrng) phrng[i]=0.0;
         if (rate ) rate [i]=0.0;
     }
-    for (i=0;i<(int)obs->n;i++) {
-        data=obs->data+i;
-        
-        if (!(sat=to_satid(sys,data->sat))) continue;
+    for (i=0;i<lay->n;i++) {
+        data=obs->data+lay->idx[i];
         
         for (j=0;j<NFREQ+NEXOBS;j++) {
-            if (!(sig=to_sigid(sys,data->code[j],&f))) continue;
-            k=sat_ind[sat-1]-1;
-            if ((cell=cell_ind[sig_ind[sig-1]-1+k*nsig])>=64) continue;
+            if (!(cell=lay->cell[i][j])) continue;
+            k=lay->k[i];
+            if (cell>=64) continue;
             
+            f=lay->freq[i][j];
             lambda=satwavelen(data->sat,f-1);
             psrng_s=data->P[j]==0.0?0.0:data->P[j]-rrng[k];
             phrng_s=data->L[j]==0.0||lambda<=0.0?0.0: data->L[j]*lambda-rrng [k];
@@ -1861,16 +1987,15 @@ static void gen_msm_sig(rtcm_t *rtcm, obs_t *obs, int sys, int nsat, int nsig, i
     }
 }
 /* encode msm header ---------------------------------------------------------*/
-static int encode_msm_head(int type, rtcm_t *rtcm, obs_t *obs, int sys, int sync, int *nsat,
-                           int *ncell, double *rrng, double *rrate,
-                           unsigned char *info, double *psrng, double *phrng,
-                           double *rate, double *lock, unsigned char *half,
-                           float *cnr)
+static int encode_msm_head(int type, rtcm_t *rtcm, obs_t *obs, int sys, int sync,
+                           bitw_t *w, int *nsat, int *ncell, double *rrng,
+                           double *rrate, unsigned char *info, double *psrng,
+                           double *phrng, double *rate, double *lock,
+                           unsigned char *half, float *cnr)
 {
+    const msm_layout_t *lay;
     double tow;
-    unsigned char sat_ind[64]={0},sig_ind[32]={0},cell_ind[32*64]={0};
     unsigned int dow,epoch;
-    int i=24,j,nsig=0;
     
     switch (sys) {
         case _SYS_GPS_: type+=1070; break;
@@ -1881,8 +2006,10 @@ static int encode_msm_head(int type, rtcm_t *rtcm, obs_t *obs, int sys, int sync
         case _SYS_BDS_: type+=1120; break;
         default: return 0;
     }
-    /* generate msm satellite, signal and cell index */
-    gen_msm_index(rtcm,obs,sys,nsat,&nsig,ncell,sat_ind,sig_ind,cell_ind);
+    /* generate msm satellite, signal and cell layout */
+    if (!(lay=gen_msm_layout(rtcm,obs,sys))) return 0;
+    *nsat=lay->nsat;
+    *ncell=lay->ncell;
     
     if (sys==_SYS_GLO_) {
         /* glonass time (dow + tod-ms) */
@@ -1900,40 +2027,43 @@ static int encode_msm_head(int type, rtcm_t *rtcm, obs_t *obs, int sys, int sync
         epoch=ROUND_U(time2gpst(rtcm->time,NULL)*1E3);
     }
     /* encode msm header (ref [15] table 3.5-78) */
-    setbitu(rtcm->buff,i,12,type       ); i+=12; /* message number */
-    setbitu(rtcm->buff,i,12,obs->staid ); i+=12; /* reference station id */
-    setbitu(rtcm->buff,i,30,epoch      ); i+=30; /* epoch time */
-    setbitu(rtcm->buff,i, 1,sync       ); i+= 1; /* multiple message bit */
-    setbitu(rtcm->buff,i, 3,rtcm->seqno); i+= 3; /* issue of data station */
-    setbitu(rtcm->buff,i, 7,0          ); i+= 7; /* reserved */
-    setbitu(rtcm->buff,i, 2,0          ); i+= 2; /* clock streering indicator */
-    setbitu(rtcm->buff,i, 2,0          ); i+= 2; /* external clock indicator */
-    setbitu(rtcm->buff,i, 1,0          ); i+= 1; /* smoothing indicator */
-    setbitu(rtcm->buff,i, 3,0          ); i+= 3; /* smoothing interval */
+    bitw_init(w,rtcm->buff,24);
+    bitw_putu(w,12,type       ); /* message number */
+    bitw_putu(w,12,obs->staid ); /* reference station id */
+    bitw_putu(w,30,epoch      ); /* epoch time */
+    bitw_putu(w, 1,sync       ); /* multiple message bit */
+    bitw_putu(w, 3,rtcm->seqno); /* issue of data station */
+    bitw_putu(w, 7,0          ); /* reserved */
+    bitw_putu(w, 2,0          ); /* clock streering indicator */
+    bitw_putu(w, 2,0          ); /* external clock indicator */
+    bitw_putu(w, 1,0          ); /* smoothing indicator */
+    bitw_putu(w, 3,0          ); /* smoothing interval */
     
     /* satellite mask */
-    for (j=0;j<64;j++) {
-        setbitu(rtcm->buff,i,1,sat_ind[j]?1:0); i+=1;
-    }
+    bitw_putu(w,32,(unsigned int)(lay->satmask>>32));
+    bitw_putu(w,32,(unsigned int)lay->satmask);
+    
     /* signal mask */
-    for (j=0;j<32;j++) {
-        setbitu(rtcm->buff,i,1,sig_ind[j]?1:0); i+=1;
-    }
+    bitw_putu(w,32,lay->sigmask);
+    
     /* cell mask */
-    for (j=0;j<*nsat*nsig&&j<64;j++) {
-        setbitu(rtcm->buff,i,1,cell_ind[j]?1:0); i+=1;
+    if (lay->ncmask>32) {
+        bitw_putu(w,lay->ncmask-32,(unsigned int)(lay->cellmask>>32));
+        bitw_putu(w,32,(unsigned int)lay->cellmask);
+    }
+    else {
+        bitw_putu(w,lay->ncmask,(unsigned int)lay->cellmask);
     }
     /* generate msm satellite data fields */
-    gen_msm_sat(rtcm,obs,sys,*nsat,sat_ind,rrng,rrate,info);
+    gen_msm_sat(rtcm,obs,sys,lay,rrng,rrate,info);
     
     /* generate msm signal data fields */
-    gen_msm_sig(rtcm,obs,sys,*nsat,nsig,*ncell,sat_ind,sig_ind,cell_ind,rrng,rrate,
-                psrng,phrng,rate,lock,half,cnr);
+    gen_msm_sig(rtcm,obs,lay,rrng,rrate,psrng,phrng,rate,lock,half,cnr);
     
-    return i;
+    return 1;
 }
 /* encode rough range integer ms ---------------------------------------------*/
-static int encode_msm_int_rrng(rtcm_t *rtcm, int i, const double *rrng,
+static void encode_msm_int_rrng(rtcm_t *rtcm, bitw_t *w, const double *rrng,
                                int nsat)
 {
     unsigned int int_ms;
@@ -1951,12 +2081,11 @@ static int encode_msm_int_rrng(rtcm_t *rtcm, int i, const double *rrng,
         else {
             int_ms=ROUND_U(rrng[j]/RANGE_MS/P2_10)>>10;
         }
-        setbitu(rtcm->buff,i,8,int_ms); i+=8;
+        bitw_putu(w,8,int_ms);
     }
-    return i;
 }
 /* encode rough range modulo 1 ms --------------------------------------------*/
-static int encode_msm_mod_rrng(rtcm_t *rtcm, int i, const double *rrng,
+static void encode_msm_mod_rrng(rtcm_t *rtcm, bitw_t *w, const double *rrng,
                                int nsat)
 {
     unsigned int mod_ms;
@@ -1969,23 +2098,21 @@ static int encode_msm_mod_rrng(rtcm_t *rtcm, int i, const double *rrng,
         else {
             mod_ms=ROUND_U(rrng[j]/RANGE_MS/P2_10)&0x3FFu;
         }
-        setbitu(rtcm->buff,i,10,mod_ms); i+=10;
+        bitw_putu(w,10,mod_ms);
     }
-    return i;
 }
 /* encode extended satellite info --------------------------------------------*/
-static int encode_msm_info(rtcm_t *rtcm, int i, const unsigned char *info,
+static void encode_msm_info(rtcm_t *rtcm, bitw_t *w, const unsigned char *info,
                            int nsat)
 {
     int j;
     
     for (j=0;j<nsat;j++) {
-        setbitu(rtcm->buff,i,4,info[j]); i+=4;
+        bitw_putu(w,4,info[j]);
     }
-    return i;
 }
 /* encode rough phase-range-rate ---------------------------------------------*/
-static int encode_msm_rrate(rtcm_t *rtcm, int i, const double *rrate, int nsat)
+static void encode_msm_rrate(rtcm_t *rtcm, bitw_t *w, const double *rrate, int nsat)
 {
     int j,rrate_val;
     
@@ -1998,12 +2125,11 @@ static int encode_msm_rrate(rtcm_t *rtcm, int i, const double *rrate, int nsat)
         else {
             rrate_val=ROUND(rrate[j]/1.0);
         }
-        setbits(rtcm->buff,i,14,rrate_val); i+=14;
+        bitw_puts(w,14,rrate_val);
     }
-    return i;
 }
 /* encode fine pseudorange ---------------------------------------------------*/
-static int encode_msm_psrng(rtcm_t *rtcm, int i, const double *psrng, int ncell)
+static void encode_msm_psrng(rtcm_t *rtcm, bitw_t *w, const double *psrng, int ncell)
 {
     int j,psrng_val;
     
@@ -2019,12 +2145,11 @@ static int encode_msm_psrng(rtcm_t *rtcm, int i, const double *psrng, int ncell)
         else {
             psrng_val=ROUND(psrng[j]/RANGE_MS/P2_24);
         }
-        setbits(rtcm->buff,i,15,psrng_val); i+=15;
+        bitw_puts(w,15,psrng_val);
     }
-    return i;
 }
 /* encode fine pseudorange with extended resolution --------------------------*/
-static int encode_msm_psrng_ex(rtcm_t *rtcm, int i, const double *psrng,
+static void encode_msm_psrng_ex(rtcm_t *rtcm, bitw_t *w, const double *psrng,
                                int ncell)
 {
     int j,psrng_val;
@@ -2041,12 +2166,11 @@ static int encode_msm_psrng_ex(rtcm_t *rtcm, int i, const double *psrng,
         else {
             psrng_val=ROUND(psrng[j]/RANGE_MS/P2_29);
         }
-        setbits(rtcm->buff,i,20,psrng_val); i+=20;
+        bitw_puts(w,20,psrng_val);
     }
-    return i;
 }
 /* encode fine phase-range ---------------------------------------------------*/
-static int encode_msm_phrng(rtcm_t *rtcm, int i, const double *phrng, int ncell)
+static void encode_msm_phrng(rtcm_t *rtcm, bitw_t *w, const double *phrng, int ncell)
 {
     int j,phrng_val;
     
@@ -2062,12 +2186,11 @@ static int encode_msm_phrng(rtcm_t *rtcm, int i, const double *phrng, int ncell)
         else {
             phrng_val=ROUND(phrng[j]/RANGE_MS/P2_29);
         }
-        setbits(rtcm->buff,i,22,phrng_val); i+=22;
+        bitw_puts(w,22,phrng_val);
     }
-    return i;
 }
 /* encode fine phase-range with extended resolution --------------------------*/
-static int encode_msm_phrng_ex(rtcm_t *rtcm, int i, const double *phrng,
+static void encode_msm_phrng_ex(rtcm_t *rtcm, bitw_t *w, const double *phrng,
                                int ncell)
 {
     int j,phrng_val;
@@ -2084,68 +2207,62 @@ static int encode_msm_phrng_ex(rtcm_t *rtcm, int i, const double *phrng,
         else {
             phrng_val=ROUND(phrng[j]/RANGE_MS/P2_31);
         }
-        setbits(rtcm->buff,i,24,phrng_val); i+=24;
+        bitw_puts(w,24,phrng_val);
     }
-    return i;
 }
 /* encode lock-time indicator ------------------------------------------------*/
-static int encode_msm_lock(rtcm_t *rtcm, int i, const double *lock, int ncell)
+static void encode_msm_lock(rtcm_t *rtcm, bitw_t *w, const double *lock, int ncell)
 {
     int j,lock_val;
     
     for (j=0;j<ncell;j++) {
         lock_val=to_msm_lock(lock[j]);
-        setbitu(rtcm->buff,i,4,lock_val); i+=4;
+        bitw_putu(w,4,lock_val);
     }
-    return i;
 }
 /* encode lock-time indicator with extended range and resolution -------------*/
-static int encode_msm_lock_ex(rtcm_t *rtcm, int i, const double *lock,
+static void encode_msm_lock_ex(rtcm_t *rtcm, bitw_t *w, const double *lock,
                               int ncell)
 {
     int j,lock_val;
     
     for (j=0;j<ncell;j++) {
         lock_val=to_msm_lock_ex(lock[j]);
-        setbitu(rtcm->buff,i,10,lock_val); i+=10;
+        bitw_putu(w,10,lock_val);
     }
-    return i;
 }
 /* encode half-cycle-ambiguity indicator -------------------------------------*/
-static int encode_msm_half_amb(rtcm_t *rtcm, int i, const unsigned char *half,
+static void encode_msm_half_amb(rtcm_t *rtcm, bitw_t *w, const unsigned char *half,
                                int ncell)
 {
     int j;
     
     for (j=0;j<ncell;j++) {
-        setbitu(rtcm->buff,i,1,half[j]); i+=1;
+        bitw_putu(w,1,half[j]);
     }
-    return i;
 }
 /* encode signal cnr ---------------------------------------------------------*/
-static int encode_msm_cnr(rtcm_t *rtcm, int i, const float *cnr, int ncell)
+static void encode_msm_cnr(rtcm_t *rtcm, bitw_t *w, const float *cnr, int ncell)
 {
     int j,cnr_val;
     
     for (j=0;j<ncell;j++) {
         cnr_val=ROUND(cnr[j]/1.0);
-        setbitu(rtcm->buff,i,6,cnr_val); i+=6;
+        bitw_putu(w,6,cnr_val);
     }
-    return i;
 }
 /* encode signal cnr with extended resolution --------------------------------*/
-static int encode_msm_cnr_ex(rtcm_t *rtcm, int i, const float *cnr, int ncell)
+static void encode_msm_cnr_ex(rtcm_t *rtcm, bitw_t *w, const float *cnr, int ncell)
 {
     int j,cnr_val;
     
     for (j=0;j<ncell;j++) {
         cnr_val=ROUND(cnr[j]/0.0625);
-        setbitu(rtcm->buff,i,10,cnr_val); i+=10;
+        bitw_putu(w,10,cnr_val);
     }
-    return i;
 }
 /* encode fine phase-range-rate ----------------------------------------------*/
-static int encode_msm_rate(rtcm_t *rtcm, int i, const double *rate, int ncell)
+static void encode_msm_rate(rtcm_t *rtcm, bitw_t *w, const double *rate, int ncell)
 {
     int j,rate_val;
     
@@ -2161,30 +2278,30 @@ static int encode_msm_rate(rtcm_t *rtcm, int i, const double *rate, int ncell)
         else {
             rate_val=ROUND(rate[j]/0.0001);
         }
-        setbitu(rtcm->buff,i,15,rate_val); i+=15;
+        bitw_putu(w,15,rate_val);
     }
-    return i;
 }
 /* encode msm 1: compact pseudorange -----------------------------------------*/
 static int encode_msm1(rtcm_t *rtcm, obs_t* obs, int sys, int sync)
 {
     double rrng[64],rrate[64],psrng[64];
-    int i,nsat,ncell;
+    bitw_t w;
+    int nsat,ncell;
     
     trace(3,"encode_msm1: sys=%d sync=%d\n",sys,sync);
     
     /* encode msm header */
-    if (!(i=encode_msm_head(1,rtcm,obs,sys,sync,&nsat,&ncell,rrng,rrate,NULL,psrng,
-                            NULL,NULL,NULL,NULL,NULL))) {
+    if (!encode_msm_head(1,rtcm,obs,sys,sync,&w,&nsat,&ncell,rrng,rrate,NULL,psrng,
+                         NULL,NULL,NULL,NULL,NULL)) {
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
+    encode_msm_mod_rrng(rtcm,&w,rrng ,nsat ); /* rough range modulo 1 ms */
     
     /* encode msm signal data */
-    i=encode_msm_psrng   (rtcm,i,psrng,ncell); /* fine pseudorange */
+    encode_msm_psrng   (rtcm,&w,psrng,ncell); /* fine pseudorange */
     
-    rtcm->nbit=i;
+    rtcm->nbit=bitw_flush(&w);
     return 1;
 }
 /* encode msm 2: compact phaserange ------------------------------------------*/
@@ -2192,24 +2309,25 @@ static int encode_msm2(rtcm_t *rtcm, obs_t *obs, int sys, int sync)
 {
     double rrng[64],rrate[64],phrng[64],lock[64];
     unsigned char half[64];
-    int i,nsat,ncell;
+    bitw_t w;
+    int nsat,ncell;
     
     trace(3,"encode_msm2: sys=%d sync=%d\n",sys,sync);
     
     /* encode msm header */
-    if (!(i=encode_msm_head(2,rtcm,obs,sys,sync,&nsat,&ncell,rrng,rrate,NULL,NULL,
-                            phrng,NULL,lock,half,NULL))) {
+    if (!encode_msm_head(2,rtcm,obs,sys,sync,&w,&nsat,&ncell,rrng,rrate,NULL,NULL,
+                         phrng,NULL,lock,half,NULL)) {
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
+    encode_msm_mod_rrng(rtcm,&w,rrng ,nsat ); /* rough range modulo 1 ms */
     
     /* encode msm signal data */
-    i=encode_msm_phrng   (rtcm,i,phrng,ncell); /* fine phase-range */
-    i=encode_msm_lock    (rtcm,i,lock ,ncell); /* lock-time indicator */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
+    encode_msm_phrng   (rtcm,&w,phrng,ncell); /* fine phase-range */
+    encode_msm_lock    (rtcm,&w,lock ,ncell); /* lock-time indicator */
+    encode_msm_half_amb(rtcm,&w,half ,ncell); /* half-cycle-amb indicator */
     
-    rtcm->nbit=i;
+    rtcm->nbit=bitw_flush(&w);
     return 1;
 }
 /* encode msm 3: compact pseudorange and phaserange --------------------------*/
@@ -2217,25 +2335,26 @@ static int encode_msm3(rtcm_t *rtcm, obs_t* obs, int sys, int sync)
 {
     double rrng[64],rrate[64],psrng[64],phrng[64],lock[64];
     unsigned char half[64];
-    int i,nsat,ncell;
+    bitw_t w;
+    int nsat,ncell;
     
     trace(3,"encode_msm3: sys=%d sync=%d\n",sys,sync);
     
     /* encode msm header */
-    if (!(i=encode_msm_head(3,rtcm,obs,sys,sync,&nsat,&ncell,rrng,rrate,NULL,psrng,
-                            phrng,NULL,lock,half,NULL))) {
+    if (!encode_msm_head(3,rtcm,obs,sys,sync,&w,&nsat,&ncell,rrng,rrate,NULL,psrng,
+                         phrng,NULL,lock,half,NULL)) {
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
+    encode_msm_mod_rrng(rtcm,&w,rrng ,nsat ); /* rough range modulo 1 ms */
     
     /* encode msm signal data */
-    i=encode_msm_psrng   (rtcm,i,psrng,ncell); /* fine pseudorange */
-    i=encode_msm_phrng   (rtcm,i,phrng,ncell); /* fine phase-range */
-    i=encode_msm_lock    (rtcm,i,lock ,ncell); /* lock-time indicator */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
+    encode_msm_psrng   (rtcm,&w,psrng,ncell); /* fine pseudorange */
+    encode_msm_phrng   (rtcm,&w,phrng,ncell); /* fine phase-range */
+    encode_msm_lock    (rtcm,&w,lock ,ncell); /* lock-time indicator */
+    encode_msm_half_amb(rtcm,&w,half ,ncell); /* half-cycle-amb indicator */
     
-    rtcm->nbit=i;
+    rtcm->nbit=bitw_flush(&w);
     return 1;
 }
 /* encode msm 4: full pseudorange and phaserange plus cnr --------------------*/
@@ -2244,26 +2363,27 @@ static int encode_msm4(rtcm_t *rtcm, obs_t* obs, int sys, int sync)
     double rrng[64],rrate[64],psrng[64],phrng[64],lock[64];
     float cnr[64];
     unsigned char half[64];
-    int i,nsat,ncell;
+    bitw_t w;
+    int nsat,ncell;
     
     trace(3,"encode_msm4: sys=%d sync=%d\n",sys,sync);
     
     /* encode msm header */
-    if (!(i=encode_msm_head(4,rtcm,obs,sys,sync,&nsat,&ncell,rrng,rrate,NULL,psrng,
-                            phrng,NULL,lock,half,cnr))) {
+    if (!encode_msm_head(4,rtcm,obs,sys,sync,&w,&nsat,&ncell,rrng,rrate,NULL,psrng,
+                         phrng,NULL,lock,half,cnr)) {
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_int_rrng(rtcm,i,rrng ,nsat ); /* rough range integer ms */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
+    encode_msm_int_rrng(rtcm,&w,rrng ,nsat ); /* rough range integer ms */
+    encode_msm_mod_rrng(rtcm,&w,rrng ,nsat ); /* rough range modulo 1 ms */
     
     /* encode msm signal data */
-    i=encode_msm_psrng   (rtcm,i,psrng,ncell); /* fine pseudorange */
-    i=encode_msm_phrng   (rtcm,i,phrng,ncell); /* fine phase-range */
-    i=encode_msm_lock    (rtcm,i,lock ,ncell); /* lock-time indicator */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
-    i=encode_msm_cnr     (rtcm,i,cnr  ,ncell); /* signal cnr */
-    rtcm->nbit=i;
+    encode_msm_psrng   (rtcm,&w,psrng,ncell); /* fine pseudorange */
+    encode_msm_phrng   (rtcm,&w,phrng,ncell); /* fine phase-range */
+    encode_msm_lock    (rtcm,&w,lock ,ncell); /* lock-time indicator */
+    encode_msm_half_amb(rtcm,&w,half ,ncell); /* half-cycle-amb indicator */
+    encode_msm_cnr     (rtcm,&w,cnr  ,ncell); /* signal cnr */
+    rtcm->nbit=bitw_flush(&w);
     return 1;
 }
 /* encode msm 5: full pseudorange, phaserange, phaserangerate and cnr --------*/
@@ -2272,29 +2392,30 @@ static int encode_msm5(rtcm_t *rtcm, obs_t* obs, int sys, int sync)
     double rrng[64],rrate[64],psrng[64],phrng[64],rate[64],lock[64];
     float cnr[64];
     unsigned char info[64],half[64];
-    int i,nsat,ncell;
+    bitw_t w;
+    int nsat,ncell;
     
     trace(3,"encode_msm5: sys=%d sync=%d\n",sys,sync);
     
     /* encode msm header */
-    if (!(i=encode_msm_head(5,rtcm,obs,sys,sync,&nsat,&ncell,rrng,rrate,info,psrng,
-                            phrng,rate,lock,half,cnr))) {
+    if (!encode_msm_head(5,rtcm,obs,sys,sync,&w,&nsat,&ncell,rrng,rrate,info,psrng,
+                         phrng,rate,lock,half,cnr)) {
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_int_rrng(rtcm,i,rrng ,nsat ); /* rough range integer ms */
-    i=encode_msm_info    (rtcm,i,info ,nsat ); /* extended satellite info */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
-    i=encode_msm_rrate   (rtcm,i,rrate,nsat ); /* rough phase-range-rate */
+    encode_msm_int_rrng(rtcm,&w,rrng ,nsat ); /* rough range integer ms */
+    encode_msm_info    (rtcm,&w,info ,nsat ); /* extended satellite info */
+    encode_msm_mod_rrng(rtcm,&w,rrng ,nsat ); /* rough range modulo 1 ms */
+    encode_msm_rrate   (rtcm,&w,rrate,nsat ); /* rough phase-range-rate */
     
     /* encode msm signal data */
-    i=encode_msm_psrng   (rtcm,i,psrng,ncell); /* fine pseudorange */
-    i=encode_msm_phrng   (rtcm,i,phrng,ncell); /* fine phase-range */
-    i=encode_msm_lock    (rtcm,i,lock ,ncell); /* lock-time indicator */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
-    i=encode_msm_cnr     (rtcm,i,cnr  ,ncell); /* signal cnr */
-    i=encode_msm_rate    (rtcm,i,rate ,ncell); /* fine phase-range-rate */
-    rtcm->nbit=i;
+    encode_msm_psrng   (rtcm,&w,psrng,ncell); /* fine pseudorange */
+    encode_msm_phrng   (rtcm,&w,phrng,ncell); /* fine phase-range */
+    encode_msm_lock    (rtcm,&w,lock ,ncell); /* lock-time indicator */
+    encode_msm_half_amb(rtcm,&w,half ,ncell); /* half-cycle-amb indicator */
+    encode_msm_cnr     (rtcm,&w,cnr  ,ncell); /* signal cnr */
+    encode_msm_rate    (rtcm,&w,rate ,ncell); /* fine phase-range-rate */
+    rtcm->nbit=bitw_flush(&w);
     return 1;
 }
 /* encode msm 6: full pseudorange and phaserange plus cnr (high-res) ---------*/
@@ -2303,26 +2424,27 @@ static int encode_msm6(rtcm_t *rtcm, obs_t* obs, int sys, int sync)
     double rrng[64],rrate[64],psrng[64],phrng[64],lock[64];
     float cnr[64];
     unsigned char half[64];
-    int i,nsat,ncell;
+    bitw_t w;
+    int nsat,ncell;
     
     trace(3,"encode_msm6: sys=%d sync=%d\n",sys,sync);
     
     /* encode msm header */
-    if (!(i=encode_msm_head(6,rtcm,obs,sys,sync,&nsat,&ncell,rrng,rrate,NULL,psrng,
-                            phrng,NULL,lock,half,cnr))) {
+    if (!encode_msm_head(6,rtcm,obs,sys,sync,&w,&nsat,&ncell,rrng,rrate,NULL,psrng,
+                         phrng,NULL,lock,half,cnr)) {
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_int_rrng(rtcm,i,rrng ,nsat ); /* rough range integer ms */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
+    encode_msm_int_rrng(rtcm,&w,rrng ,nsat ); /* rough range integer ms */
+    encode_msm_mod_rrng(rtcm,&w,rrng ,nsat ); /* rough range modulo 1 ms */
     
     /* encode msm signal data */
-    i=encode_msm_psrng_ex(rtcm,i,psrng,ncell); /* fine pseudorange ext */
-    i=encode_msm_phrng_ex(rtcm,i,phrng,ncell); /* fine phase-range ext */
-    i=encode_msm_lock_ex (rtcm,i,lock ,ncell); /* lock-time indicator ext */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
-    i=encode_msm_cnr_ex  (rtcm,i,cnr  ,ncell); /* signal cnr ext */
-    rtcm->nbit=i;
+    encode_msm_psrng_ex(rtcm,&w,psrng,ncell); /* fine pseudorange ext */
+    encode_msm_phrng_ex(rtcm,&w,phrng,ncell); /* fine phase-range ext */
+    encode_msm_lock_ex (rtcm,&w,lock ,ncell); /* lock-time indicator ext */
+    encode_msm_half_amb(rtcm,&w,half ,ncell); /* half-cycle-amb indicator */
+    encode_msm_cnr_ex  (rtcm,&w,cnr  ,ncell); /* signal cnr ext */
+    rtcm->nbit=bitw_flush(&w);
     return 1;
 }
 /* encode msm 7: full pseudorange, phaserange, phaserangerate and cnr (h-res) */
@@ -2331,29 +2453,30 @@ static int encode_msm7(rtcm_t *rtcm, obs_t* obs, int sys, int sync)
     double rrng[64],rrate[64],psrng[64],phrng[64],rate[64],lock[64];
     float cnr[64];
     unsigned char info[64],half[64];
-    int i,nsat,ncell;
+    bitw_t w;
+    int nsat,ncell;
     
     trace(3,"encode_msm7: sys=%d sync=%d\n",sys,sync);
     
     /* encode msm header */
-    if (!(i=encode_msm_head(7,rtcm,obs,sys,sync,&nsat,&ncell,rrng,rrate,info,psrng,
-                            phrng,rate,lock,half,cnr))) {
+    if (!encode_msm_head(7,rtcm,obs,sys,sync,&w,&nsat,&ncell,rrng,rrate,info,psrng,
+                         phrng,rate,lock,half,cnr)) {
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_int_rrng(rtcm,i,rrng ,nsat ); /* rough range integer ms */
-    i=encode_msm_info    (rtcm,i,info ,nsat ); /* extended satellite info */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
-    i=encode_msm_rrate   (rtcm,i,rrate,nsat ); /* rough phase-range-rate */
+    encode_msm_int_rrng(rtcm,&w,rrng ,nsat ); /* rough range integer ms */
+    encode_msm_info    (rtcm,&w,info ,nsat ); /* extended satellite info */
+    encode_msm_mod_rrng(rtcm,&w,rrng ,nsat ); /* rough range modulo 1 ms */
+    encode_msm_rrate   (rtcm,&w,rrate,nsat ); /* rough phase-range-rate */
     
     /* encode msm signal data */
-    i=encode_msm_psrng_ex(rtcm,i,psrng,ncell); /* fine pseudorange ext */
-    i=encode_msm_phrng_ex(rtcm,i,phrng,ncell); /* fine phase-range ext */
-    i=encode_msm_lock_ex (rtcm,i,lock ,ncell); /* lock-time indicator ext */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
-    i=encode_msm_cnr_ex  (rtcm,i,cnr  ,ncell); /* signal cnr ext */
-    i=encode_msm_rate    (rtcm,i,rate ,ncell); /* fine phase-range-rate */
-    rtcm->nbit=i;
+    encode_msm_psrng_ex(rtcm,&w,psrng,ncell); /* fine pseudorange ext */
+    encode_msm_phrng_ex(rtcm,&w,phrng,ncell); /* fine phase-range ext */
+    encode_msm_lock_ex (rtcm,&w,lock ,ncell); /* lock-time indicator ext */
+    encode_msm_half_amb(rtcm,&w,half ,ncell); /* half-cycle-amb indicator */
+    encode_msm_cnr_ex  (rtcm,&w,cnr  ,ncell); /* signal cnr ext */
+    encode_msm_rate    (rtcm,&w,rate ,ncell); /* fine phase-range-rate */
+    rtcm->nbit=bitw_flush(&w);
     return 1;
 }
 /* encode rtcm ver.3 message -------------------------------------------------*/
@@ -2480,6 +2603,7 @@ extern int encode_rtcm3(rtcm_t *rtcm, obs_t* obs, int type, int sync)
 extern int gen_rtcm3(rtcm_t* rtcm, obs_t *obs, int type, int sync)
 {
 	unsigned int crc;
+	bitw_t w;
 	int i = 0;
 
 	trace(4, "gen_rtcm3: type=%d sync=%d\n", type, sync);
@@ -2488,16 +2612,18 @@ extern int gen_rtcm3(rtcm_t* rtcm, obs_t *obs, int type, int sync)
 	rtcm->nbit = rtcm->len = rtcm->nbyte = 0;
 
 	/* set preamble and reserved */
-	setbitu(rtcm->buff, i, 8, RTCM3PREAMB); i += 8;
-	setbitu(rtcm->buff, i, 6, 0); i += 6;
-	setbitu(rtcm->buff, i, 10, 0); i += 10;
+	bitw_init(&w, rtcm->buff, 0);
+	bitw_putu(&w, 8, RTCM3PREAMB);
+	bitw_putu(&w, 6, 0);
+	bitw_putu(&w, 10, 0);
 
 	/* encode rtcm 3 message body */
 	if (!encode_rtcm3(rtcm, obs, type, sync)) return 0;
 
 	/* padding to align 8 bit boundary */
-	for (i = rtcm->nbit; i % 8; i++) {
-		setbitu(rtcm->buff, i, 1, 0);
+	if ((i = rtcm->nbit) % 8) {
+		rtcm->buff[i / 8] &= (unsigned char)(0xFF << (8 - i % 8));
+		i += 8 - i % 8;
 	}
 	/* message length (header+data) (bytes) */
 	if ((rtcm->len = i / 8) >= 3 + 1024) {
@@ -2506,11 +2632,13 @@ extern int gen_rtcm3(rtcm_t* rtcm, obs_t *obs, int type, int sync)
 		return 0;
 	}
 	/* message length without header and parity */
-	setbitu(rtcm->buff, 14, 10, rtcm->len - 3);
+	bitw_init(&w, rtcm->buff, 14);
+	bitw_putu(&w, 10, rtcm->len - 3);
 
 	/* crc-24q */
 	crc = rtk_crc24q(rtcm->buff, rtcm->len);
-	setbitu(rtcm->buff, i, 24, crc);
+	bitw_init(&w, rtcm->buff, i);
+	bitw_putu(&w, 24, crc);
 
 	/* length total (bytes) */
 	rtcm->nbyte = rtcm->len + 3;
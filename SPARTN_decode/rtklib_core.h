@@ -22,6 +22,13 @@ extern "C" {
 #ifndef ROUND
 #define ROUND(x)    ((int)floor((x)+0.5))
 #endif
+#ifndef THREAD_LOCAL
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread) /* static storage per thread */
+#else
+#define THREAD_LOCAL __thread
+#endif
+#endif
 
 #define OMGE        7.2921151467E-5     /* earth angular velocity (IS-GPS) (rad/s) */
 #define RE_WGS84    6378137.0           /* earth semimajor axis (WGS84) (m) */
@@ -1,18 +1,16 @@
+#define LOG_SYS LOG_SYS_VRS
 #include "log.h"
 #include "sapcorda_ssr.h"
 #include "ephemeris.h"
 #include "GenVRSObs.h"
 #include "export_ssr.h"
+#include "model.h"
 #include <string>
 #include "stringex.h"
+#include "ssr_snapshot.h"
 #include <memory.h>
 #include <map>
 
-static double dmm2deg(double dmm)
-{
-	return floor(dmm / 100.0) + fmod(dmm, 100.0) / 60.0;
-}
-
 sapcorda_ssr * sapcorda_ssr::m_instance = NULL;
 std::once_flag      sapcorda_ssr::m_flag;
 
@@ -46,6 +44,8 @@ sapcorda_ssr::sapcorda_ssr()
 	memset(&m_spartn, 0, sizeof(m_spartn));
 	memset(&m_spartn_out, 0, sizeof(m_spartn_out));
 	memset(&m_obs_vrs, 0, sizeof(m_obs_vrs));
+	memset(&m_astro, 0, sizeof(m_astro));
+	memset(&m_out_rtcm, 0, sizeof(m_out_rtcm));
 	m_last_eph_map.clear();
 	m_last_geph_map.clear();
 	m_last_ssr_map.clear();
@@ -53,6 +53,9 @@ sapcorda_ssr::sapcorda_ssr()
 	//m_last_geph.clear();
 	//m_last_ssr.clear();
 	m_fLOG = NULL;
+	m_state_interval = 0.0;
+	m_state_time.time = 0;
+	m_state_time.sec = 0.0;
 	//m_fLOG = fopen("obsfromssr.log", "w");
 	if (m_fLOG) {
 		printf("create log success ! \n");
@@ -60,21 +63,24 @@ sapcorda_ssr::sapcorda_ssr()
 	else {
 		printf("create log failed ! \n");
 	}
+	log_async_start();
+	if (!otl_grid_ready()) printf("no ocean tide loading grid, call set_otl_grid_file() ! \n");
 }
 
 sapcorda_ssr::~sapcorda_ssr()
 {
+	log_async_stop();
 	if (m_fLOG) fclose(m_fLOG); m_fLOG = NULL;
 }
 
 void sapcorda_ssr::input_ssr_stream(unsigned char * buffer, uint32_t len)
 {
 	nav_t *nav = &m_rtcm.nav;
-	sap_ssr_t ssr[SSR_NUM] = { 0 };
-	memcpy(ssr, m_spartn_out.ssr, sizeof(sap_ssr_t)*SSR_NUM);
+	std::vector<sap_ssr_t> ssr(m_spartn_out.ssr, m_spartn_out.ssr + SSR_NUM);
 	uint8_t ssr_offset = m_spartn_out.ssr_offset;
 	sread_ssr_sapcorda(buffer, len, &m_spartn,&m_spartn_out, nav->nsys);
-	save_last_ssr(ssr, ssr_offset, &m_spartn_out);
+	save_last_ssr(&ssr[0], ssr_offset, &m_spartn_out);
+	check_state();
 }
 
 void sapcorda_ssr::input_eph_stream(unsigned char * buffer, uint32_t len)
@@ -82,9 +88,10 @@ void sapcorda_ssr::input_eph_stream(unsigned char * buffer, uint32_t len)
 	nav_t *nav = &m_rtcm.nav;
 	nav_t temp_nav = { 0 };
 	memcpy(&temp_nav, nav, sizeof(nav_t));
-	sread_eph_rtcm(buffer, len, &m_rtcm, nav->nsys[0], nav->nsys[1]);
+	sread_eph_rtcm(buffer, len, &m_rtcm, nav->nsys);
 	save_last_eph(&temp_nav, nav);
 	save_last_geph(&temp_nav, nav);
+	check_state();
 }
 
 void sapcorda_ssr::save_last_eph(nav_t* last_nav,nav_t* nav) {
@@ -145,6 +152,131 @@ void sapcorda_ssr::save_last_ssr(sap_ssr_t * last_ssr, uint8_t ssr_offset, spart
 	}
 }
 
+/* current time (gpst) of the service */
+static gtime_t gpst_now()
+{
+	return utc2gpst(timeget());
+}
+
+/* last ephemerides or corrections by satellite as a snapshot section */
+template <class T>
+static int write_last(FILE* fp, const char* tag, const map<int, T>& last)
+{
+	vector<int> key;
+	vector<T> rec;
+	typename map<int, T>::const_iterator it;
+	for (it = last.begin(); it != last.end(); it++) {
+		key.push_back(it->first);
+		rec.push_back(it->second);
+	}
+	return ssrsnap_write(fp, tag, key.data(), rec.data(), sizeof(T), (int)rec.size());
+}
+
+template <class T>
+static int read_last(FILE* fp, int size, int n, map<int, T>& last)
+{
+	T rec;
+	int key;
+	if (size != sizeof(T)) return -1;
+	for (int i = 0; i < n; i++) {
+		if (!ssrsnap_record(fp, size, &key, &rec)) return -1;
+		last[key] = rec;
+	}
+	return 1;
+}
+
+/* write the decoded corrections, ephemerides and last maps to a snapshot */
+int sapcorda_ssr::save_state(const char* file)
+{
+	gtime_t now = gpst_now();
+	FILE* fp = ssrsnap_create(file, now);
+	if (!fp) return 0;
+	int ok = ssrsnap_write_state(fp, &m_spartn_out, &m_rtcm.nav) &&
+		write_last(fp, "LEPH", m_last_eph_map) >= 0 &&
+		write_last(fp, "LGEP", m_last_geph_map) >= 0 &&
+		write_last(fp, "LSSR", m_last_ssr_map) >= 0;
+	return ssrsnap_commit(fp, file, ok);
+}
+
+/* restore the state of a snapshot not older than maxage, nothing is changed on error */
+int sapcorda_ssr::load_state(const char* file, double maxage)
+{
+	gtime_t now = gpst_now(), time;
+	char tag[4];
+	int size, n, ret = 1;
+	FILE* fp = ssrsnap_open(file, now, maxage, &time);
+	if (!fp) return 0;
+
+	spartn_t* spartn = new spartn_t();
+	nav_t* nav = new nav_t();
+	map<int, eph_t> last_eph;
+	map<int, geph_t> last_geph;
+	map<int, sap_ssr_t> last_ssr;
+	while (ret > 0 && (ret = ssrsnap_section(fp, tag, &size, &n)) > 0) {
+		if ((ret = ssrsnap_read_state(fp, tag, size, n, spartn, nav)) != 0) continue;
+		if (!memcmp(tag, "LEPH", 4)) ret = read_last(fp, size, n, last_eph);
+		else if (!memcmp(tag, "LGEP", 4)) ret = read_last(fp, size, n, last_geph);
+		else if (!memcmp(tag, "LSSR", 4)) ret = read_last(fp, size, n, last_ssr);
+		else ret = ssrsnap_skip(fp, size, n) ? 1 : -1;
+	}
+	fclose(fp);
+	if (ret == 0) {
+		memset(&m_spartn, 0, sizeof(m_spartn));
+		memcpy(&m_spartn_out, spartn, sizeof(spartn_t));
+		memcpy(&m_rtcm.nav, nav, sizeof(nav_t));
+		m_last_eph_map.swap(last_eph);
+		m_last_geph_map.swap(last_geph);
+		m_last_ssr_map.swap(last_ssr);
+		slog(LOG_INFO, 0, "state restored from %s, age %.0f s", file, timediff(now, time));
+	}
+	delete spartn;
+	delete nav;
+	return ret == 0;
+}
+
+/* restore from file, then snapshot every interval s */
+int sapcorda_ssr::set_state_file(const char* file, double interval, double maxage)
+{
+	int ret = load_state(file, maxage > 0.0 ? maxage : SSRSNAP_MAXAGE);
+	m_state_file = file;
+	m_state_interval = interval > 0.0 ? interval : SSRSNAP_INTERVAL;
+	m_state_time = gpst_now();
+	return ret;
+}
+
+/* periodic snapshot after an input */
+void sapcorda_ssr::check_state()
+{
+	if (m_state_file.empty() || m_state_interval <= 0.0) return;
+	gtime_t now = gpst_now();
+	if (timediff(now, m_state_time) < m_state_interval) return;
+	m_state_time = now;
+	if (!save_state(m_state_file.c_str())) slog(LOG_INFO, 0, "state snapshot to %s failed", m_state_file.c_str());
+}
+
+int set_ssr_state_file(const char* file, double interval, double maxage)
+{
+	return sapcorda_ssr::getInstance()->set_state_file(file, interval, maxage);
+}
+
+/* ocean tide loading grid file instead of the builtin grid */
+int sapcorda_ssr::set_otl_grid(const char* file)
+{
+	if (otl_grid_open(file)) return 1;
+	slog(LOG_INFO, 0, "otl grid %s not opened", file);
+	return 0;
+}
+
+int set_otl_grid_file(const char* file)
+{
+	return sapcorda_ssr::getInstance()->set_otl_grid(file);
+}
+
+int save_ssr_state(const char* file)
+{
+	return sapcorda_ssr::getInstance()->save_state(file);
+}
+
 void input_ssr(unsigned char * buffer, uint32_t len)
 {
 	sapcorda_ssr::getInstance()->input_ssr_stream(buffer, len);
@@ -157,49 +289,51 @@ void input_eph(unsigned char * buffer, uint32_t len)
 
 void input_gga(char * buffer, unsigned char*out_buffer, uint32_t *len)
 {
-	std::string gga = buffer;
+	input_gga_ex(buffer, out_buffer, GGA_OUT_MAXLEN, len);
+}
 
-	double pos[3] = { 0 };
+int input_gga_ex(char * buffer, unsigned char*out_buffer, uint32_t size, uint32_t *len)
+{
+	nmea_gga_t gga;
 	double xyz[3] = { 0 };
+	int ret;
 
-	std::vector<std::string> gga_split = split(gga, ",");
-	if (gga_split.size() != 15)
+	*len = 0;
+	if ((ret = decode_nmea_gga(buffer, &gga)) < 0)
 	{
-		return;
+		slog(LOG_INFO, 0, "input_gga: %s: %.82s", nmea_errmsg(ret), buffer ? buffer : "");
+		return ret;
 	}
-	char  ns = 'N', ew = 'E';
-	double lat = atof(gga_split[2].c_str());
-	ns = gga_split[3][0];
-	double lon = atof(gga_split[4].c_str());
-	ew = gga_split[5][0];
-	double alt = atof(gga_split[9].c_str());
-	double msl = atof(gga_split[11].c_str());
-
-	pos[0] = (ns == 'N' ? 1.0 : -1.0)*dmm2deg(lat)*D2R;
-	pos[1] = (ew == 'E' ? 1.0 : -1.0)*dmm2deg(lon)*D2R;
-	pos[2] = alt + msl;
+	pos2ecef(gga.pos, xyz);
 
-	pos2ecef(pos, xyz);
+	sapcorda_ssr::getInstance()->merge_ssr_to_obs(xyz,out_buffer,size,len);
+	return 0;
+}
 
-	sapcorda_ssr::getInstance()->merge_ssr_to_obs(xyz,out_buffer,len);
+unsigned char* sapcorda_ssr::merge_ssr_to_obs(double* rovpos, unsigned char*out_buffer, uint32_t size, uint32_t *len)
+{
+	vrs_out_t out;
+	vrs_out_init(&out, out_buffer, size, NULL, 0);
+	*len = merge_ssr_to_out(rovpos, &out) < 0 ? 0 : (uint32_t)out.nbyte;
+	return out_buffer;
 }
 
-unsigned char* sapcorda_ssr::merge_ssr_to_obs(double* rovpos, unsigned char*out_buffer, uint32_t *len)
+/* append the vrs epoch of a rover to out, -1 if it does not fit or there is no otl grid */
+int sapcorda_ssr::merge_ssr_to_out(double* rovpos, vrs_out_t* out)
 {
+	if (!otl_grid_ready()) return -1;
 	vec_t vec_vrs[MAXOBS] = { 0 };
     int unpair_sat[MAXOBS] = { 0 };
     int unpair_nav[MAXOBS] = { 0 };
     int unpair_ssr[MAXOBS] = { 0 };
-	gtime_t teph = timeget();
-	teph = timeadd(teph, 18.0);
+	gtime_t teph = gpst_now();
 	sap_ssr_t *sap_ssr = m_spartn_out.ssr;
 	gad_ssr_t *sap_gad = m_spartn_out.ssr_gad;
     vtec_t    *sap_vtec =m_spartn_out.vtec;
 	nav_t *nav = &m_rtcm.nav;
     nav_t temp_nav = { 0 };
-    sap_ssr_t temp_ssr[SSR_NUM] = { 0 };
+    std::vector<sap_ssr_t> temp_ssr(sap_ssr, sap_ssr + SSR_NUM);
     memcpy(&temp_nav, nav, sizeof(nav_t));
-    memcpy(&temp_ssr, sap_ssr, sizeof(sap_ssr_t));
     uint32_t i, j, nsat, unpair_num;
     int prn, sat, sys;
 	uint8_t ssr_offset = m_spartn_out.ssr_offset;
@@ -212,22 +346,22 @@ unsigned char* sapcorda_ssr::merge_ssr_to_obs(double* rovpos, unsigned char*out_
 	{
 		int nav_iod = -1;
 		int sys = sap_ssr[i].sys;
-		if (sys == 0)
+		if (sys != SPARTN_GLO)
 		{
 			for (j = 0; j < nav->n; j++)
 			{
-				if (sap_ssr[i].prn == nav->eph[j].sat)
+				if (sap_ssr[i].sat == nav->eph[j].sat)
 				{
 					nav_iod = nav->eph[j].iode;
 					break;
 				}
 			}
 		}
-		else if (sys == 1)
+		else
 		{
 			for (j = 0; j < nav->ng; j++)
 			{
-				if (sap_ssr[i].prn + 40 == nav->geph[j].sat)
+				if (sap_ssr[i].sat == nav->geph[j].sat)
 				{
 					nav_iod = nav->geph[j].iode;
 					break;
@@ -235,13 +369,13 @@ unsigned char* sapcorda_ssr::merge_ssr_to_obs(double* rovpos, unsigned char*out_
 			}
 		}
 		if (nav_iod != sap_ssr[i].iod[0]) continue;
-		double nav_toe = (sys == 0) ? fmod(nav->eph[j].toe.time, 86400) : fmod(nav->geph[j].toe.time, 86400);
-		if (m_fLOG) fprintf(m_fLOG,"ocb:%6.0f,%6.0f,%6.0f,%6.0f,%6.0f,%3i,%3i,%2i,%3i,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f\n",
+		double nav_toe = (sys != SPARTN_GLO) ? fmod(nav->eph[j].toe.time, 86400) : fmod(nav->geph[j].toe.time, 86400);
+		log_file(m_fLOG, "ocb:%6.0f,%6.0f,%6.0f,%6.0f,%6.0f,%3i,%3i,%2i,%3i,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f,%7.3f\n",
 			sap_ssr[i].t0[0], sap_ssr[i].t0[1], sap_ssr[i].t0[2], sap_ssr[i].t0[4], nav_toe, nav_iod, sap_ssr[i].iod[0], sys, sap_ssr[i].prn,
 			sap_ssr[i].deph[0], sap_ssr[i].deph[1], sap_ssr[i].deph[2], sap_ssr[i].dclk,
 			sap_ssr[i].cbias[0], sap_ssr[i].cbias[1], sap_ssr[i].cbias[2], sap_ssr[i].pbias[0], sap_ssr[i].pbias[1], sap_ssr[i].pbias[2]);
 	}
-	if (m_fLOG) fprintf(m_fLOG,"\n");
+	log_file(m_fLOG, "\n");
 
 	obs_t* obs_vrs = &sapcorda_ssr::getInstance()->m_obs_vrs;
 	memset(obs_vrs, 0, sizeof(obs_t));
@@ -256,7 +390,7 @@ unsigned char* sapcorda_ssr::merge_ssr_to_obs(double* rovpos, unsigned char*out_
         {
             sat = unpair_sat[i];
             sys = satsys(sat, &prn);
-            if (sys == _SYS_GPS_ && m_last_eph_map.size() > 0)
+            if (sys != _SYS_GLO_ && m_last_eph_map.size() > 0)
             {
                 if (m_last_eph_map.find(sat) != m_last_eph_map.end()) {
                     memcpy(&temp_nav.eph[unpair_nav[i]], &m_last_eph_map[sat], sizeof(eph_t));
@@ -293,7 +427,7 @@ unsigned char* sapcorda_ssr::merge_ssr_to_obs(double* rovpos, unsigned char*out_
                 }
             }
         }
-        nsat = satposs_sap_rcv(teph, rovpos, vec_vrs, &temp_nav, temp_ssr, EPHOPT_SSRSAP);
+        nsat = satposs_sap_rcv(teph, rovpos, vec_vrs, &temp_nav, temp_ssr.data(), EPHOPT_SSRSAP);
     }
 
 	obs_vrs->time = teph;
@@ -305,17 +439,16 @@ unsigned char* sapcorda_ssr::merge_ssr_to_obs(double* rovpos, unsigned char*out_
 	}
 	nsat = compute_vector_data(obs_vrs, vec_vrs);
 
-    int vrs_ret = gen_obs_from_ssr(teph, rovpos, sap_ssr, sap_gad, sap_vtec, obs_vrs, vec_vrs, 0.0, m_fLOG);
+    int vrs_ret = gen_obs_from_ssr(teph, rovpos, &m_astro, sap_ssr, sap_gad, m_spartn_out.hpac_grid, sap_vtec, obs_vrs, vec_vrs, 0.0, m_fLOG);
 	//for (i = 0; i < obs_vrs->n; ++i) {
 	//	if (m_fLOG) fprintf(m_fLOG,"obs: %12I64i,%3i,%14.4f,%14.4f,%14.4f,%14.4f\n",
 	//		obs_vrs->time.time, obs_vrs->data[i].sat, obs_vrs->data[i].P[0], obs_vrs->data[i].P[1], obs_vrs->data[i].L[0], obs_vrs->data[i].L[1]);
 	//}
 	//if (m_fLOG) fprintf(m_fLOG, "\n");
 
-	rtcm_t out_rtcm = { 0 };
-	*len = gen_rtcm_vrsdata(obs_vrs, &out_rtcm, out_buffer);
-	return out_buffer;
-	if(m_fLOG) fflush(m_fLOG);
+	int ret = gen_rtcm_vrsout(obs_vrs, &m_out_rtcm, out);
+	log_file_flush(m_fLOG);
+	return ret;
 }
 
 void input_ssr_test(unsigned char* buffer, uint32_t len)
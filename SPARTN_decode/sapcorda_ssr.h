@@ -3,8 +3,10 @@
 #include "spartn.h"
 #include <mutex>
 #include "rtcm.h"
+#include "GenVRSObs.h"
 #include <vector>
 #include <map>
+#include <string>
 using namespace std;
 
 class sapcorda_ssr
@@ -28,6 +30,11 @@ public:
 private:
 	raw_spartn_t m_spartn;
 	FILE* m_fLOG;
+	astro_t m_astro;			//astronomical context shared by the rovers
+	rtcm_t m_out_rtcm;			//rtcm encoder of the vrs output, keeps the msm layouts
+	string m_state_file;		//snapshot written every m_state_interval s, empty: none
+	double m_state_interval;
+	gtime_t m_state_time;		//time of the last snapshot
 public:
 	sapcorda_ssr();
 	~sapcorda_ssr();
@@ -36,6 +43,12 @@ public:
 	void save_last_eph(nav_t * last_nav, nav_t * nav);
 	void save_last_geph(nav_t * last_nav, nav_t * nav);
 	void save_last_ssr(sap_ssr_t * last_ssr, uint8_t ssr_offset, spartn_t * spartn);
-	unsigned char* merge_ssr_to_obs(double * rovpos, unsigned char*out_buffer, uint32_t *len);
+	int merge_ssr_to_out(double * rovpos, vrs_out_t * out);
+	unsigned char* merge_ssr_to_obs(double * rovpos, unsigned char*out_buffer, uint32_t size, uint32_t *len);
+	int save_state(const char* file);
+	int load_state(const char* file, double maxage);
+	int set_state_file(const char* file, double interval, double maxage);
+	int set_otl_grid(const char* file);
+	void check_state();
 };
 
@@ -1,3 +1,4 @@
+#define LOG_SYS LOG_SYS_FRAME
 #include <stdio.h>
 #include <memory.h>
 #include "crc.h"
@@ -33,23 +34,18 @@ int decode_Group_Authentication(raw_spartn_t* spartn) {
     return 1;
 }
 
+//decoders by message type, each resolves its subtype layout with spartn_gnss()
+typedef int (*spartn_decoder_t)(raw_spartn_t* spartn, spartn_t* spartn_out);
+static const spartn_decoder_t spartn_decoder[] = {
+    decode_OCB_message,     //0: OCB
+    decode_HPAC_message,    //1: HPAC
+    decode_GAD_message,     //2: GAD
+    decode_LPAC_message,    //3: LPAC
+};
+
 int decode_spartn(raw_spartn_t* spartn, spartn_t* spartn_out) {
-    switch (spartn->type)
-    {
-    case 0:
-        return decode_OCB_message(spartn, spartn_out);
-        break;
-    case 1:
-        return decode_HPAC_message(spartn, spartn_out);
-        break;
-    case 2:
-        return decode_GAD_message(spartn, spartn_out);
-        break;
-    case 3:
-        return decode_LPAC_message(spartn, spartn_out);
-        break;
-    }
-    return 0;
+    if (spartn->type >= sizeof(spartn_decoder) / sizeof(spartn_decoder[0])) return 0;
+    return spartn_decoder[spartn->type](spartn, spartn_out);
 }
 
 int input_spartn_data(raw_spartn_t* spartn, spartn_t* spartn_out, uint8_t data) {
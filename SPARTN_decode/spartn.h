@@ -9,16 +9,19 @@ extern "C"
 #endif
 
 #define SPARTN_PREAMB 0x73 
+#define SPARTN_MAX_LEN 1023		//max payload bytes (10-bit length)
 #define RAP_NUM       42
-#define SSR_NUM       24
+#define SSR_NUM       128
 #define AREA_NUM      4
 #define VTEC_NUM	  64
 #define SAT_MAX		  32
 #define HPAC_MAX_ARAE 10
+#define HPAC_GRID_PTS 64		//grid points kept per area, SF034 * SF035 <= 64
+#define HPAC_RES_POOL 2048		//ionosphere residuals of one area block, 1023 bytes / 4 bits
+#define HPAC_GRID_SAT 64		//satellite rows of an area residual grid
 
 #define SSR_SAP 
 #define DAY_SECONDS 86400
-//#define USE_Tropo_Iono_2
 
 //=============================
 // SM 0-0/0-1  OCB messages 
@@ -30,6 +33,29 @@ extern "C"
 
 #define Bias_Effective_Len 3
 
+//=============================
+// OCB/HPAC subtype (GNSS) layout
+//=============================
+#define SPARTN_GPS     0
+#define SPARTN_GLO     1
+#define SPARTN_GAL     2
+#define SPARTN_BDS     3
+#define SPARTN_QZS     4
+#define SPARTN_GNSS_NUM 5
+#define SAT_MASK_MAX    64		//longest satellite mask of all subtypes (SF011..SF095)
+
+typedef struct {
+	char sys;								//system code for table log
+	const char* mask_name;					//SF011/SF012/SF093/SF094/SF095
+	uint8_t mask_len[4];					//satellite mask length by mask type
+	const char* iode_name;					//SF018/SF019/SF099/SF100/SF101
+	uint8_t iode_len;
+	uint8_t bias_mask_len[2];				//phase/code bias mask length by length flag
+	uint8_t phase_bias_len;					//phase biases in use
+	uint8_t code_bias_len;					//code biases in use
+	const char* signal[Bias_Effective_Len];	//signals of the used biases
+} spartn_gnss_t;
+
 typedef struct {
 	uint32_t SF005_SIOU;
 	uint8_t SF010_EOS;
@@ -37,7 +63,7 @@ typedef struct {
 	uint8_t SF008_Yaw_present_flag;
 	uint8_t SF009_Satellite_reference_datum;
 	uint8_t SF016_SF017_Ephemeris_type;
-	uint8_t SF011_SF012_satellite_mask[64];
+	uint8_t SF011_SF012_satellite_mask[SAT_MASK_MAX];
 	uint8_t Satellite_mask_len;
 } OCB_header_t;
 
@@ -136,13 +162,8 @@ typedef struct {
 		HPAC_troposphere_large_t large_coefficient;
 	};
 	//SF040_Tropo == 2
-#ifdef USE_Tropo_Iono_2
 	uint8_t SF051_Troposphere_residual_field_size;
-	union {
-		uint8_t SF052[128];
-		uint8_t SF053[128];
-	};
-#endif // USE_Tropo_Iono_2
+	int16_t residual[HPAC_GRID_PTS];		//SF052/SF053, 0.004 m
 }HPAC_troposphere_t;
 
 typedef struct {
@@ -168,16 +189,16 @@ typedef struct {
 		HPAC_ionosphere_large_t large_coefficient;
 	};
 	//SF040_Iono == 2
-#ifdef USE_Tropo_Iono_2
 	uint8_t SF063_Ionosphere_residual_field_size;
-	uint16_t ionosphere_residual_slant_delay[128];
-#endif // USE_Tropo_Iono_2
+	uint16_t residual_offset;				//first residual in HPAC_ionosphere_t.residual
 }HPAC_ionosphere_satellite_t;
 
 typedef struct {
 	uint8_t SF054_Ionosphere_equation_type;
 	HPAC_ionosphere_satellite_t ionosphere_satellite[SAT_MAX];
 	uint8_t ionosphere_satellite_num;
+	uint16_t residual_num;
+	int16_t residual[HPAC_RES_POOL];		//SF064-SF067 of all satellites, 0.04 TECU
 }HPAC_ionosphere_t;
 
 typedef struct {
@@ -251,6 +272,17 @@ typedef struct {
 //	LPAC_area_t areas[4];
 //}LPAC_t;
 
+typedef struct {						//HPAC residual grid of an area (SF040 == 2), shared by the satellites
+	int     areaId;						//area of the grid, 0: free
+	uint8_t npt;						//grid points, SF039
+	uint8_t nsat;						//satellite rows
+	double  tro_time;					//time of the troposphere residuals (gpst), 0: none
+	int16_t tro[HPAC_GRID_PTS];			//troposphere residual, 0.004 m
+	uint8_t sat[HPAC_GRID_SAT];			//satellite of each row
+	double  time[HPAC_GRID_SAT];		//time of each row (gpst)
+	int16_t ion[HPAC_RES_POOL];			//ionosphere residual rows of npt points, 0.04 TECU
+}hpac_grid_t;
+
 typedef struct {
 	int     areaId;
 	double  rap_lon;
@@ -275,9 +307,9 @@ typedef struct {                            /* SSR correction type */
     double  pbias[3];                      /* phase biases (m) */
     double  yaw_ang;                       /* yaw angle and yaw rate (deg,deg/s) */
 	int     areaId[RAP_NUM];
-    double  ave_htd;
-    double  tro_coef[3 * RAP_NUM];                  /* T00,T01,T10*/
-    double  stec_coef[3 * RAP_NUM];                 /* C00,C01.C10*/
+    double  ave_htd[RAP_NUM];              /* area average hydrostatic delay (m) */
+    double  tro_coef[4 * RAP_NUM];                  /* T00,T01,T10,T11*/
+    double  stec_coef[4 * RAP_NUM];                 /* C00,C01,C10,C11*/
     int     rap_num;
 } sap_ssr_t;
 
@@ -308,6 +340,7 @@ typedef struct {
 	uint32_t len;
 	uint32_t time;
 	gad_ssr_t ssr_gad[RAP_NUM];
+	hpac_grid_t hpac_grid[HPAC_MAX_ARAE];	//residual grids, only of the HPAC areas
 	uint8_t ssr_offset;
     uint8_t eos;
 	sap_ssr_t ssr[SSR_NUM];
@@ -338,8 +371,9 @@ typedef struct {
     uint32_t offset;
 } raw_spartn_t;
 
-void decode_GPS_satellite_mask(uint8_t* data, int *pos, uint8_t* satellite_mask, uint8_t *satellite_mask_len);
-void decode_GLONASS_satellite_mask(uint8_t* data, int *pos, uint8_t* satellite_mask, uint8_t *satellite_mask_len);
+const spartn_gnss_t* spartn_gnss(uint32_t Subtype);
+int spartn_satno(uint32_t Subtype, int prn);
+void decode_satellite_mask(uint8_t* data, uint32_t *pos, const spartn_gnss_t* gnss, uint8_t* satellite_mask, uint8_t *satellite_mask_len);
 
 int decode_OCB_message(raw_spartn_t* spartn, spartn_t* spartn_out);
 int decode_HPAC_message(raw_spartn_t* spartn, spartn_t* spartn_out);
@@ -348,6 +382,12 @@ int decode_LPAC_message(raw_spartn_t* spartn, spartn_t* spartn_out);
 
 int input_spartn_data(raw_spartn_t* spartn, spartn_t* spartn_out, uint8_t data);
 
+int encode_OCB_message(uint32_t Subtype, const OCB_header_t* header, const OCB_Satellite_t* sat, int n, uint8_t* payload);
+int encode_HPAC_message(uint32_t Subtype, const HPAC_header_t* header, const HPAC_atmosphere_t* atmosphere, int n, uint8_t* payload);
+int encode_GAD_message(const GAD_header_t* header, const GAD_area_t* area, int n, uint8_t* payload);
+int encode_LPAC_message(const LPAC_header_t* header, const LPAC_area_t* area, int n, uint8_t* payload);
+int encode_spartn_frame(uint32_t type, uint32_t Subtype, uint32_t time, const uint8_t* payload, uint32_t len, uint8_t* buff);
+
 void open_ocb_table_file(const char* filename);
 void open_hpac_table_file(const char* filename);
 void open_gad_table_file(const char* filename);
@@ -359,7 +399,10 @@ void close_gad_table_file();
 void close_lpac_table_file();
 
 void ssr_append_ocb_sat(spartn_t* spartn, OCB_Satellite_t* sat_obc);
+void hpac_tro_coef(const HPAC_troposphere_t * troposphere, double * coef);
+void hpac_ion_coef(const HPAC_ionosphere_satellite_t * sat, double * coef);
 void ssr_append_hpac_sat(spartn_t * spartn, HPAC_atmosphere_t * atmosphere);
+void ssr_append_hpac_grid(spartn_t * spartn, HPAC_atmosphere_t * atmosphere);
 void ssr_append_gad_sat(spartn_t * spartn, GAD_area_t * area);
 void ssr_append_lpac_area(spartn_t * spartn, LPAC_area_t * area);
 
@@ -1,25 +1,22 @@
+#define LOG_SYS LOG_SYS_GAD
 #include "spartn.h"
 #include "log.h"
 #include "bits.h"
+#include "spartn_schema.h"
 
-FILE*  gad_table_file = NULL;
+#define gad_table_file log_table[LOG_SYS_GAD]
 
 void log_gad_title_to_table() {
 	table_log_ex(gad_table_file, "%9s,%5s,%8s,%8s,%5s,%5s,%7s,%7s", "Time", "area", "lat", "lon", "lat_c", "lon_c", "lat_s", "lon_s");
 }
 
 void open_gad_table_file(const char* filename) {
-	if (filename) {
-		open_table_file_ex(&gad_table_file, filename);
-	}
-	else {
-		open_table_file_ex(&gad_table_file, "../GAD_message.log");
-	}
+	log_table_open(LOG_SYS_GAD, filename ? filename : "../GAD_message.log");
 	log_gad_title_to_table();
 }
 
 void close_gad_table_file() {
-	close_table_file_ex(&gad_table_file);
+	log_table_close(LOG_SYS_GAD);
 }
 
 void log_gad_area_to_table(uint32_t time, GAD_area_t* area) {
@@ -45,21 +42,21 @@ void log_gad_area_to_table(uint32_t time, GAD_area_t* area) {
 //Table 6.21 Area definition block 
 void decode_Area_definition_block(raw_spartn_t* spartn, GAD_area_t* area, int tab) {
 	uint8_t* payload = spartn->payload;
-	area->SF031_Area_ID = getbitu(payload, spartn->offset, 8);  spartn->offset += 8; slog(LOG_DEBUG, tab, "SF031_Area_ID = %d", area->SF031_Area_ID);
-	area->SF032_Area_reference_latitude = getbitu(payload, spartn->offset, 11)*0.1 - 90;  spartn->offset += 11; slog(LOG_DEBUG, tab, "SF032_Area_reference_latitude = %f", area->SF032_Area_reference_latitude);
-	area->SF033_Area_reference_longitude = getbitu(payload, spartn->offset, 12)*0.1 - 180;  spartn->offset += 12; slog(LOG_DEBUG, tab, "SF033_Area_reference_longitude = %f", area->SF033_Area_reference_longitude);
-	area->SF034_Area_latitude_grid_node_count = getbitu(payload, spartn->offset, 3);  spartn->offset += 3; slog(LOG_DEBUG, tab, "SF034_Area_latitude_grid_node_count = %d", area->SF034_Area_latitude_grid_node_count);
-	area->SF035_Area_longitude_grid_node_count = getbitu(payload, spartn->offset, 3);  spartn->offset += 3; slog(LOG_DEBUG, tab, "SF035_Area_longitude_grid_node_count = %d", area->SF035_Area_longitude_grid_node_count);
-	area->SF036_Area_latitude_grid_node_spacing = getbitu(payload, spartn->offset, 5)*0.1 + 0.1;  spartn->offset += 5; slog(LOG_DEBUG, tab, "SF036_Area_latitude_grid_node_spacing = %f", area->SF036_Area_latitude_grid_node_spacing);
-	area->SF037_Area_longitude_grid_node_spacing = getbitu(payload, spartn->offset, 5)*0.1 + 0.1;  spartn->offset += 5; slog(LOG_DEBUG, tab, "SF037_Area_longitude_grid_node_spacing = %f", area->SF037_Area_longitude_grid_node_spacing);
+	area->SF031_Area_ID = SF031_get(payload, &spartn->offset); slog(LOG_DEBUG, tab, "SF031_Area_ID = %d", area->SF031_Area_ID);
+	area->SF032_Area_reference_latitude = SF032_get(payload, &spartn->offset); slog(LOG_DEBUG, tab, "SF032_Area_reference_latitude = %f", area->SF032_Area_reference_latitude);
+	area->SF033_Area_reference_longitude = SF033_get(payload, &spartn->offset); slog(LOG_DEBUG, tab, "SF033_Area_reference_longitude = %f", area->SF033_Area_reference_longitude);
+	area->SF034_Area_latitude_grid_node_count = SF034_get(payload, &spartn->offset); slog(LOG_DEBUG, tab, "SF034_Area_latitude_grid_node_count = %d", area->SF034_Area_latitude_grid_node_count);
+	area->SF035_Area_longitude_grid_node_count = SF035_get(payload, &spartn->offset); slog(LOG_DEBUG, tab, "SF035_Area_longitude_grid_node_count = %d", area->SF035_Area_longitude_grid_node_count);
+	area->SF036_Area_latitude_grid_node_spacing = SF036_get(payload, &spartn->offset); slog(LOG_DEBUG, tab, "SF036_Area_latitude_grid_node_spacing = %f", area->SF036_Area_latitude_grid_node_spacing);
+	area->SF037_Area_longitude_grid_node_spacing = SF037_get(payload, &spartn->offset); slog(LOG_DEBUG, tab, "SF037_Area_longitude_grid_node_spacing = %f", area->SF037_Area_longitude_grid_node_spacing);
 }
 //Table 6.20 Header block
 void decode_GAD_header_block(raw_spartn_t* spartn, GAD_header_t* header,int tab) {
 	uint8_t* payload = spartn->payload;
-	header->SF005_SIOU = getbitu(payload, spartn->offset, 9); spartn->offset += 9; slog(LOG_DEBUG, tab, "SF005_SIOU = %d", header->SF005_SIOU);
-	header->SF069_Reserved = getbitu(payload, spartn->offset, 1);  spartn->offset += 1; slog(LOG_DEBUG, tab, "SF069_Reserved = %d", header->SF069_Reserved);
-	header->SF068_AIOU = getbitu(payload, spartn->offset, 4);  spartn->offset += 4; slog(LOG_DEBUG, tab, "SF068_AIOU = %d", header->SF068_AIOU);
-	header->SF030_Area_count = getbitu(payload, spartn->offset, 5) + 1;  spartn->offset += 5; slog(LOG_DEBUG, tab, "SF030_Area_count = %d", header->SF030_Area_count);
+	header->SF005_SIOU = SF005_get(payload, &spartn->offset); slog(LOG_DEBUG, tab, "SF005_SIOU = %d", header->SF005_SIOU);
+	header->SF069_Reserved = SF069_get(payload, &spartn->offset); slog(LOG_DEBUG, tab, "SF069_Reserved = %d", header->SF069_Reserved);
+	header->SF068_AIOU = SF068_get(payload, &spartn->offset); slog(LOG_DEBUG, tab, "SF068_AIOU = %d", header->SF068_AIOU);
+	header->SF030_Area_count = SF030_get(payload, &spartn->offset); slog(LOG_DEBUG, tab, "SF030_Area_count = %d", header->SF030_Area_count);
 }
 // SM 2-0 GAD messages
 extern int decode_GAD_message(raw_spartn_t* spartn, spartn_t* spartn_out)
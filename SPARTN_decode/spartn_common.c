@@ -1,54 +1,59 @@
+#define LOG_SYS LOG_SYS_FRAME
 #include "spartn.h"
 #include "log.h"
 #include "bits.h"
+#include "rtcm.h"
 #define Leap_Sec 18.0
 #define GLO_GPS_TD  10800
+#define BDS_GPS_TD  14.0
 
-void decode_GPS_satellite_mask(uint8_t* data, int *pos, uint8_t* satellite_mask, uint8_t *satellite_mask_len) {
-	int i,offset = *pos;
-	int tab = 2;
-	uint8_t SF011_Type = getbitu(data, offset, 2);  offset += 2; slog(LOG_DEBUG, tab, "SF011_Type = %d", SF011_Type);
-	uint8_t SF011_Len = 0;
-	switch (SF011_Type) {
-	case 0:SF011_Len = 32; break;
-	case 1:SF011_Len = 44; break;
-	case 2:SF011_Len = 56; break;
-	case 3:SF011_Len = 64; break;
+//Table 6.3/6.17 satellite mask, bias mask and IODE layout per subtype
+static const spartn_gnss_t spartn_gnss_table[SPARTN_GNSS_NUM] = {
+	{ 'G', "SF011", { 32, 44, 56, 64 }, "SF018_IODE",  8, {  6, 11 }, 3, 3, { "L1C", "L2W", "L2L" } },
+	{ 'R', "SF012", { 24, 36, 48, 63 }, "SF019_IODE",  7, {  5,  9 }, 2, 2, { "L1C", "L2C", ""    } },
+	{ 'E', "SF093", { 36, 45, 54, 64 }, "SF099_IODE", 10, {  8, 13 }, 3, 3, { "L1C", "L5Q", "L7Q" } },
+	{ 'C', "SF094", { 37, 46, 55, 64 }, "SF100_IODE",  8, {  8, 13 }, 3, 3, { "L2I", "L5Q", "L7I" } },
+	{ 'J', "SF095", { 10, 40, 48, 64 }, "SF101_IODE",  8, {  6, 11 }, 3, 3, { "L1C", "L2L", "L5Q" } },
+};
+
+const spartn_gnss_t* spartn_gnss(uint32_t Subtype) {
+	return Subtype < SPARTN_GNSS_NUM ? &spartn_gnss_table[Subtype] : NULL;
+}
+
+//satellite number of a subtype PRN, 0 if the system is not configured (QZSS)
+int spartn_satno(uint32_t Subtype, int prn) {
+	static const int sys[SPARTN_GNSS_NUM] = { _SYS_GPS_, _SYS_GLO_, _SYS_GAL_, _SYS_BDS_, _SYS_QZS_ };
+	return Subtype < SPARTN_GNSS_NUM ? satno(sys[Subtype], prn) : 0;
+}
+
+//SF009 time tag is in the time system of the subtype, t0 is kept in GPS time
+static double ssr_time_tag(const spartn_t* spartn, int sys) {
+	double t = (double)spartn->time;
+	if (sys == SPARTN_GLO) {
+		t += -GLO_GPS_TD + Leap_Sec;
+		if (t < 0) t += DAY_SECONDS / 2;
 	}
-	*satellite_mask_len = SF011_Len;
-	slog(LOG_DEBUG, tab, "SF011_Len = %d", SF011_Len);
-	uint8_t SF011[8] = { 0 };
-	bitscopy(SF011, 0, data, offset, SF011_Len); offset += SF011_Len;
-	bits_to_bytes_array(SF011, satellite_mask, *satellite_mask_len);
-	char str_satellite_mask[65] = { 0 };
-	for (i = 0; i < *satellite_mask_len; i++) {
-		str_satellite_mask[i] = satellite_mask[i] ? '1' : '0';
+	else if (sys == SPARTN_BDS) {
+		t += BDS_GPS_TD;
 	}
-	slog(LOG_DEBUG, tab, "SF011 = %s", str_satellite_mask);
-	*pos = offset;
+	return t;
 }
 
-void decode_GLONASS_satellite_mask(uint8_t* data, int *pos, uint8_t* satellite_mask, uint8_t *satellite_mask_len) {
+void decode_satellite_mask(uint8_t* data, uint32_t *pos, const spartn_gnss_t* gnss, uint8_t* satellite_mask, uint8_t *satellite_mask_len) {
 	int i,offset = *pos;
 	int tab = 2;
-	uint8_t SF012_Type = getbitu(data, offset, 2);  offset += 2; slog(LOG_DEBUG, tab, "SF012_Type = %d", SF012_Type);
-	uint8_t SF012_Len = 0;
-	switch (SF012_Type) {
-	case 0:SF012_Len = 24; break;
-	case 1:SF012_Len = 36; break;
-	case 2:SF012_Len = 48; break;
-	case 3:SF012_Len = 63; break;
-	}
-	*satellite_mask_len = SF012_Len;
-	slog(LOG_DEBUG, tab, "SF012_Len = %d", SF012_Len);
-	uint8_t SF012[8] = { 0 };
-	bitscopy(SF012, 0, data, offset, SF012_Len); offset += SF012_Len;
-	bits_to_bytes_array(SF012, satellite_mask, *satellite_mask_len);
-	char str_satellite_mask[64] = { 0 };
+	uint8_t mask_type = getbitu(data, offset, 2);  offset += 2; slog(LOG_DEBUG, tab, "%s_Type = %d", gnss->mask_name, mask_type);
+	uint8_t mask_len = gnss->mask_len[mask_type];
+	*satellite_mask_len = mask_len;
+	slog(LOG_DEBUG, tab, "%s_Len = %d", gnss->mask_name, mask_len);
+	uint8_t mask[8] = { 0 };
+	bitscopy(mask, 0, data, offset, mask_len); offset += mask_len;
+	bits_to_bytes_array(mask, satellite_mask, *satellite_mask_len);
+	char str_satellite_mask[65] = { 0 };
 	for (i = 0; i < *satellite_mask_len; i++) {
 		str_satellite_mask[i] = satellite_mask[i] ? '1' : '0';
 	}
-	slog(LOG_DEBUG, tab, "SF012 = %s", str_satellite_mask);
+	slog(LOG_DEBUG, tab, "%s = %s", gnss->mask_name, str_satellite_mask);
 	*pos = offset;
 }
 
@@ -88,15 +93,16 @@ sap_ssr_t* suitable_ssr(spartn_t* spartn, int prn, int sys) {
 
 void ssr_append_ocb_sat(spartn_t* spartn, OCB_Satellite_t* sat_obc) {
 	int j = 0;
+	int sat = spartn_satno(spartn->Subtype, sat_obc->PRN_ID);
+	if (sat == 0) return;
 
 	sap_ssr_t* ssr = suitable_ssr(spartn, sat_obc->PRN_ID, spartn->Subtype);
 	ssr->prn = sat_obc->PRN_ID;
 	ssr->sys = spartn->Subtype;
-	ssr->sat = ssr->sys * 40 + ssr->prn;
+	ssr->sat = sat;
 
 	if (sat_obc->orbit.SF018_SF019_IODE != 0) {
-		ssr->t0[0] = (double)spartn->time + (ssr->sys ? (-GLO_GPS_TD + Leap_Sec) : 0);
-		if (ssr->sys == 1 && ssr->t0[0] < 0) ssr->t0[0] += DAY_SECONDS / 2;
+		ssr->t0[0] = ssr_time_tag(spartn, ssr->sys);
 		ssr->iod[0] = sat_obc->orbit.SF018_SF019_IODE;
 		ssr->deph[0] = sat_obc->orbit.SF020_radial;
 		ssr->deph[1] = sat_obc->orbit.SF020_along;
@@ -104,8 +110,7 @@ void ssr_append_ocb_sat(spartn_t* spartn, OCB_Satellite_t* sat_obc) {
 		ssr->yaw_ang = sat_obc->orbit.SF021_Satellite_yaw;
 	}
 
-	ssr->t0[1] = (double)spartn->time + (ssr->sys ? (-GLO_GPS_TD + Leap_Sec) : 0);
-	if (ssr->sys == 1 && ssr->t0[1] < 0)   ssr->t0[1] += DAY_SECONDS / 2;
+	ssr->t0[1] = ssr_time_tag(spartn, ssr->sys);
 	ssr->iod[1] = sat_obc->clock.SF022_IODE_continuity;
 	ssr->ure = sat_obc->clock.SF024_User_range_error;
 	ssr->dclk = sat_obc->clock.SF020_Clock_correction;
@@ -118,8 +123,7 @@ void ssr_append_ocb_sat(spartn_t* spartn, OCB_Satellite_t* sat_obc) {
 		}
 	}
 	if (update_num > 0) {
-		ssr->t0[2] = (double)spartn->time + (ssr->sys ? (-GLO_GPS_TD + Leap_Sec) : 0);
-		if (ssr->sys == 1 && ssr->t0[2] < 0)   ssr->t0[2] += DAY_SECONDS / 2;
+		ssr->t0[2] = ssr_time_tag(spartn, ssr->sys);
 	}
 	update_num = 0;
 	for (j = 0; j < Bias_Effective_Len; ++j) {
@@ -131,8 +135,39 @@ void ssr_append_ocb_sat(spartn_t* spartn, OCB_Satellite_t* sat_obc) {
 		}
 	}
 	if (update_num > 0) {
-		ssr->t0[3] = (double)spartn->time + (ssr->sys ? (-GLO_GPS_TD + Leap_Sec) : 0);
-		if (ssr->sys == 1 && ssr->t0[3] < 0)   ssr->t0[3] += DAY_SECONDS / 2;
+		ssr->t0[3] = ssr_time_tag(spartn, ssr->sys);
+	}
+}
+
+//T00,T01,T10,T11 of the coefficient block selected by SF044, terms not sent are 0
+void hpac_tro_coef(const HPAC_troposphere_t* troposphere, double* coef) {
+	if (troposphere->SF044_Troposphere_polynomial_coefficient_size_indicator) {
+		coef[0] = troposphere->large_coefficient.SF048_T00;
+		coef[1] = troposphere->large_coefficient.SF049_T01;
+		coef[2] = troposphere->large_coefficient.SF049_T10;
+		coef[3] = troposphere->large_coefficient.SF050_T11;
+	}
+	else {
+		coef[0] = troposphere->small_coefficient.SF045_T00;
+		coef[1] = troposphere->small_coefficient.SF046_T01;
+		coef[2] = troposphere->small_coefficient.SF046_T10;
+		coef[3] = troposphere->small_coefficient.SF047_T11;
+	}
+}
+
+//C00,C01,C10,C11 of the coefficient block selected by SF056, terms not sent are 0
+void hpac_ion_coef(const HPAC_ionosphere_satellite_t* sat, double* coef) {
+	if (sat->SF056_Ionosphere_satellite_polynomial_block) {
+		coef[0] = sat->large_coefficient.SF060_C00;
+		coef[1] = sat->large_coefficient.SF061_C01;
+		coef[2] = sat->large_coefficient.SF061_C10;
+		coef[3] = sat->large_coefficient.SF062_C11;
+	}
+	else {
+		coef[0] = sat->small_coefficient.SF057_C00;
+		coef[1] = sat->small_coefficient.SF058_C01;
+		coef[2] = sat->small_coefficient.SF058_C10;
+		coef[3] = sat->small_coefficient.SF059_C11;
 	}
 }
 
@@ -144,35 +179,91 @@ void ssr_append_hpac_sat(spartn_t* spartn, HPAC_atmosphere_t* atmosphere) {
 		ssr->rap_num = 0;
 		if (ssr->prn == 0) break;
 		if (ssr->sys != spartn->Subtype) continue;
-		ssr->t0[4] = (double)spartn->time + (ssr->sys ? (-GLO_GPS_TD + Leap_Sec) : 0);
-		ssr->t0[5] = (double)spartn->time + (ssr->sys ? (-GLO_GPS_TD + Leap_Sec) : 0);
-		if (ssr->sys == 1)
-		{
-			if (ssr->t0[4] < 0) ssr->t0[4] += DAY_SECONDS / 2;
-			if (ssr->t0[5] < 0) ssr->t0[5] += DAY_SECONDS / 2;
-		}
+		ssr->t0[4] = ssr_time_tag(spartn, ssr->sys);
+		ssr->t0[5] = ssr->t0[4];
 
 		for (m = 0; m < RAP_NUM; ++m) {
 			if (ssr->areaId[m] == atmosphere->area.SF031_Area_ID) break;
 			if (ssr->areaId[m] == 0) break;
 		}
+		if (m >= RAP_NUM) continue;
 
 		ssr->areaId[m] = atmosphere->area.SF031_Area_ID;
-		ssr->ave_htd = atmosphere->troposphere.SF043_Area_average_vertical_hydrostatic_delay;
-		ssr->tro_coef[(m + ssr->rap_num) * 3 + 0] = atmosphere->troposphere.small_coefficient.SF045_T00;
-		ssr->tro_coef[(m + ssr->rap_num) * 3 + 1] = atmosphere->troposphere.small_coefficient.SF046_T01;
-		ssr->tro_coef[(m + ssr->rap_num) * 3 + 2] = atmosphere->troposphere.small_coefficient.SF046_T10;
+		ssr->ave_htd[m] = atmosphere->troposphere.SF043_Area_average_vertical_hydrostatic_delay;
+		hpac_tro_coef(&atmosphere->troposphere, &ssr->tro_coef[m * 4]);
 		for (n = 0; n < atmosphere->ionosphere.ionosphere_satellite_num && n < SAT_MAX; ++n) {
 			if (ssr->prn == atmosphere->ionosphere.ionosphere_satellite[n].PRN_ID) {
-				ssr->stec_coef[(m + ssr->rap_num) * 3 + 0] = atmosphere->ionosphere.ionosphere_satellite[n].small_coefficient.SF057_C00;
-				ssr->stec_coef[(m + ssr->rap_num) * 3 + 1] = atmosphere->ionosphere.ionosphere_satellite[n].small_coefficient.SF058_C01;
-				ssr->stec_coef[(m + ssr->rap_num) * 3 + 2] = atmosphere->ionosphere.ionosphere_satellite[n].small_coefficient.SF058_C10;
+				hpac_ion_coef(&atmosphere->ionosphere.ionosphere_satellite[n], &ssr->stec_coef[m * 4]);
 				break;
 			}
 		}
 	}
 }
 
+//residual grid of an area, a free grid is taken for a new area
+static hpac_grid_t* suitable_hpac_grid(spartn_t* spartn, int areaId) {
+	int j;
+	for (j = 0; j < HPAC_MAX_ARAE; ++j) {
+		if (spartn->hpac_grid[j].areaId == areaId) return &spartn->hpac_grid[j];
+	}
+	for (j = 0; j < HPAC_MAX_ARAE; ++j) {
+		if (spartn->hpac_grid[j].areaId == 0) {
+			spartn->hpac_grid[j].areaId = areaId;
+			return &spartn->hpac_grid[j];
+		}
+	}
+	return NULL;
+}
+
+//row of a satellite, a new satellite takes a free row or the oldest one
+static int hpac_grid_row(hpac_grid_t* grid, int sat, double time) {
+	int j, row = -1, nrow = HPAC_RES_POOL / grid->npt;
+	if (nrow > HPAC_GRID_SAT) nrow = HPAC_GRID_SAT;
+	for (j = 0; j < grid->nsat; ++j) {
+		if (grid->sat[j] == sat) return j;
+	}
+	if (grid->nsat < nrow) {
+		row = grid->nsat++;
+	}
+	else {
+		for (j = 0, row = 0; j < grid->nsat; ++j) {
+			if (grid->time[j] < grid->time[row]) row = j;
+		}
+		if (grid->time[row] >= time) return -1;
+	}
+	grid->sat[row] = (uint8_t)sat;
+	return row;
+}
+
+void ssr_append_hpac_grid(spartn_t* spartn, HPAC_atmosphere_t* atmosphere) {
+	HPAC_area_t* area = &atmosphere->area;
+	HPAC_ionosphere_t* ionosphere = &atmosphere->ionosphere;
+	hpac_grid_t* grid = NULL;
+	int n, row, sat, npt = area->SF039_Number_grid_points_present;
+	double time = ssr_time_tag(spartn, spartn->Subtype);
+	if (area->SF040_Tropo != 2 && area->SF040_Iono != 2) return;
+	if (npt <= 0 || !(grid = suitable_hpac_grid(spartn, area->SF031_Area_ID))) return;
+	if (npt > HPAC_GRID_PTS) npt = HPAC_GRID_PTS;
+	if (grid->npt != npt) {
+		memset(grid, 0, sizeof(hpac_grid_t));
+		grid->areaId = area->SF031_Area_ID;
+		grid->npt = (uint8_t)npt;
+	}
+	if (area->SF040_Tropo == 2) {
+		memcpy(grid->tro, atmosphere->troposphere.residual, sizeof(int16_t) * npt);
+		grid->tro_time = time;
+	}
+	if (area->SF040_Iono != 2) return;
+	for (n = 0; n < ionosphere->ionosphere_satellite_num && n < SAT_MAX; ++n) {
+		HPAC_ionosphere_satellite_t* sat_ion = &ionosphere->ionosphere_satellite[n];
+		if (sat_ion->residual_offset + npt > ionosphere->residual_num) continue;
+		if (!(sat = spartn_satno(spartn->Subtype, sat_ion->PRN_ID))) continue;
+		if ((row = hpac_grid_row(grid, sat, time)) < 0) continue;
+		memcpy(grid->ion + row * npt, ionosphere->residual + sat_ion->residual_offset, sizeof(int16_t) * npt);
+		grid->time[row] = time;
+	}
+}
+
 void ssr_append_gad_sat(spartn_t* spartn, GAD_area_t* area) {
 	int j = 0;
 	gad_ssr_t* ssr_gad = NULL;
@@ -286,27 +377,14 @@ void ssr_append_lpac_area(spartn_t * spartn, LPAC_area_t * area)
 
 void expanded_full_time(raw_spartn_t* raw_spartn) {
     //to full time
-    if (raw_spartn->Subtype == 0) {
-    	if (raw_spartn->Time_tag_type) {
-            raw_spartn->GNSS_time_type = raw_spartn->GNSS_time_type % (DAY_SECONDS);
-    	}
-    	else {
-    		//if (GPS_DAYS > 0) {
-    		//	raw_spartn->GNSS_time_type = GPS_DAYS * DAY_SECOND + raw_spartn->GNSS_time_type;
-    		//	raw_spartn->Time_tag_type = 1;//modify Time_tag_type
-    		//}
-    	}
+    if (raw_spartn->Time_tag_type) {
+        raw_spartn->GNSS_time_type = raw_spartn->GNSS_time_type % (DAY_SECONDS);
     }
-    else if (raw_spartn->Subtype == 1) {//
-    	if (raw_spartn->Time_tag_type) {
-            raw_spartn->GNSS_time_type = raw_spartn->GNSS_time_type % (DAY_SECONDS);
-    	}
-    	else {
-    		//if (GLONASS_DAYS > 0) {
-    		//	raw_spartn->GNSS_time_type = GLONASS_DAYS * DAY_SECOND + raw_spartn->GNSS_time_type;
-    		//	raw_spartn->Time_tag_type = 1;//modify Time_tag_type
-    		//}
-    	}
+    else {
+        //if (GPS_DAYS > 0) {
+        //	raw_spartn->GNSS_time_type = GPS_DAYS * DAY_SECOND + raw_spartn->GNSS_time_type;
+        //	raw_spartn->Time_tag_type = 1;//modify Time_tag_type
+        //}
     }
     //raw_spartn->GNSS_time_type += 1262304000;
-}
\ No newline at end of file
+}
@@ -0,0 +1,320 @@
+#include <string.h>
+#include "spartn.h"
+#include "bits.h"
+#include "crc.h"
+#include "spartn_schema.h"
+
+#define ENCODE_BUFF_LEN 8192	//scratch for one message before the length check
+
+//satellite mask from PRN list, returns mask length
+static int encode_satellite_mask(uint8_t* data, uint32_t* pos, const spartn_gnss_t* gnss, const uint8_t* prn, int n) {
+	int i, type, max_prn = 0;
+	for (i = 0; i < n; i++) {
+		if (prn[i] > max_prn) max_prn = prn[i];
+	}
+	for (type = 0; type < 3; type++) {
+		if (gnss->mask_len[type] >= max_prn) break;
+	}
+	putbitu(data, *pos, 2, type); *pos += 2;
+	for (i = 0; i < gnss->mask_len[type]; i++) {
+		putbitu(data, *pos + i, 1, 0);
+	}
+	for (i = 0; i < n; i++) {
+		if (prn[i] >= 1 && prn[i] <= gnss->mask_len[type]) putbitu(data, *pos + prn[i] - 1, 1, 1);
+	}
+	*pos += gnss->mask_len[type];
+	return gnss->mask_len[type];
+}
+
+static void encode_bias_mask(uint8_t* data, uint32_t* pos, const uint8_t* mask_array, uint32_t effective_len, const spartn_gnss_t* gnss) {
+	uint32_t i;
+	uint32_t max_len = gnss->bias_mask_len[0];
+	putbitu(data, *pos, 1, 0); *pos += 1;
+	for (i = 0; i < max_len; i++) {
+		putbitu(data, *pos, 1, i < effective_len ? mask_array[i] : 0); *pos += 1;
+	}
+}
+
+//Table 6.4 satellite block
+static void encode_satellite_block(uint8_t* data, uint32_t* pos, const spartn_gnss_t* gnss, const OCB_Satellite_t* sat, uint32_t SF008_Yaw_present_flag) {
+	uint32_t i;
+	const OCB_GPS_bias_t* bias = &sat->GPS_bias;
+	SF013_put(data, pos, sat->SF013_DNU);
+	SF014_put(data, pos, sat->SF014_Orbit_block_0);
+	SF014_put(data, pos, sat->SF014_Clock_block_1);
+	SF014_put(data, pos, sat->SF014_Bias_block_2);
+	SF015_put(data, pos, sat->SF015_Continuity_indicator);
+	//Table 6.5 orbit block
+	if (sat->SF014_Orbit_block_0) {
+		putbitu(data, *pos, gnss->iode_len, sat->orbit.SF018_SF019_IODE); *pos += gnss->iode_len;
+		SF020_put(data, pos, sat->orbit.SF020_radial);
+		SF020_put(data, pos, sat->orbit.SF020_along);
+		SF020_put(data, pos, sat->orbit.SF020_cross);
+		if (SF008_Yaw_present_flag == 1) {
+			SF021_put(data, pos, sat->orbit.SF021_Satellite_yaw);
+		}
+	}
+	//Table 6.6 clock block
+	if (sat->SF014_Clock_block_1) {
+		SF022_put(data, pos, sat->clock.SF022_IODE_continuity);
+		SF020_put(data, pos, sat->clock.SF020_Clock_correction);
+		SF024_put(data, pos, sat->clock.SF024_User_range_error);
+	}
+	//Table 6.7/6.8 bias block
+	if (sat->SF014_Bias_block_2) {
+		encode_bias_mask(data, pos, bias->SF025_phase_bias, gnss->phase_bias_len, gnss);
+		for (i = 0; i < gnss->phase_bias_len; i++) {
+			if (bias->SF025_phase_bias[i] != 1) continue;
+			SF023_put(data, pos, bias->Phase_bias[i].SF023_Fix_flag);
+			SF015_put(data, pos, bias->Phase_bias[i].SF015_Continuity_indicator);
+			SF020_put(data, pos, bias->Phase_bias[i].SF020_Phase_bias_correction);
+		}
+		encode_bias_mask(data, pos, bias->SF027_code_bias, gnss->code_bias_len, gnss);
+		for (i = 0; i < gnss->code_bias_len; i++) {
+			if (bias->SF027_code_bias[i] != 1) continue;
+			SF029_put(data, pos, bias->SF029_Code_bias_correction[i]);
+		}
+	}
+}
+
+static int payload_bytes(const uint8_t* data, uint32_t bits, uint8_t* payload) {
+	uint32_t len = (bits + 7) / 8;
+	if (len > SPARTN_MAX_LEN) return 0;
+	memcpy(payload, data, len);
+	return len;
+}
+
+// SM 0-0/0-1  OCB messages, satellites sorted by PRN, returns payload bytes
+// (0: too long, or more satellites than the satellite mask of the subtype)
+int encode_OCB_message(uint32_t Subtype, const OCB_header_t* header, const OCB_Satellite_t* sat, int n, uint8_t* payload) {
+	uint8_t data[ENCODE_BUFF_LEN] = { 0 };
+	uint8_t prn[SAT_MASK_MAX] = { 0 };
+	uint32_t pos = 0;
+	int i;
+	const spartn_gnss_t* gnss = spartn_gnss(Subtype);
+	if (!gnss || n < 0 || n > gnss->mask_len[3]) return 0;
+	//Table 6.3 Header block
+	SF005_put(data, &pos, header->SF005_SIOU);
+	SF010_put(data, &pos, header->SF010_EOS);
+	SF069_put(data, &pos, header->SF069_Reserved);
+	SF008_put(data, &pos, header->SF008_Yaw_present_flag);
+	SF009_put(data, &pos, header->SF009_Satellite_reference_datum);
+	SF016_put(data, &pos, header->SF016_SF017_Ephemeris_type);
+	for (i = 0; i < n; i++) prn[i] = sat[i].PRN_ID;
+	encode_satellite_mask(data, &pos, gnss, prn, n);
+	//Table 6.4 Satellite block (Repeated)
+	for (i = 0; i < n; i++) {
+		encode_satellite_block(data, &pos, gnss, &sat[i], header->SF008_Yaw_present_flag);
+		if (pos > SPARTN_MAX_LEN * 8) return 0;
+	}
+	return payload_bytes(data, pos, payload);
+}
+
+//Table 6.13 Troposphere data block
+static void encode_troposphere_block(uint8_t* data, uint32_t* pos, const HPAC_area_t* area, const HPAC_troposphere_t* troposphere) {
+	uint8_t eq = troposphere->SF041_Troposphere_equation_type;
+	if (area->SF040_Tropo == 1 || area->SF040_Tropo == 2) {
+		SF041_put(data, pos, troposphere->SF041_Troposphere_equation_type);
+		SF042_put(data, pos, troposphere->SF042_Troposphere_quality);
+		SF043_put(data, pos, troposphere->SF043_Area_average_vertical_hydrostatic_delay);
+		SF044_put(data, pos, troposphere->SF044_Troposphere_polynomial_coefficient_size_indicator);
+		if (troposphere->SF044_Troposphere_polynomial_coefficient_size_indicator) {
+			//Table 6.15
+			const HPAC_troposphere_large_t* large_coefficient = &troposphere->large_coefficient;
+			SF048_put(data, pos, large_coefficient->SF048_T00);
+			if (eq == 1 || eq == 2) {
+				SF049_put(data, pos, large_coefficient->SF049_T01);
+				SF049_put(data, pos, large_coefficient->SF049_T10);
+			}
+			if (eq == 2) SF050_put(data, pos, large_coefficient->SF050_T11);
+		}
+		else {
+			//Table 6.14
+			const HPAC_troposphere_small_t* small_coefficient = &troposphere->small_coefficient;
+			SF045_put(data, pos, small_coefficient->SF045_T00);
+			if (eq == 1 || eq == 2) {
+				SF046_put(data, pos, small_coefficient->SF046_T01);
+				SF046_put(data, pos, small_coefficient->SF046_T10);
+			}
+			if (eq == 2) SF047_put(data, pos, small_coefficient->SF047_T11);
+		}
+	}
+	if (area->SF040_Tropo == 2) {
+		int i;
+		double value;
+		SF051_put(data, pos, troposphere->SF051_Troposphere_residual_field_size);
+		for (i = 0; i < area->SF039_Number_grid_points_present; i++) {
+			value = i < HPAC_GRID_PTS ? troposphere->residual[i] * 0.004 : 0.0;
+			if (troposphere->SF051_Troposphere_residual_field_size) SF053_put(data, pos, value);
+			else SF052_put(data, pos, value);
+		}
+	}
+}
+
+//Table 6.17 Ionosphere satellite block
+static void encode_ionosphere_satellite_block(uint8_t* data, uint32_t* pos, const HPAC_area_t* area, const HPAC_ionosphere_t* ionosphere, const HPAC_ionosphere_satellite_t* sat) {
+	uint8_t eq = ionosphere->SF054_Ionosphere_equation_type;
+	if (area->SF040_Iono == 1 || area->SF040_Iono == 2) {
+		SF055_put(data, pos, sat->SF055_Ionosphere_quality);
+		SF056_put(data, pos, sat->SF056_Ionosphere_satellite_polynomial_block);
+		if (sat->SF056_Ionosphere_satellite_polynomial_block) {
+			//Table 6.19
+			SF060_put(data, pos, sat->large_coefficient.SF060_C00);
+			if (eq == 1 || eq == 2) {
+				SF061_put(data, pos, sat->large_coefficient.SF061_C01);
+				SF061_put(data, pos, sat->large_coefficient.SF061_C10);
+			}
+			if (eq == 2) SF062_put(data, pos, sat->large_coefficient.SF062_C11);
+		}
+		else {
+			//Table 6.18
+			SF057_put(data, pos, sat->small_coefficient.SF057_C00);
+			if (eq == 1 || eq == 2) {
+				SF058_put(data, pos, sat->small_coefficient.SF058_C01);
+				SF058_put(data, pos, sat->small_coefficient.SF058_C10);
+			}
+			if (eq == 2) SF059_put(data, pos, sat->small_coefficient.SF059_C11);
+		}
+	}
+	if (area->SF040_Iono == 2) {
+		int i;
+		double value;
+		SF063_put(data, pos, sat->SF063_Ionosphere_residual_field_size);
+		for (i = 0; i < area->SF039_Number_grid_points_present; i++) {
+			value = i < HPAC_GRID_PTS && sat->residual_offset + i < ionosphere->residual_num ? ionosphere->residual[sat->residual_offset + i] * 0.04 : 0.0;
+			switch (sat->SF063_Ionosphere_residual_field_size) {
+			case 0: SF064_put(data, pos, value); break;
+			case 1: SF065_put(data, pos, value); break;
+			case 2: SF066_put(data, pos, value); break;
+			case 3: SF067_put(data, pos, value); break;
+			}
+		}
+	}
+}
+
+// SM 1-0/1-1  HPAC messages, returns payload bytes (0: too long)
+int encode_HPAC_message(uint32_t Subtype, const HPAC_header_t* header, const HPAC_atmosphere_t* atmosphere, int n, uint8_t* payload) {
+	uint8_t data[ENCODE_BUFF_LEN] = { 0 };
+	uint8_t prn[SAT_MAX];
+	uint32_t pos = 0;
+	int i, j;
+	const spartn_gnss_t* gnss = spartn_gnss(Subtype);
+	if (!gnss || n < 1 || n > 32) return 0;
+	//Table 6.10 Header block
+	SF005_put(data, &pos, header->SF005_SIOU);
+	SF069_put(data, &pos, header->SF069_Reserved);
+	SF068_put(data, &pos, header->SF068_AIOU);
+	SF030_put(data, &pos, n);
+	//Table 6.11 Atmosphere block (Repeated)
+	for (i = 0; i < n; i++) {
+		const HPAC_area_t* area = &atmosphere[i].area;
+		const HPAC_ionosphere_t* ionosphere = &atmosphere[i].ionosphere;
+		//Table 6.12 Area data block
+		SF031_put(data, &pos, area->SF031_Area_ID);
+		SF039_put(data, &pos, area->SF039_Number_grid_points_present);
+		SF040_put(data, &pos, area->SF040_Tropo);
+		SF040_put(data, &pos, area->SF040_Iono);
+		encode_troposphere_block(data, &pos, area, &atmosphere[i].troposphere);
+		//Table 6.16 Ionosphere block
+		if (area->SF040_Iono == 1 || area->SF040_Iono == 2) {
+			SF054_put(data, &pos, ionosphere->SF054_Ionosphere_equation_type);
+			for (j = 0; j < ionosphere->ionosphere_satellite_num; j++) prn[j] = ionosphere->ionosphere_satellite[j].PRN_ID;
+			encode_satellite_mask(data, &pos, gnss, prn, ionosphere->ionosphere_satellite_num);
+			for (j = 0; j < ionosphere->ionosphere_satellite_num; j++) {
+				encode_ionosphere_satellite_block(data, &pos, area, ionosphere, &ionosphere->ionosphere_satellite[j]);
+			}
+		}
+		if (pos > SPARTN_MAX_LEN * 8) return 0;
+	}
+	return payload_bytes(data, pos, payload);
+}
+
+// SM 2-0 GAD messages, returns payload bytes (0: too long)
+int encode_GAD_message(const GAD_header_t* header, const GAD_area_t* area, int n, uint8_t* payload) {
+	uint8_t data[ENCODE_BUFF_LEN] = { 0 };
+	uint32_t pos = 0;
+	int i;
+	if (n < 1 || n > 32) return 0;
+	//Table 6.20 Header block
+	SF005_put(data, &pos, header->SF005_SIOU);
+	SF069_put(data, &pos, header->SF069_Reserved);
+	SF068_put(data, &pos, header->SF068_AIOU);
+	SF030_put(data, &pos, n);
+	//Table 6.21 Area definition block (Repeated)
+	for (i = 0; i < n; i++) {
+		SF031_put(data, &pos, area[i].SF031_Area_ID);
+		SF032_put(data, &pos, area[i].SF032_Area_reference_latitude);
+		SF033_put(data, &pos, area[i].SF033_Area_reference_longitude);
+		SF034_put(data, &pos, area[i].SF034_Area_latitude_grid_node_count);
+		SF035_put(data, &pos, area[i].SF035_Area_longitude_grid_node_count);
+		SF036_put(data, &pos, area[i].SF036_Area_latitude_grid_node_spacing);
+		SF037_put(data, &pos, area[i].SF037_Area_longitude_grid_node_spacing);
+	}
+	return payload_bytes(data, pos, payload);
+}
+
+// SM 3-0 LPAC messages, returns payload bytes (0: too long)
+int encode_LPAC_message(const LPAC_header_t* header, const LPAC_area_t* area, int n, uint8_t* payload) {
+	uint8_t data[ENCODE_BUFF_LEN] = { 0 };
+	uint32_t pos = 0;
+	uint32_t mask_len, j;
+	int i;
+	if (n < 1 || n > 4) return 0;
+	//Table 6.23 Header block
+	SF005_put(data, &pos, header->SF005_SIOU);
+	SF069_put(data, &pos, header->SF069_Reserved);
+	SF070_put(data, &pos, header->SF070_Ionosphere_shell_height);
+	SF071_put(data, &pos, n);
+	//Table 6.24 LPAC area block (Repeated)
+	for (i = 0; i < n; i++) {
+		SF072_put(data, &pos, area[i].SF072_LPAC_area_ID);
+		SF073_put(data, &pos, area[i].SF073_LPAC_area_reference_latitude);
+		SF074_put(data, &pos, area[i].SF074_LPAC_area_reference_longitude);
+		SF075_put(data, &pos, area[i].SF075_LPAC_area_latitude_grid_node_count);
+		SF076_put(data, &pos, area[i].SF076_LPAC_area_longitude_grid_node_count);
+		SF077_put(data, &pos, area[i].SF077_LPAC_area_latitude_grid_node_spacing);
+		SF078_put(data, &pos, area[i].SF078_LPAC_area_longitude_grid_node_spacing);
+		SF080_put(data, &pos, area[i].SF080_Average_area_VTEC);
+		mask_len = area[i].SF075_LPAC_area_latitude_grid_node_count * area[i].SF076_LPAC_area_longitude_grid_node_count;
+		for (j = 0; j < mask_len; j++) {
+			putbitu(data, pos, 1, area[i].SF079_Grid_node_present_mask[j]); pos += 1;
+		}
+		//Table 6.25 LPAC grid node VTEC block
+		for (j = 0; j < mask_len && j < VTEC_NUM; j++) {
+			if (!area[i].SF079_Grid_node_present_mask[j]) continue;
+			SF055_put(data, &pos, area[i].VTEC[j].SF055_VTEC_quality);
+			SF081_put(data, &pos, area[i].VTEC[j].SSF081_VTEC_size_indicator);
+			if (area[i].VTEC[j].SSF081_VTEC_size_indicator) {
+				SF083_put(data, &pos, area[i].VTEC[j].SF083_VTEC_residual);
+			}
+			else {
+				SF082_put(data, &pos, area[i].VTEC[j].SF082_VTEC_residual);
+			}
+		}
+	}
+	return payload_bytes(data, pos, payload);
+}
+
+// frame a payload: 32-bit time tag, no encryption, CRC-24, returns frame bytes
+int encode_spartn_frame(uint32_t type, uint32_t Subtype, uint32_t time, const uint8_t* payload, uint32_t len, uint8_t* buff) {
+	uint8_t Frame_CRC_Buffer[3] = { 0 };
+	uint32_t Payload_offset = 10, crc;
+	if (len == 0 || len > SPARTN_MAX_LEN) return 0;
+	memset(buff, 0, Payload_offset);
+	buff[0] = SPARTN_PREAMB;
+	putbitu(buff, 8, 7, type);
+	putbitu(buff, 15, 10, len);
+	putbitu(buff, 25, 1, 0);			//EAF
+	putbitu(buff, 26, 2, 2);			//CRC_type: 24 bits
+	bitscopy(Frame_CRC_Buffer, 0, buff + 1, 0, 20);
+	putbitu(buff, 28, 4, crc4_itu(Frame_CRC_Buffer, 3));
+	putbitu(buff, 32, 4, Subtype);
+	putbitu(buff, 36, 1, 1);			//Time_tag_type: 32 bits
+	putbitu(buff, 37, 32, time);
+	putbitu(buff, 69, 7, 0);			//Solution_ID
+	putbitu(buff, 76, 4, 0);			//Solution_processor_ID
+	memcpy(buff + Payload_offset, payload, len);
+	crc = crc24_radix(buff + 1, Payload_offset - 1 + len);
+	putbitu(buff, (Payload_offset + len) * 8, 24, crc);
+	return Payload_offset + len + 3;
+}
@@ -0,0 +1,298 @@
+/*------------------------------------------------------------------------------
+* spartn_index.c : frame index of SPARTN capture files
+*
+* the capture is read by blocks and framed as input_spartn_data() does (same
+* header fields and lengths, frame crc4 and message crc24), without decoding
+* the payloads. a frame failing the message crc is kept with crc = 0 as the
+* decoder consumes it as well, a failing frame crc resyncs on the next byte.
+*
+* <file>.sidx : "SPIX", version, entry size, number of frames, bytes scanned
+*               sidx_entry_t per frame
+*-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crc.h"
+#include "bits.h"
+#include "spartn_index.h"
+
+#ifdef _WIN32
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#endif
+
+#define SIDX_VER        1
+#define SIDX_BUFF       65536           /* read block (bytes) */
+#define SIDX_FRAME      1200            /* max frame length (bytes), as raw_spartn_t buff */
+#define SIDX_DAY        DAY_SECONDS
+#define GLO_GPS_TD      10800
+#define Leap_Sec        18
+#define BDS_GPS_TD      14
+
+static const int eadl_len[8] = { 8, 12, 16, 32, 64, 0, 0, 0 }; /* by EAL */
+
+/* frame at buff (0: incomplete, -1: not a frame, >0: frame length) ----------*/
+static int scan_frame(const uint8_t *buff, int n, sidx_entry_t *e)
+{
+	uint8_t frame_crc[3] = { 0 };
+	int len, eaf, crc_len, ttag_len, ea_len = 0, eadl = 0, size;
+
+	if (n < 5) return 0;
+	bitscopy(frame_crc, 0, buff + 1, 0, 20);
+	if (getbitu(buff, 28, 4) != crc4_itu(frame_crc, 3)) return -1;
+
+	e->type = (uint8_t)getbitu(buff, 8, 7);
+	len = getbitu(buff, 15, 10);
+	eaf = getbitu(buff, 25, 1);
+	crc_len = getbitu(buff, 26, 2) + 1;
+	e->subtype = (uint8_t)getbitu(buff, 32, 4);
+	e->ttag = (uint8_t)getbitu(buff, 36, 1);
+	ttag_len = e->ttag ? 4 : 2;
+
+	if (n < 6 + ttag_len) return 0;
+	e->tag = getbitu(buff, 37, ttag_len * 8);
+	if (eaf) {
+		ea_len = 2;
+		if (n < 6 + ea_len + ttag_len) return 0;
+		/* AI and EAL bits as read by input_spartn_data */
+		if (getbitu(buff, 55 + ttag_len * 8, 3) > 1) eadl = eadl_len[getbitu(buff, 58 + ttag_len * 8, 3)];
+	}
+	size = 6 + ea_len + ttag_len + len + eadl + crc_len;
+	if (n < size) return 0;
+
+	e->len = (uint16_t)size;
+	e->crc = getbitu(buff, (size - crc_len) * 8, crc_len * 8) == crc24_radix((uint8_t *)buff + 1, size - 1 - crc_len);
+	e->eos = (!eaf && e->type == 0 && len > 0) ? (uint8_t)getbitu(buff + 6 + ttag_len, 9, 1) : 0; /* SF010 after SF005 */
+	e->reserved = 0;
+	return size;
+}
+/* add frame, time of day in gpst made increasing over the frames so far ----*/
+static int add_entry(spartn_index_t *idx, sidx_entry_t *e)
+{
+	sidx_entry_t *p;
+	uint32_t prev, day, t;
+
+	if (idx->n >= idx->nmax) {
+		idx->nmax = idx->nmax <= 0 ? 4096 : idx->nmax * 2;
+		if (!(p = (sidx_entry_t *)realloc(idx->entry, sizeof(sidx_entry_t)*idx->nmax))) return 0;
+		idx->entry = p;
+	}
+	t = e->ttag ? e->tag % SIDX_DAY : e->tag;
+	if (e->type < 2 && e->subtype == SPARTN_GLO) t = (t + SIDX_DAY - GLO_GPS_TD + Leap_Sec) % SIDX_DAY;
+	else if (e->type < 2 && e->subtype == SPARTN_BDS) t = (t + BDS_GPS_TD) % SIDX_DAY;
+	if (idx->n > 0) {
+		prev = idx->entry[idx->n - 1].time;
+		day = prev - prev % SIDX_DAY;
+		if (!e->crc) t = prev;
+		else {
+			t += day;
+			if (t + SIDX_DAY / 2 < prev) t += SIDX_DAY;
+			if (t < prev) t = prev;
+		}
+	}
+	e->time = t;
+	idx->entry[idx->n++] = *e;
+	return 1;
+}
+/* scan capture file -----------------------------------------------------------
+* args   : char   *file      I   capture file
+*          spartn_index_t *idx IO index, extended from idx->scanned
+* return : number of frames (-1: error)
+* notes  : an incomplete frame at the end of the file is left for the next
+*          scan, idx->scanned points to its preamble.
+*-----------------------------------------------------------------------------*/
+extern int spartn_index_scan(const char *file, spartn_index_t *idx)
+{
+	sidx_entry_t e;
+	uint8_t *buff;
+	uint64_t base;
+	int n = 0, p = 0, r, eof = 0;
+	size_t nr;
+	FILE *fp;
+
+	if (!(fp = fopen(file, "rb"))) return -1;
+	if (!(buff = (uint8_t *)malloc(SIDX_BUFF + SIDX_FRAME))) {
+		fclose(fp);
+		return -1;
+	}
+	base = idx->scanned;
+	if (fseek64(fp, (long long)base, SEEK_SET)) eof = 1;
+
+	while (1) {
+		if (n - p < SIDX_FRAME && !eof) {
+			memmove(buff, buff + p, n - p);
+			base += p;
+			n -= p;
+			p = 0;
+			nr = fread(buff + n, 1, SIDX_BUFF, fp);
+			n += (int)nr;
+			if (nr < SIDX_BUFF) eof = 1;
+		}
+		if (p >= n) break;
+		if (buff[p] != SPARTN_PREAMB) {
+			p++;
+			continue;
+		}
+		memset(&e, 0, sizeof(e));
+		if ((r = scan_frame(buff + p, n - p, &e)) == 0) break; /* incomplete at eof */
+		if (r < 0) {
+			p++;
+			continue;
+		}
+		e.off = base + p;
+		if (!add_entry(idx, &e)) {
+			free(buff);
+			fclose(fp);
+			return -1;
+		}
+		p += r;
+	}
+	idx->scanned = base + p;
+	free(buff);
+	fclose(fp);
+	return idx->n;
+}
+/* save/load index -----------------------------------------------------------*/
+extern int spartn_index_save(const char *path, const spartn_index_t *idx)
+{
+	uint32_t ver = SIDX_VER, size = sizeof(sidx_entry_t), n = (uint32_t)idx->n;
+	FILE *fp;
+	int ok;
+
+	if (!(fp = fopen(path, "wb"))) return 0;
+	ok = fwrite("SPIX", 4, 1, fp) == 1 && fwrite(&ver, 4, 1, fp) == 1 && fwrite(&size, 4, 1, fp) == 1 &&
+		fwrite(&n, 4, 1, fp) == 1 && fwrite(&idx->scanned, 8, 1, fp) == 1 &&
+		(n == 0 || fwrite(idx->entry, sizeof(sidx_entry_t), n, fp) == n);
+	fclose(fp);
+	return ok;
+}
+extern int spartn_index_load(const char *path, spartn_index_t *idx)
+{
+	char magic[4];
+	uint32_t ver, size, n;
+	uint64_t scanned;
+	FILE *fp;
+
+	memset(idx, 0, sizeof(spartn_index_t));
+	if (!(fp = fopen(path, "rb"))) return 0;
+	if (fread(magic, 4, 1, fp) < 1 || fread(&ver, 4, 1, fp) < 1 || fread(&size, 4, 1, fp) < 1 ||
+		fread(&n, 4, 1, fp) < 1 || fread(&scanned, 8, 1, fp) < 1 || memcmp(magic, "SPIX", 4) ||
+		ver != SIDX_VER || size != sizeof(sidx_entry_t) || n > 0x7FFFFFFF ||
+		(n > 0 && !(idx->entry = (sidx_entry_t *)malloc(sizeof(sidx_entry_t)*n))) ||
+		fread(idx->entry, sizeof(sidx_entry_t), n, fp) < n) {
+		fclose(fp);
+		spartn_index_free(idx);
+		return 0;
+	}
+	fclose(fp);
+	idx->n = idx->nmax = (int)n;
+	idx->scanned = scanned;
+	return 1;
+}
+/* index of a capture file -----------------------------------------------------
+* args   : char   *file      I   capture file
+*          spartn_index_t *idx O index (free with spartn_index_free())
+* return : number of frames (-1: error)
+* notes  : <file>.sidx is used when it does not cover more than the capture,
+*          the frames appended to the capture since are scanned and the
+*          sidecar is rewritten.
+*-----------------------------------------------------------------------------*/
+extern int spartn_index_open(const char *file, spartn_index_t *idx)
+{
+	char path[1024];
+	uint64_t scanned;
+	long long size;
+	FILE *fp;
+
+	memset(idx, 0, sizeof(spartn_index_t));
+	if (strlen(file) + 6 > sizeof(path) || !(fp = fopen(file, "rb"))) return -1;
+	fseek64(fp, 0, SEEK_END);
+	size = ftell64(fp);
+	fclose(fp);
+	sprintf(path, "%s.sidx", file);
+
+	if (spartn_index_load(path, idx) && (long long)idx->scanned > size) spartn_index_free(idx);
+	if ((long long)idx->scanned == size) return idx->n;
+
+	scanned = idx->scanned;
+	if (spartn_index_scan(file, idx) < 0) {
+		spartn_index_free(idx);
+		return -1;
+	}
+	if (idx->scanned != scanned) spartn_index_save(path, idx);
+	return idx->n;
+}
+extern void spartn_index_free(spartn_index_t *idx)
+{
+	free(idx->entry);
+	memset(idx, 0, sizeof(spartn_index_t));
+}
+/* index time of a time of day, on the day of the first frame or after -------*/
+static double index_time(const spartn_index_t *idx, double tod)
+{
+	double t = tod;
+	if (idx->n > 0) while (t + SIDX_DAY / 2 < (double)idx->entry[0].time) t += SIDX_DAY;
+	return t;
+}
+/* first frame at or after index time ----------------------------------------*/
+static int lower_bound(const spartn_index_t *idx, double t)
+{
+	int lo = 0, hi = idx->n, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if ((double)idx->entry[mid].time < t) lo = mid + 1; else hi = mid;
+	}
+	return lo;
+}
+/* first frame of a message type at or after time ------------------------------
+* args   : spartn_index_t *idx I index
+*          double  tod       I   time of day (s)
+*          int     type      I   message type (-1: any)
+* return : frame index (-1: none)
+*-----------------------------------------------------------------------------*/
+extern int spartn_index_find(const spartn_index_t *idx, double tod, int type)
+{
+	int i;
+
+	for (i = lower_bound(idx, index_time(idx, tod)); i < idx->n; i++) {
+		if (idx->entry[i].crc && (type < 0 || idx->entry[i].type == type)) return i;
+	}
+	return -1;
+}
+/* frame to start decoding to have the state at time -----------------------------
+* args   : spartn_index_t *idx I index
+*          double  tod       I   time of day (s)
+*          double  maxage    I   max age of the messages taken (s)
+* return : frame index (-1: none)
+* notes  : the start is the first frame of the last epoch of each message
+*          type and subtype (OCB, HPAC, GAD, LPAC) sent within maxage before
+*          time, so all areas and satellite sets of that epoch are decoded.
+*-----------------------------------------------------------------------------*/
+extern int spartn_index_warm(const spartn_index_t *idx, double tod, double maxage)
+{
+	const sidx_entry_t *e;
+	uint32_t tp[4][16] = { { 0 } };
+	uint8_t got[4][16] = { { 0 } };
+	double t;
+	int i, last, start;
+
+	if (idx->n <= 0) return -1;
+	t = index_time(idx, tod);
+	last = start = lower_bound(idx, t);
+
+	for (i = last - 1; i >= 0; i--) {
+		e = idx->entry + i;
+		if ((double)e->time + maxage < t) break;
+		if (!e->crc || e->type >= 4) continue;
+		if (!got[e->type][e->subtype]) {
+			got[e->type][e->subtype] = 1;
+			tp[e->type][e->subtype] = e->time;
+		}
+		if (e->time == tp[e->type][e->subtype]) start = i;
+	}
+	return start < idx->n ? start : -1;
+}
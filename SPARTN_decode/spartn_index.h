@@ -0,0 +1,49 @@
+#ifndef SPARTN_INDEX_H
+#define SPARTN_INDEX_H
+
+#include <stdint.h>
+#include "spartn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* frame index of a SPARTN capture file ---------------------------------------
+* one sequential pass frames the capture without decoding the payloads and
+* records each frame passing the frame crc. the index is kept next to the
+* capture as <file>.sidx and extended when the capture has grown.
+*-----------------------------------------------------------------------------*/
+#define SIDX_WARM_AGE   300.0           /* max age of the state warmed up by a seek (s) */
+
+typedef struct {                        /* frame of the capture */
+	uint64_t off;                       /* file offset of the preamble */
+	uint32_t time;                      /* time of day (s, gpst) from 0h of the first frame, increasing */
+	uint32_t tag;                       /* time tag as sent */
+	uint16_t len;                       /* frame length (bytes) */
+	uint8_t  type;                      /* message type */
+	uint8_t  subtype;                   /* message subtype */
+	uint8_t  crc;                       /* message crc, 1: ok, 0: failed (time of the previous frame) */
+	uint8_t  ttag;                      /* time tag type, 0: 16 bit, 1: 32 bit */
+	uint8_t  eos;                       /* OCB end of set, unencrypted OCB only */
+	uint8_t  reserved;
+} sidx_entry_t;
+
+typedef struct {                        /* frame index */
+	int n, nmax;                        /* number of frames */
+	sidx_entry_t *entry;                /* frames in file order */
+	uint64_t scanned;                   /* capture bytes scanned */
+} spartn_index_t;
+
+int spartn_index_scan(const char *file, spartn_index_t *idx);
+int spartn_index_save(const char *path, const spartn_index_t *idx);
+int spartn_index_load(const char *path, spartn_index_t *idx);
+int spartn_index_open(const char *file, spartn_index_t *idx);
+void spartn_index_free(spartn_index_t *idx);
+
+int spartn_index_find(const spartn_index_t *idx, double tod, int type);
+int spartn_index_warm(const spartn_index_t *idx, double tod, double maxage);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,125 @@
+#ifndef SPARTN_SCHEMA_H
+#define SPARTN_SCHEMA_H
+
+#include <stdint.h>
+#include <math.h>
+#include "bits.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//=============================
+// SPARTN field schema
+//=============================
+// U(id, bits, offset)         integer field, value = raw + offset
+// D(id, bits, scale, offset)  scaled field,  value = raw * scale + offset
+// Presence of each field is decided by the block flags noted on the right.
+// Only the field layout comes from this table: widths, scaling and the
+// SFxxx_get/put accessors used by the decoders and the encoder. The order of
+// the fields in a block, the presence conditions (noted as comments) and the
+// table loggers are still written by hand in spartn_OCB/HPAC/GAD/LPAC.c and
+// spartn_encode.c, and must be kept in step with the table.
+#define SPARTN_SCHEMA(U, D) \
+	/* header blocks */ \
+	U(SF005,  9, 0)							/* SIOU */ \
+	U(SF008,  1, 0)							/* yaw present flag */ \
+	U(SF009,  1, 0)							/* satellite reference datum */ \
+	U(SF010,  1, 0)							/* end of OCB set */ \
+	U(SF016,  2, 0)							/* ephemeris type */ \
+	U(SF030,  5, 1)							/* area count */ \
+	U(SF068,  4, 0)							/* AIOU */ \
+	U(SF069,  1, 0)							/* reserved */ \
+	/* OCB satellite block, Table 6.4-6.9 */ \
+	U(SF013,  1, 0)							/* do not use */ \
+	U(SF014,  1, 0)							/* orbit/clock/bias block present */ \
+	U(SF015,  3, 0)							/* continuity indicator */ \
+	D(SF020, 14, 0.002, -16.382)			/* orbit/clock/phase bias, SF014 */ \
+	U(SF021,  6, 0)							/* satellite yaw, SF008 == 1 */ \
+	U(SF022,  3, 0)							/* IODE continuity */ \
+	U(SF023,  1, 0)							/* fix flag */ \
+	U(SF024,  3, 0)							/* user range error */ \
+	D(SF029, 11, 0.02, -20.46)				/* code bias */ \
+	/* HPAC area and troposphere block, Table 6.12-6.15 */ \
+	U(SF031,  8, 0)							/* area ID */ \
+	U(SF039,  7, 0)							/* number of grid points present */ \
+	U(SF040,  2, 0)							/* tropo/iono block indicator */ \
+	U(SF041,  3, 0)							/* troposphere equation type */ \
+	U(SF042,  3, 0)							/* troposphere quality */ \
+	D(SF043,  8, 0.004, -0.508 + 2.30)		/* area average hydrostatic delay */ \
+	U(SF044,  1, 0)							/* troposphere coefficient size */ \
+	D(SF045,  7, 0.004, -0.252 + 0.252)		/* T00 small, SF044 == 0 */ \
+	D(SF046,  7, 0.001, -0.063)				/* T01/T10 small, SF041 >= 1 */ \
+	D(SF047,  9, 0.0002, -0.0510)			/* T11 small, SF041 == 2 */ \
+	D(SF048,  9, 0.004, -1.020 + 0.252)		/* T00 large, SF044 == 1 */ \
+	D(SF049,  9, 0.001, -0.255)				/* T01/T10 large, SF041 >= 1 */ \
+	D(SF050, 11, 0.0002, -0.2046)			/* T11 large, SF041 == 2 */ \
+	U(SF051,  1, 0)							/* troposphere residual size, SF040 == 2 */ \
+	D(SF052,  6, 0.004, -0.124)				/* troposphere residual small, SF051 == 0 */ \
+	D(SF053,  8, 0.004, -0.508)				/* troposphere residual large, SF051 == 1 */ \
+	/* HPAC ionosphere block, Table 6.16-6.19 */ \
+	U(SF054,  3, 0)							/* ionosphere equation type */ \
+	U(SF055,  4, 0)							/* ionosphere/VTEC quality */ \
+	U(SF056,  1, 0)							/* ionosphere coefficient size */ \
+	D(SF057, 12, 0.04, -81.88)				/* C00 small, SF056 == 0 */ \
+	D(SF058, 12, 0.008, -16.376)			/* C01/C10 small, SF054 >= 1 */ \
+	D(SF059, 13, 0.002, -8.190)				/* C11 small, SF054 == 2 */ \
+	D(SF060, 14, 0.04, -327.64)				/* C00 large, SF056 == 1 */ \
+	D(SF061, 14, 0.008, -65.528)			/* C01/C10 large, SF054 >= 1 */ \
+	D(SF062, 15, 0.002, -32.766)			/* C11 large, SF054 == 2 */ \
+	U(SF063,  2, 0)							/* ionosphere residual size, SF040 == 2 */ \
+	D(SF064,  4, 0.04, -0.28)				/* ionosphere residual, SF063 == 0 */ \
+	D(SF065,  7, 0.04, -2.52)				/* ionosphere residual, SF063 == 1 */ \
+	D(SF066, 10, 0.04, -20.44)				/* ionosphere residual, SF063 == 2 */ \
+	D(SF067, 14, 0.04, -327.64)				/* ionosphere residual, SF063 == 3 */ \
+	/* GAD area definition block */ \
+	D(SF032, 11, 0.1, -90.0)				/* area reference latitude */ \
+	D(SF033, 12, 0.1, -180.0)				/* area reference longitude */ \
+	U(SF034,  3, 0)							/* latitude grid node count */ \
+	U(SF035,  3, 0)							/* longitude grid node count */ \
+	D(SF036,  5, 0.1, 0.1)					/* latitude grid node spacing */ \
+	D(SF037,  5, 0.1, 0.1)					/* longitude grid node spacing */ \
+	/* LPAC blocks */ \
+	U(SF070,  2, 0)							/* ionosphere shell height */ \
+	U(SF071,  2, 1)							/* LPAC area count */ \
+	U(SF072,  2, 0)							/* LPAC area ID */ \
+	U(SF073,  8, -85)						/* LPAC area reference latitude */ \
+	U(SF074,  9, -180)						/* LPAC area reference longitude */ \
+	U(SF075,  4, 1)							/* LPAC latitude grid node count */ \
+	U(SF076,  4, 1)							/* LPAC longitude grid node count */ \
+	U(SF077,  2, 0)							/* LPAC latitude grid node spacing */ \
+	U(SF078,  2, 0)							/* LPAC longitude grid node spacing */ \
+	D(SF080, 12, 0.25, -511.75)				/* average area VTEC */ \
+	U(SF081,  1, 0)							/* VTEC size indicator */ \
+	D(SF082,  7, 0.25, -15.75)				/* VTEC residual, SF081 == 0 */ \
+	D(SF083, 11, 0.25, -255.75)				/* VTEC residual, SF081 == 1 */
+
+// field widths: SF020_LEN, ...
+#define SPARTN_U_LEN(id, bits, off) id##_LEN = bits,
+#define SPARTN_D_LEN(id, bits, scale, off) id##_LEN = bits,
+enum { SPARTN_SCHEMA(SPARTN_U_LEN, SPARTN_D_LEN) SPARTN_FIELD_END };
+
+// decoder/encoder: SF020_get(buff, &pos), SF020_put(buff, &pos, value)
+// values out of range are clamped to the field
+#define SPARTN_U_ACCESS(id, bits, off) \
+	static __inline int32_t id##_get(const uint8_t* buff, uint32_t* pos) { \
+		int32_t value = (int32_t)getbitu(buff, (int)*pos, bits) + (off); *pos += bits; return value; } \
+	static __inline void id##_put(uint8_t* buff, uint32_t* pos, int32_t value) { \
+		int32_t raw = value - (off); \
+		if (raw < 0) raw = 0; else if (raw > (int32_t)((1u << bits) - 1)) raw = (int32_t)((1u << bits) - 1); \
+		putbitu(buff, (int)*pos, bits, (uint32_t)raw); *pos += bits; }
+#define SPARTN_D_ACCESS(id, bits, scale, off) \
+	static __inline double id##_get(const uint8_t* buff, uint32_t* pos) { \
+		double value = getbitu(buff, (int)*pos, bits) * (scale) + (off); *pos += bits; return value; } \
+	static __inline void id##_put(uint8_t* buff, uint32_t* pos, double value) { \
+		double raw = floor((value - (off)) / (scale) + 0.5); \
+		if (raw < 0.0) raw = 0.0; else if (raw > (double)((1u << bits) - 1)) raw = (double)((1u << bits) - 1); \
+		putbitu(buff, (int)*pos, bits, (uint32_t)raw); *pos += bits; }
+SPARTN_SCHEMA(SPARTN_U_ACCESS, SPARTN_D_ACCESS)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // !SPARTN_SCHEMA_H
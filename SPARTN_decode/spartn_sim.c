@@ -0,0 +1,252 @@
+/*------------------------------------------------------------------------------
+* spartn_sim.c : synthetic SPARTN stream generator
+*
+* generates OCB/HPAC/GAD/LPAC frames with random but plausible corrections
+* for nsat satellites per system and narea areas. the values depend only on
+* seed and time, so a stream can be regenerated for round-trip comparison.
+* with sim->nav set, satellites and IODE are taken from the ephemeris so the
+* corrections are accepted by the VRS generation.
+*-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "spartn_sim.h"
+
+#define SIM_HPAC_AREAS  4           /* areas per HPAC message */
+#define SIM_GRID_NODES  3           /* GAD grid node count (lat and lon) */
+#define SIM_GRID_STEP   0.5         /* GAD grid node spacing (deg) */
+#define SIM_AREA_COLS   4           /* areas per row of the area grid */
+#define GLO_GPS_TD      10800       /* GLONASS-GPS time of day offset (s) */
+#define LEAP_SEC        18
+
+/* uniform random in [-1,1) -------------------------------------------------*/
+static double sim_rand(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (double)(*state >> 8) / 8388608.0 - 1.0;
+}
+
+/* satellites of a subtype, returns number of satellites --------------------*/
+static int sim_sat_list(const spartn_sim_t *sim, int Subtype, uint8_t *prn, int *iode, uint32_t *state)
+{
+    const spartn_gnss_t *gnss = spartn_gnss(Subtype);
+    int i, j, n = 0, sys, p;
+    int nmax = sim->nsat;
+
+    /* every satellite is in the OCB and in each HPAC area: at most one
+       satellite mask and the satellites of an HPAC area */
+    if (nmax > gnss->mask_len[3]) nmax = gnss->mask_len[3];
+    if (nmax > SAT_MAX) nmax = SAT_MAX;
+
+    if (sim->nav) {
+        if (Subtype == SPARTN_GPS) {
+            for (i = 0; i < (int)sim->nav->n && n < nmax; i++) {
+                sys = satsys(sim->nav->eph[i].sat, &p);
+                if (sys != _SYS_GPS_ || p < 1 || p > 64) continue;
+                for (j = 0; j < n; j++) if (prn[j] == p) break;
+                if (j < n) continue;
+                prn[n] = (uint8_t)p;
+                iode[n++] = sim->nav->eph[i].iode;
+            }
+        }
+        else {
+            for (i = 0; i < (int)sim->nav->ng && n < nmax; i++) {
+                sys = satsys(sim->nav->geph[i].sat, &p);
+                if (sys != _SYS_GLO_ || p < 1 || p > 63) continue;
+                for (j = 0; j < n; j++) if (prn[j] == p) break;
+                if (j < n) continue;
+                prn[n] = (uint8_t)p;
+                iode[n++] = sim->nav->geph[i].iode;
+            }
+        }
+        /* mask order */
+        for (i = 0; i < n; i++) for (j = i + 1; j < n; j++) {
+            if (prn[j] < prn[i]) {
+                uint8_t tp = prn[i]; prn[i] = prn[j]; prn[j] = tp;
+                p = iode[i]; iode[i] = iode[j]; iode[j] = p;
+            }
+        }
+        return n;
+    }
+    for (n = 0; n < nmax; n++) {
+        prn[n] = (uint8_t)(n + 1);
+        iode[n] = 1 + (int)((sim_rand(state) + 1.0) * (Subtype == SPARTN_GPS ? 127.0 : 63.0));
+    }
+    return n;
+}
+
+static void sim_ocb_sat(const spartn_gnss_t *gnss, OCB_Satellite_t *sat, uint8_t prn, int iode, uint32_t *state)
+{
+    int j;
+    memset(sat, 0, sizeof(OCB_Satellite_t));
+    sat->PRN_ID = prn;
+    sat->SF014_Orbit_block_0 = 1;
+    sat->SF014_Clock_block_1 = 1;
+    sat->SF014_Bias_block_2 = 1;
+    sat->orbit.SF018_SF019_IODE = iode;
+    sat->orbit.SF020_radial = 0.5 * sim_rand(state);
+    sat->orbit.SF020_along = 1.0 * sim_rand(state);
+    sat->orbit.SF020_cross = 1.0 * sim_rand(state);
+    sat->clock.SF020_Clock_correction = 2.0 * sim_rand(state);
+    sat->clock.SF024_User_range_error = 3;
+    for (j = 0; j < gnss->phase_bias_len; j++) {
+        sat->GPS_bias.SF025_phase_bias[j] = 1;
+        sat->GPS_bias.Phase_bias[j].SF023_Fix_flag = 1;
+        sat->GPS_bias.Phase_bias[j].SF020_Phase_bias_correction = 1.0 * sim_rand(state);
+    }
+    for (j = 0; j < gnss->code_bias_len; j++) {
+        sat->GPS_bias.SF027_code_bias[j] = 1;
+        sat->GPS_bias.SF029_Code_bias_correction[j] = 2.0 * sim_rand(state);
+    }
+}
+
+static void sim_gad_area(const spartn_sim_t *sim, int i, GAD_area_t *area)
+{
+    memset(area, 0, sizeof(GAD_area_t));
+    area->SF031_Area_ID = (uint8_t)(i + 1);
+    area->SF032_Area_reference_latitude = sim->lat + (i / SIM_AREA_COLS + 1) * SIM_GRID_NODES * SIM_GRID_STEP;
+    area->SF033_Area_reference_longitude = sim->lon + (i % SIM_AREA_COLS) * SIM_GRID_NODES * SIM_GRID_STEP;
+    area->SF034_Area_latitude_grid_node_count = SIM_GRID_NODES;
+    area->SF035_Area_longitude_grid_node_count = SIM_GRID_NODES;
+    area->SF036_Area_latitude_grid_node_spacing = SIM_GRID_STEP;
+    area->SF037_Area_longitude_grid_node_spacing = SIM_GRID_STEP;
+}
+
+static void sim_hpac_area(int i, const uint8_t *prn, int nsat, HPAC_atmosphere_t *atm, uint32_t *state)
+{
+    int j;
+    memset(atm, 0, sizeof(HPAC_atmosphere_t));
+    atm->area.SF031_Area_ID = (uint8_t)(i + 1);
+    atm->area.SF039_Number_grid_points_present = SIM_GRID_NODES * SIM_GRID_NODES;
+    atm->area.SF040_Tropo = 1;
+    atm->area.SF040_Iono = 1;
+    atm->troposphere.SF041_Troposphere_equation_type = 1;
+    atm->troposphere.SF042_Troposphere_quality = 1;
+    atm->troposphere.SF043_Area_average_vertical_hydrostatic_delay = 2.3 + 0.1 * sim_rand(state);
+    atm->troposphere.small_coefficient.SF045_T00 = 0.1 + 0.1 * sim_rand(state);
+    atm->troposphere.small_coefficient.SF046_T01 = 0.01 * sim_rand(state);
+    atm->troposphere.small_coefficient.SF046_T10 = 0.01 * sim_rand(state);
+    atm->ionosphere.SF054_Ionosphere_equation_type = 1;
+    for (j = 0; j < nsat && j < SAT_MAX; j++) {
+        HPAC_ionosphere_satellite_t *sat = &atm->ionosphere.ionosphere_satellite[j];
+        sat->PRN_ID = prn[j];
+        sat->SF055_Ionosphere_quality = 1;
+        sat->small_coefficient.SF057_C00 = 10.0 * sim_rand(state);
+        sat->small_coefficient.SF058_C01 = 1.0 * sim_rand(state);
+        sat->small_coefficient.SF058_C10 = 1.0 * sim_rand(state);
+    }
+    atm->ionosphere.ionosphere_satellite_num = (uint8_t)j;
+}
+
+static void sim_lpac_area(const spartn_sim_t *sim, int i, LPAC_area_t *area, uint32_t *state)
+{
+    int j;
+    memset(area, 0, sizeof(LPAC_area_t));
+    area->SF072_LPAC_area_ID = (uint8_t)i;
+    area->SF073_LPAC_area_reference_latitude = (int16_t)floor(sim->lat) + 8 * (i + 1);
+    area->SF074_LPAC_area_reference_longitude = (int16_t)floor(sim->lon);
+    area->SF075_LPAC_area_latitude_grid_node_count = 4;
+    area->SF076_LPAC_area_longitude_grid_node_count = 4;
+    area->SF077_LPAC_area_latitude_grid_node_spacing = 0;
+    area->SF078_LPAC_area_longitude_grid_node_spacing = 0;
+    area->SF080_Average_area_VTEC = 20.0 + 5.0 * sim_rand(state);
+    for (j = 0; j < 16; j++) {
+        area->SF079_Grid_node_present_mask[j] = 1;
+        area->VTEC[j].SF055_VTEC_quality = 1;
+        area->VTEC[j].SF082_VTEC_residual = 5.0 * sim_rand(state);
+    }
+}
+
+/* append one frame to buff, returns bytes appended, -1: error or no room ---*/
+static int sim_frame(uint32_t type, uint32_t Subtype, uint32_t time, const uint8_t *payload, int len, uint8_t *buff, int size)
+{
+    uint8_t frame[SPARTN_MAX_LEN + 16];
+    int n;
+    if (len <= 0) return 0;
+    if (Subtype == SPARTN_GLO && type < 2) time = (time + GLO_GPS_TD - LEAP_SEC) % DAY_SECONDS;
+    n = encode_spartn_frame(type, Subtype, time, payload, len, frame);
+    if (n <= 0 || n > size) return -1;
+    memcpy(buff, frame, n);
+    return n;
+}
+
+/* frames due at GPS time of day, -1: a message could not be encoded or the
+   frames do not fit in buff ------------------------------------------------*/
+extern int sim_spartn_epoch(const spartn_sim_t *sim, uint32_t time, uint8_t *buff, int size)
+{
+    uint8_t payload[SPARTN_MAX_LEN];
+    uint8_t prn[SSR_NUM];
+    int iode[SSR_NUM];
+    int i, j, k, n, len, nbyte = 0, Subtype;
+    uint32_t state = sim->seed ^ (time * 2654435761u);
+    OCB_Satellite_t sat[SSR_NUM];
+    HPAC_atmosphere_t atm[SIM_HPAC_AREAS];
+    GAD_area_t gad[32];
+    LPAC_area_t lpac[4];
+    int narea = sim->narea < 32 ? sim->narea : 32;
+    int nsys = sim->nsys < 2 ? 1 : 2;
+
+    if (sim->gad_rate > 0 && time % sim->gad_rate == 0 && narea > 0) {
+        GAD_header_t header = { 0 };
+        for (i = 0; i < narea; i++) sim_gad_area(sim, i, &gad[i]);
+        len = encode_GAD_message(&header, gad, narea, payload);
+        if (len <= 0) return -1;
+        if ((k = sim_frame(2, 0, time, payload, len, buff + nbyte, size - nbyte)) < 0) return -1;
+        nbyte += k;
+    }
+    for (Subtype = 0; Subtype < nsys; Subtype++) {
+        const spartn_gnss_t *gnss = spartn_gnss(Subtype);
+        n = sim_sat_list(sim, Subtype, prn, iode, &state);
+        if (n <= 0) continue;
+        if (sim->ocb_rate > 0 && time % sim->ocb_rate == 0) {
+            OCB_header_t header = { 0 };
+            header.SF010_EOS = Subtype == nsys - 1;
+            for (j = 0; j < n; j++) sim_ocb_sat(gnss, &sat[j], prn[j], iode[j], &state);
+            len = encode_OCB_message(Subtype, &header, sat, n, payload);
+            if (len <= 0) return -1;
+            if ((k = sim_frame(0, Subtype, time, payload, len, buff + nbyte, size - nbyte)) < 0) return -1;
+            nbyte += k;
+        }
+        if (sim->hpac_rate > 0 && time % sim->hpac_rate == 0) {
+            HPAC_header_t header = { 0 };
+            for (i = 0; i < narea; i += SIM_HPAC_AREAS) {
+                int m = narea - i < SIM_HPAC_AREAS ? narea - i : SIM_HPAC_AREAS;
+                for (j = 0; j < m; j++) sim_hpac_area(i + j, prn, n, &atm[j], &state);
+                len = encode_HPAC_message(Subtype, &header, atm, m, payload);
+                if (len <= 0) return -1;
+                if ((k = sim_frame(1, Subtype, time, payload, len, buff + nbyte, size - nbyte)) < 0) return -1;
+                nbyte += k;
+            }
+        }
+    }
+    if (sim->lpac_rate > 0 && time % sim->lpac_rate == 0) {
+        LPAC_header_t header = { 0 };
+        n = narea < 4 ? (narea > 0 ? narea : 1) : 4;
+        for (i = 0; i < n; i++) sim_lpac_area(sim, i, &lpac[i], &state);
+        len = encode_LPAC_message(&header, lpac, n, payload);
+        if (len <= 0) return -1;
+        if ((k = sim_frame(3, 0, time, payload, len, buff + nbyte, size - nbyte)) < 0) return -1;
+        nbyte += k;
+    }
+    return nbyte;
+}
+
+/* write a synthetic stream to file -----------------------------------------*/
+extern int sim_spartn_file(const char *file, const spartn_sim_t *sim, uint32_t time0, int nsec)
+{
+    static uint8_t buff[64 * 1024];
+    FILE *fp;
+    int i, n, nbyte = 0;
+
+    if (!(fp = fopen(file, "wb"))) return -1;
+    for (i = 0; i < nsec; i++) {
+        n = sim_spartn_epoch(sim, (time0 + i) % DAY_SECONDS, buff, sizeof(buff));
+        if (n < 0) {
+            fclose(fp);
+            return -1;
+        }
+        if (n > 0) fwrite(buff, 1, n, fp);
+        nbyte += n;
+    }
+    fclose(fp);
+    return nbyte;
+}
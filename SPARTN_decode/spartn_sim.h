@@ -0,0 +1,37 @@
+#ifndef SPARTN_SIM_H
+#define SPARTN_SIM_H
+
+#include "rtcm.h"
+#include "spartn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* synthetic SPARTN stream for load and round-trip tests */
+typedef struct {
+    int     nsat;           /* satellites per system */
+    int     nsys;           /* 1: GPS, 2: GPS+GLONASS */
+    int     narea;          /* HPAC/GAD areas */
+    int     ocb_rate;       /* OCB interval (s), 0: off */
+    int     hpac_rate;      /* HPAC interval (s), 0: off */
+    int     gad_rate;       /* GAD interval (s), 0: off */
+    int     lpac_rate;      /* LPAC interval (s), 0: off */
+    double  lat, lon;       /* south-west corner of the area grid (deg) */
+    unsigned int seed;      /* seed of the correction values */
+    const nav_t *nav;       /* take satellites and IODE from ephemeris if not NULL */
+} spartn_sim_t;
+
+/* frames due at GPS time of day, returns bytes written to buff or -1 if a
+   message could not be encoded (e.g. too long for a frame) or size is too
+   small for the frames of the epoch */
+int sim_spartn_epoch(const spartn_sim_t *sim, uint32_t time, uint8_t *buff, int size);
+
+/* write nsec seconds of stream from time0 to file, returns bytes written or -1 */
+int sim_spartn_file(const char *file, const spartn_sim_t *sim, uint32_t time0, int nsec);
+
+/*--------------------------------------------------------------------*/
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,553 @@
+/*------------------------------------------------------------------------------
+* ssr_archive.c : columnar archive of decoded corrections
+*
+* the decoded state (spartn_t ssr[], ssr_gad[], hpac_grid[] and vtec[]) is appended epoch by
+* epoch to one file per column. a row is written for each slot changed since
+* the previous epoch, and every SSRARCH_KEYFRAME epochs for all used slots, so
+* any epoch is rebuilt from the keyframe before it without decoding SPARTN.
+* the sap_ssr_t fields are split into the ocb and hpac tables as they are
+* updated by different messages.
+*
+* <base>.idx : "SPAX", version, number of columns, header size, time0 (gpst)
+*              {name[28], element size} per column
+*              ssrarch_epoch_t per epoch
+* <base>.<table>.slot     : uint8 slot index of each row
+* <base>.<table>.<column> : elements of each row
+*-----------------------------------------------------------------------------*/
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ssr_archive.h"
+
+#ifdef _WIN32
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#endif
+
+#define SSRARCH_VER     2
+#define SSRARCH_MAXCOL  12              /* max columns of a table, slot excluded */
+#define SSRARCH_NAMELEN 28              /* column name in the schema */
+
+#define COL(type, field) { #field, (int)offsetof(type, field), (int)sizeof(((type *)0)->field) }
+
+typedef struct {                        /* column */
+	const char *name;                   /* column name */
+	int off;                            /* offset in the slot */
+	int size;                           /* element size (bytes) */
+} ssrarch_col_t;
+
+typedef struct {                        /* table over the slots of spartn_t */
+	const char *name;                   /* table name */
+	int base;                           /* offset of the slots in spartn_t */
+	int recsize;                        /* size of a slot */
+	int nslot;                          /* number of slots */
+	int ncol;                           /* number of columns */
+	const ssrarch_col_t *col;           /* columns */
+} ssrarch_tbl_t;
+
+static const ssrarch_col_t ocb_col[] = {
+	COL(sap_ssr_t, prn), COL(sap_ssr_t, sys), COL(sap_ssr_t, sat), COL(sap_ssr_t, t0),
+	COL(sap_ssr_t, iod), COL(sap_ssr_t, ure), COL(sap_ssr_t, fix_flag), COL(sap_ssr_t, deph),
+	COL(sap_ssr_t, dclk), COL(sap_ssr_t, cbias), COL(sap_ssr_t, pbias), COL(sap_ssr_t, yaw_ang)
+};
+static const ssrarch_col_t hpac_col[] = {
+	COL(sap_ssr_t, areaId), COL(sap_ssr_t, ave_htd), COL(sap_ssr_t, tro_coef),
+	COL(sap_ssr_t, stec_coef), COL(sap_ssr_t, rap_num)
+};
+static const ssrarch_col_t gad_col[] = {
+	COL(gad_ssr_t, areaId), COL(gad_ssr_t, rap_lon), COL(gad_ssr_t, rap_lat), COL(gad_ssr_t, nc_lon),
+	COL(gad_ssr_t, nc_lat), COL(gad_ssr_t, spa_lon), COL(gad_ssr_t, spa_lat)
+};
+static const ssrarch_col_t grid_col[] = {
+	COL(hpac_grid_t, areaId), COL(hpac_grid_t, npt), COL(hpac_grid_t, nsat), COL(hpac_grid_t, tro_time),
+	COL(hpac_grid_t, tro), COL(hpac_grid_t, sat), COL(hpac_grid_t, time), COL(hpac_grid_t, ion)
+};
+static const ssrarch_col_t lpac_col[] = {
+	COL(vtec_t, time), COL(vtec_t, areaId), COL(vtec_t, rap_lon), COL(vtec_t, rap_lat),
+	COL(vtec_t, nc_lon), COL(vtec_t, nc_lat), COL(vtec_t, spa_lon), COL(vtec_t, spa_lat),
+	COL(vtec_t, avg_vtec), COL(vtec_t, residual)
+};
+
+#define NCOL(col) (int)(sizeof(col) / sizeof(col[0]))
+
+static const ssrarch_tbl_t arch_tbl[SSRARCH_NTBL] = {
+	{ "ocb",  (int)offsetof(spartn_t, ssr),     (int)sizeof(sap_ssr_t), SSR_NUM,  NCOL(ocb_col),  ocb_col  },
+	{ "hpac", (int)offsetof(spartn_t, ssr),     (int)sizeof(sap_ssr_t), SSR_NUM,  NCOL(hpac_col), hpac_col },
+	{ "gad",  (int)offsetof(spartn_t, ssr_gad), (int)sizeof(gad_ssr_t), RAP_NUM,  NCOL(gad_col),  gad_col  },
+	{ "grid", (int)offsetof(spartn_t, hpac_grid), (int)sizeof(hpac_grid_t), HPAC_MAX_ARAE, NCOL(grid_col), grid_col },
+	{ "lpac", (int)offsetof(spartn_t, vtec),    (int)sizeof(vtec_t),    AREA_NUM, NCOL(lpac_col), lpac_col }
+};
+
+struct ssrarch_s {
+	char base[1024];                    /* archive base path */
+	int append;                         /* 1: writing, 0: reading */
+	FILE *fidx;                         /* time index */
+	FILE *fcol[SSRARCH_NTBL][SSRARCH_MAXCOL + 1]; /* slot and columns */
+	uint32_t nrow[SSRARCH_NTBL];        /* rows per table */
+	int n, nmax;                        /* epochs */
+	ssrarch_epoch_t *epoch;             /* time index (reading) */
+	ssrarch_epoch_t last;               /* last epoch (writing) */
+	int nkey;                           /* epochs since the last keyframe */
+	double day;                         /* start of the day of the last epoch */
+	int napp;                           /* epochs appended since create */
+	int cur;                            /* epoch of the state last read, -1: none */
+	spartn_t *state;                    /* state last written */
+	uint8_t *buff;                      /* column read buffer */
+};
+
+/* number of columns and header size -----------------------------------------*/
+static int arch_ncol(void)
+{
+	int i, n = 0;
+	for (i = 0; i < SSRARCH_NTBL; i++) n += arch_tbl[i].ncol + 1;
+	return n;
+}
+static long arch_hsize(void)
+{
+	return 24 + (long)arch_ncol()*(SSRARCH_NAMELEN + 4);
+}
+/* schema entry of column j of table i (0: slot) -----------------------------*/
+static void arch_schema(int i, int j, char *name, uint32_t *size)
+{
+	memset(name, 0, SSRARCH_NAMELEN);
+	if (j == 0) {
+		snprintf(name, SSRARCH_NAMELEN, "%s.slot", arch_tbl[i].name);
+		*size = 1;
+	}
+	else {
+		snprintf(name, SSRARCH_NAMELEN, "%s.%s", arch_tbl[i].name, arch_tbl[i].col[j - 1].name);
+		*size = (uint32_t)arch_tbl[i].col[j - 1].size;
+	}
+}
+/* write/check index header --------------------------------------------------*/
+static int write_header(FILE *fp, double time0)
+{
+	char name[SSRARCH_NAMELEN];
+	uint32_t ver = SSRARCH_VER, ncol = (uint32_t)arch_ncol(), hsize = (uint32_t)arch_hsize(), size;
+	int i, j;
+
+	if (fwrite("SPAX", 4, 1, fp) < 1 || fwrite(&ver, 4, 1, fp) < 1 || fwrite(&ncol, 4, 1, fp) < 1 ||
+		fwrite(&hsize, 4, 1, fp) < 1 || fwrite(&time0, 8, 1, fp) < 1) return 0;
+	for (i = 0; i < SSRARCH_NTBL; i++) for (j = 0; j <= arch_tbl[i].ncol; j++) {
+		arch_schema(i, j, name, &size);
+		if (fwrite(name, SSRARCH_NAMELEN, 1, fp) < 1 || fwrite(&size, 4, 1, fp) < 1) return 0;
+	}
+	return 1;
+}
+static int check_header(FILE *fp)
+{
+	char magic[4], name[SSRARCH_NAMELEN], rname[SSRARCH_NAMELEN];
+	uint32_t ver, ncol, hsize, size, rsize;
+	double time0;
+	int i, j;
+
+	if (fread(magic, 4, 1, fp) < 1 || fread(&ver, 4, 1, fp) < 1 || fread(&ncol, 4, 1, fp) < 1 ||
+		fread(&hsize, 4, 1, fp) < 1 || fread(&time0, 8, 1, fp) < 1) return 0;
+	if (memcmp(magic, "SPAX", 4) || ver != SSRARCH_VER || ncol != (uint32_t)arch_ncol() ||
+		hsize != (uint32_t)arch_hsize()) return 0;
+	for (i = 0; i < SSRARCH_NTBL; i++) for (j = 0; j <= arch_tbl[i].ncol; j++) {
+		arch_schema(i, j, name, &size);
+		if (fread(rname, SSRARCH_NAMELEN, 1, fp) < 1 || fread(&rsize, 4, 1, fp) < 1) return 0;
+		if (memcmp(name, rname, SSRARCH_NAMELEN) || size != rsize) return 0;
+	}
+	return 1;
+}
+/* open the column files -----------------------------------------------------*/
+static int open_cols(ssrarch_t *arch, const char *mode)
+{
+	char path[1024];
+	int i, j;
+
+	for (i = 0; i < SSRARCH_NTBL; i++) for (j = 0; j <= arch_tbl[i].ncol; j++) {
+		if (ssrarch_colpath(arch->base, arch_tbl[i].name, j ? arch_tbl[i].col[j - 1].name : "slot",
+			path, sizeof(path)) < 0) return 0;
+		if (!(arch->fcol[i][j] = fopen(path, mode)) && !strcmp(mode, "r+b")) {
+			arch->fcol[i][j] = fopen(path, "w+b");
+		}
+		if (!arch->fcol[i][j]) return 0;
+	}
+	return 1;
+}
+/* seek the column files to the end of the last epoch ------------------------*/
+static int seek_cols(ssrarch_t *arch)
+{
+	int i, j;
+
+	for (i = 0; i < SSRARCH_NTBL; i++) for (j = 0; j <= arch_tbl[i].ncol; j++) {
+		if (fseek64(arch->fcol[i][j], (long long)arch->nrow[i] * (j ? arch_tbl[i].col[j - 1].size : 1),
+			SEEK_SET)) return 0;
+	}
+	return 1;
+}
+static ssrarch_t *arch_new(const char *base, int append)
+{
+	ssrarch_t *arch;
+
+	if (strlen(base) + 32 >= sizeof(arch->base)) return NULL;
+	if (!(arch = (ssrarch_t *)calloc(1, sizeof(ssrarch_t)))) return NULL;
+	strcpy(arch->base, base);
+	arch->append = append;
+	arch->cur = -1;
+	return arch;
+}
+/* create or continue an archive for writing ----------------------------------
+* args   : char   *base     I   archive base path
+*          gtime_t time0    I   time in the day of the first epoch (gpst)
+* return : archive (NULL: error)
+* notes  : an existing archive is continued (error if its schema differs),
+*          rows written after its last index entry are overwritten. the first
+*          epoch written is a keyframe. the epochs are placed in the day of
+*          time0 and must follow the last epoch of the archive, remove
+*          <base>.idx first to decode the same stream again.
+*-----------------------------------------------------------------------------*/
+extern ssrarch_t *ssrarch_create(const char *base, gtime_t time0)
+{
+	ssrarch_t *arch;
+	char path[1024];
+	long long size;
+	int i;
+
+	if (!(arch = arch_new(base, 1))) return NULL;
+	if (!(arch->state = (spartn_t *)calloc(1, sizeof(spartn_t)))) {
+		free(arch);
+		return NULL;
+	}
+	arch->day = (double)(time0.time - time0.time % 86400);
+	snprintf(path, sizeof(path), "%s.idx", base);
+
+	if ((arch->fidx = fopen(path, "r+b"))) {
+		if (!check_header(arch->fidx)) {
+			ssrarch_close(arch);
+			return NULL;
+		}
+		fseek64(arch->fidx, 0, SEEK_END);
+		size = ftell64(arch->fidx);
+		arch->n = (int)((size - arch_hsize()) / (long long)sizeof(ssrarch_epoch_t));
+		if (arch->n > 0) {
+			fseek64(arch->fidx, arch_hsize() + (long long)(arch->n - 1)*sizeof(ssrarch_epoch_t), SEEK_SET);
+			if (fread(&arch->last, sizeof(ssrarch_epoch_t), 1, arch->fidx) < 1) arch->n = 0;
+		}
+		if (arch->n > 0) {
+			for (i = 0; i < SSRARCH_NTBL; i++) arch->nrow[i] = arch->last.row[i] + arch->last.nrow[i];
+		}
+		fseek64(arch->fidx, arch_hsize() + (long long)arch->n*sizeof(ssrarch_epoch_t), SEEK_SET);
+	}
+	else {
+		if (!(arch->fidx = fopen(path, "w+b")) || !write_header(arch->fidx, arch->day)) {
+			ssrarch_close(arch);
+			return NULL;
+		}
+		arch->n = 0;
+	}
+	if (!open_cols(arch, arch->n > 0 ? "r+b" : "w+b") || !seek_cols(arch)) {
+		ssrarch_close(arch);
+		return NULL;
+	}
+	arch->nkey = SSRARCH_KEYFRAME;
+	return arch;
+}
+/* open an archive for reading -----------------------------------------------*/
+extern ssrarch_t *ssrarch_open(const char *base)
+{
+	ssrarch_t *arch;
+	ssrarch_epoch_t epoch;
+	char path[1024];
+	size_t size = 0;
+	int i, j;
+
+	if (!(arch = arch_new(base, 0))) return NULL;
+	snprintf(path, sizeof(path), "%s.idx", base);
+
+	if (!(arch->fidx = fopen(path, "rb")) || !check_header(arch->fidx) || !open_cols(arch, "rb")) {
+		ssrarch_close(arch);
+		return NULL;
+	}
+	while (fread(&epoch, sizeof(epoch), 1, arch->fidx) == 1) {
+		if (arch->n >= arch->nmax) {
+			ssrarch_epoch_t *p;
+			arch->nmax = arch->nmax <= 0 ? 1024 : arch->nmax * 2;
+			if (!(p = (ssrarch_epoch_t *)realloc(arch->epoch, sizeof(ssrarch_epoch_t)*arch->nmax))) {
+				ssrarch_close(arch);
+				return NULL;
+			}
+			arch->epoch = p;
+		}
+		arch->epoch[arch->n++] = epoch;
+	}
+	for (i = 0; i < SSRARCH_NTBL; i++) for (j = 0; j < arch_tbl[i].ncol; j++) {
+		if ((size_t)arch_tbl[i].nslot*arch_tbl[i].col[j].size > size) {
+			size = (size_t)arch_tbl[i].nslot*arch_tbl[i].col[j].size;
+		}
+	}
+	if (!(arch->buff = (uint8_t *)malloc(size))) {
+		ssrarch_close(arch);
+		return NULL;
+	}
+	return arch;
+}
+/* close archive -------------------------------------------------------------*/
+extern void ssrarch_close(ssrarch_t *arch)
+{
+	int i, j;
+
+	if (!arch) return;
+	for (i = 0; i < SSRARCH_NTBL; i++) for (j = 0; j <= SSRARCH_MAXCOL; j++) {
+		if (arch->fcol[i][j]) fclose(arch->fcol[i][j]);
+	}
+	if (arch->fidx) fclose(arch->fidx);
+	free(arch->epoch);
+	free(arch->state);
+	free(arch->buff);
+	free(arch);
+}
+/* slot used (area id 0 is valid, so any field set) / changed ---------------*/
+static int slot_used(const ssrarch_tbl_t *tbl, const uint8_t *rec)
+{
+	int i, j;
+	for (j = 0; j < tbl->ncol; j++) for (i = 0; i < tbl->col[j].size; i++) {
+		if (rec[tbl->col[j].off + i]) return 1;
+	}
+	return 0;
+}
+static int slot_changed(const ssrarch_tbl_t *tbl, const uint8_t *rec, const uint8_t *old)
+{
+	int j;
+	for (j = 0; j < tbl->ncol; j++) {
+		if (memcmp(rec + tbl->col[j].off, old + tbl->col[j].off, tbl->col[j].size)) return 1;
+	}
+	return 0;
+}
+/* append the decoded state as an epoch ---------------------------------------
+* args   : ssrarch_t *arch   IO  archive opened by ssrarch_create()
+*          spartn_t  *spartn I   decoded state, spartn->time the epoch time
+* return : rows written (-1: error)
+* notes  : the time of day is carried over to the next day when it goes back
+*          by more than half a day from the last epoch appended since
+*          ssrarch_create(). an epoch not after the last epoch of the archive
+*          is rejected.
+*-----------------------------------------------------------------------------*/
+extern int ssrarch_append(ssrarch_t *arch, const spartn_t *spartn)
+{
+	const ssrarch_tbl_t *tbl;
+	ssrarch_epoch_t epoch = { 0 };
+	const uint8_t *rec;
+	uint8_t *old, slot;
+	int i, j, k, key, nrow = 0;
+
+	if (!arch || !arch->append) return -1;
+
+	epoch.tod = spartn->time;
+	epoch.time = arch->day + spartn->time;
+	if (arch->napp > 0 && epoch.time < arch->last.time - 43200.0) {
+		arch->day += 86400.0;
+		epoch.time += 86400.0;
+	}
+	if (arch->n > 0 && epoch.time <= arch->last.time) return -1;
+	key = arch->nkey >= SSRARCH_KEYFRAME;
+	epoch.key = (uint8_t)key;
+	epoch.ssr_offset = spartn->ssr_offset;
+	epoch.is_height = spartn->is_height;
+
+	for (i = 0; i < SSRARCH_NTBL; i++) {
+		tbl = arch_tbl + i;
+		epoch.row[i] = arch->nrow[i];
+		for (k = 0; k < tbl->nslot; k++) {
+			rec = (const uint8_t *)spartn + tbl->base + (size_t)k*tbl->recsize;
+			old = (uint8_t *)arch->state + tbl->base + (size_t)k*tbl->recsize;
+			if (key ? !slot_used(tbl, rec) : !slot_changed(tbl, rec, old)) {
+				if (key) for (j = 0; j < tbl->ncol; j++) {
+					memcpy(old + tbl->col[j].off, rec + tbl->col[j].off, tbl->col[j].size);
+				}
+				continue;
+			}
+			slot = (uint8_t)k;
+			if (fwrite(&slot, 1, 1, arch->fcol[i][0]) < 1) return -1;
+			for (j = 0; j < tbl->ncol; j++) {
+				if (fwrite(rec + tbl->col[j].off, tbl->col[j].size, 1, arch->fcol[i][j + 1]) < 1) return -1;
+				memcpy(old + tbl->col[j].off, rec + tbl->col[j].off, tbl->col[j].size);
+			}
+			epoch.nrow[i]++;
+		}
+		arch->nrow[i] += epoch.nrow[i];
+		nrow += epoch.nrow[i];
+	}
+	/* the index entry goes last, rows without one are overwritten on reopen */
+	if (fwrite(&epoch, sizeof(epoch), 1, arch->fidx) < 1) return -1;
+	arch->last = epoch;
+	arch->nkey = key ? 1 : arch->nkey + 1;
+	arch->n++;
+	arch->napp++;
+	return nrow;
+}
+/* time index ----------------------------------------------------------------*/
+extern int ssrarch_nepoch(const ssrarch_t *arch)
+{
+	return arch ? arch->n : 0;
+}
+extern const ssrarch_epoch_t *ssrarch_epoch(const ssrarch_t *arch, int k)
+{
+	if (!arch || !arch->epoch || k < 0 || k >= arch->n) return NULL;
+	return arch->epoch + k;
+}
+/* last epoch at or before time (-1: none) -----------------------------------*/
+extern int ssrarch_find(const ssrarch_t *arch, gtime_t time)
+{
+	double t = (double)time.time + time.sec;
+	int lo = 0, hi, mid;
+
+	if (!arch || !arch->epoch || arch->n <= 0 || arch->epoch[0].time > t) return -1;
+	hi = arch->n - 1;
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		if (arch->epoch[mid].time <= t) lo = mid; else hi = mid - 1;
+	}
+	return lo;
+}
+/* apply the rows of an epoch ------------------------------------------------*/
+static int apply_epoch(ssrarch_t *arch, const ssrarch_epoch_t *epoch, spartn_t *spartn)
+{
+	const ssrarch_tbl_t *tbl;
+	uint8_t slot[256], *rec;
+	uint32_t n, r;
+	int i, j, k;
+
+	for (i = 0; i < SSRARCH_NTBL; i++) {
+		tbl = arch_tbl + i;
+		if (epoch->key) for (k = 0; k < tbl->nslot; k++) {
+			rec = (uint8_t *)spartn + tbl->base + (size_t)k*tbl->recsize;
+			for (j = 0; j < tbl->ncol; j++) memset(rec + tbl->col[j].off, 0, tbl->col[j].size);
+		}
+		if ((n = epoch->nrow[i]) == 0) continue;
+		if (n > (uint32_t)tbl->nslot) return 0;
+
+		if (fseek64(arch->fcol[i][0], (long long)epoch->row[i], SEEK_SET) ||
+			fread(slot, 1, n, arch->fcol[i][0]) < n) return 0;
+		for (r = 0; r < n; r++) if (slot[r] >= tbl->nslot) return 0;
+
+		for (j = 0; j < tbl->ncol; j++) {
+			if (fseek64(arch->fcol[i][j + 1], (long long)epoch->row[i] * tbl->col[j].size, SEEK_SET) ||
+				fread(arch->buff, tbl->col[j].size, n, arch->fcol[i][j + 1]) < n) return 0;
+			for (r = 0; r < n; r++) {
+				rec = (uint8_t *)spartn + tbl->base + (size_t)slot[r] * tbl->recsize;
+				memcpy(rec + tbl->col[j].off, arch->buff + (size_t)r*tbl->col[j].size, tbl->col[j].size);
+			}
+		}
+	}
+	return 1;
+}
+/* rebuild the decoded state of an epoch --------------------------------------
+* args   : ssrarch_t *arch   IO  archive opened by ssrarch_open()
+*          int        k      I   epoch index
+*          spartn_t  *spartn IO  decoded state
+* return : 1: ok, 0: error
+* notes  : the next epoch after the last one read is applied to spartn as it
+*          is, any other epoch is rebuilt from the keyframe before it.
+*-----------------------------------------------------------------------------*/
+extern int ssrarch_read(ssrarch_t *arch, int k, spartn_t *spartn)
+{
+	const ssrarch_epoch_t *epoch;
+	int j;
+
+	if (!arch || arch->append || k < 0 || k >= arch->n) return 0;
+	epoch = arch->epoch + k;
+
+	if (arch->cur >= 0 && k == arch->cur + 1) {
+		if (!apply_epoch(arch, epoch, spartn)) return 0;
+	}
+	else if (k != arch->cur) {
+		for (j = k; j > 0 && !arch->epoch[j].key; j--);
+		for (; j <= k; j++) {
+			if (!apply_epoch(arch, arch->epoch + j, spartn)) {
+				arch->cur = -1;
+				return 0;
+			}
+		}
+	}
+	arch->cur = k;
+	spartn->type = 0;
+	spartn->eos = 1;
+	spartn->time = epoch->tod;
+	spartn->ssr_offset = epoch->ssr_offset;
+	spartn->is_height = epoch->is_height;
+	return 1;
+}
+/* column file path (-1: path too long) --------------------------------------*/
+extern int ssrarch_colpath(const char *base, const char *table, const char *col, char *path, int size)
+{
+	int n = snprintf(path, size, "%s.%s.%s", base, table, col);
+	return n < 0 || n >= size ? -1 : n;
+}
+/* map a column read-only ------------------------------------------------------
+* args   : char   *base      I   archive base path
+*          char   *table     I   table name (ocb, hpac, gad, grid, lpac)
+*          char   *col       I   column name (slot or field name, e.g. dclk)
+*          ssrarch_map_t *map O  mapped column
+* return : elements of the column (NULL: error or empty)
+*-----------------------------------------------------------------------------*/
+extern void *ssrarch_map(const char *base, const char *table, const char *col, ssrarch_map_t *map)
+{
+	char path[1024];
+
+	memset(map, 0, sizeof(ssrarch_map_t));
+	if (ssrarch_colpath(base, table, col, path, sizeof(path)) < 0) return NULL;
+#ifdef _WIN32
+	{
+		LARGE_INTEGER size;
+		HANDLE file, fmap;
+		if ((file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)) == INVALID_HANDLE_VALUE) return NULL;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 ||
+			!(fmap = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL))) {
+			CloseHandle(file);
+			return NULL;
+		}
+		if (!(map->data = MapViewOfFile(fmap, FILE_MAP_READ, 0, 0, 0))) {
+			CloseHandle(fmap);
+			CloseHandle(file);
+			return NULL;
+		}
+		map->size = (size_t)size.QuadPart;
+		map->file = file;
+		map->map = fmap;
+	}
+#else
+	{
+		struct stat st;
+		void *data;
+		int fd;
+		if ((fd = open(path, O_RDONLY)) < 0) return NULL;
+		if (fstat(fd, &st) || st.st_size == 0 ||
+			(data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+			close(fd);
+			return NULL;
+		}
+		close(fd);
+		map->data = data;
+		map->size = (size_t)st.st_size;
+	}
+#endif
+	return map->data;
+}
+extern void ssrarch_unmap(ssrarch_map_t *map)
+{
+	if (!map->data) return;
+#ifdef _WIN32
+	UnmapViewOfFile(map->data);
+	CloseHandle((HANDLE)map->map);
+	CloseHandle((HANDLE)map->file);
+#else
+	munmap(map->data, map->size);
+#endif
+	memset(map, 0, sizeof(ssrarch_map_t));
+}
@@ -0,0 +1,62 @@
+#ifndef SSR_ARCHIVE_H
+#define SSR_ARCHIVE_H
+
+#include <stdio.h>
+#include "rtcm.h"
+#include "spartn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* columnar archive of decoded corrections ------------------------------------
+* one raw file per column, <base>.<table>.<column>, holding the fixed size
+* elements of the rows back to back (native byte order, no header), so that a
+* single column can be mapped and used as an array. the rows of a table are
+* the ssr[], ssr_gad[], hpac_grid[] or vtec[] slots of spartn_t that changed at an epoch,
+* every SSRARCH_KEYFRAME epochs all used slots are written again.
+* <base>.idx holds the column schema and one ssrarch_epoch_t per epoch.
+*-----------------------------------------------------------------------------*/
+#define SSRARCH_NTBL        5           /* tables: ocb, hpac, gad, grid, lpac */
+#define SSRARCH_KEYFRAME    720         /* epochs between full states */
+
+typedef struct {                        /* epoch of the time index */
+	double   time;                      /* epoch time (gpst, s since 1970) */
+	uint32_t tod;                       /* spartn time of day (s) */
+	uint8_t  key;                       /* 1: rows hold the full state */
+	uint8_t  ssr_offset;                /* spartn_t ssr_offset */
+	uint16_t is_height;                 /* spartn_t is_height */
+	uint32_t row[SSRARCH_NTBL];         /* first row of the epoch per table */
+	uint32_t nrow[SSRARCH_NTBL];        /* rows of the epoch per table */
+} ssrarch_epoch_t;
+
+typedef struct {                        /* mapped column */
+	void  *data;                        /* elements, NULL: not mapped */
+	size_t size;                        /* size of data (bytes) */
+#ifdef _WIN32
+	void  *file, *map;                  /* file and mapping handles */
+#endif
+} ssrarch_map_t;
+
+typedef struct ssrarch_s ssrarch_t;
+
+ssrarch_t *ssrarch_create(const char *base, gtime_t time0);
+ssrarch_t *ssrarch_open(const char *base);
+void ssrarch_close(ssrarch_t *arch);
+
+int ssrarch_append(ssrarch_t *arch, const spartn_t *spartn);
+
+int ssrarch_nepoch(const ssrarch_t *arch);
+const ssrarch_epoch_t *ssrarch_epoch(const ssrarch_t *arch, int k);
+int ssrarch_find(const ssrarch_t *arch, gtime_t time);
+int ssrarch_read(ssrarch_t *arch, int k, spartn_t *spartn);
+
+int ssrarch_colpath(const char *base, const char *table, const char *col, char *path, int size);
+void *ssrarch_map(const char *base, const char *table, const char *col, ssrarch_map_t *map);
+void ssrarch_unmap(ssrarch_map_t *map);
+
+/*--------------------------------------------------------------------*/
+#ifdef __cplusplus
+}
+#endif
+#endif
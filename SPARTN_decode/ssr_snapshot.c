@@ -0,0 +1,266 @@
+/*------------------------------------------------------------------------------
+* ssr_snapshot.c : snapshot of the decoded correction and ephemeris state
+*
+* written to <file>.tmp and renamed over <file> when complete, so a reader
+* never sees a partial snapshot. the sections of the state:
+*   SPHD : spartn_t header fields (ssrsnap_head_t)
+*   OCB  : used ssr[] slots      GAD  : used ssr_gad[] slots
+*   GRID : used hpac_grid[] slots
+*   LPAC : used vtec[] slots
+*   NAVH : nav_t counts (ssrsnap_navh_t)
+*   EPH  : eph[0..n-1]           GEPH : geph[0..ng-1]
+* other sections (e.g. those of sapcorda_ssr) are left to the caller.
+*-----------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ssr_snapshot.h"
+
+#define SSRSNAP_VER     2
+#define SSRSNAP_MAXREC  4096            /* max records of a section */
+
+typedef struct {                        /* spartn_t fields besides the slots */
+	uint32_t type, Subtype, len, time;
+	uint16_t is_height;
+	uint8_t  ssr_offset, eos;
+} ssrsnap_head_t;
+
+typedef struct {                        /* nav_t fields besides the ephemerides */
+	uint32_t n, ng, n_gps, n_gal, n_bds, n_qzs;
+	uint32_t ephsat;
+} ssrsnap_navh_t;
+
+/* create a snapshot -----------------------------------------------------------
+* args   : char   *file      I   snapshot file
+*          gtime_t time      I   time of the snapshot (gpst)
+* return : file to write the sections to, then ssrsnap_commit() (NULL: error)
+*-----------------------------------------------------------------------------*/
+extern FILE *ssrsnap_create(const char *file, gtime_t time)
+{
+	char path[1024];
+	uint32_t ver = SSRSNAP_VER, week = (uint32_t)get_week_number();
+	int64_t t = (int64_t)time.time;
+	FILE *fp;
+
+	if (strlen(file) + 5 > sizeof(path)) return NULL;
+	sprintf(path, "%s.tmp", file);
+	if (!(fp = fopen(path, "wb"))) return NULL;
+	if (fwrite("SPSS", 4, 1, fp) < 1 || fwrite(&ver, 4, 1, fp) < 1 || fwrite(&t, 8, 1, fp) < 1 ||
+		fwrite(&time.sec, 8, 1, fp) < 1 || fwrite(&week, 4, 1, fp) < 1) {
+		fclose(fp);
+		remove(path);
+		return NULL;
+	}
+	return fp;
+}
+/* close the snapshot and replace file with it (ok = 0: discard), 0: error --*/
+extern int ssrsnap_commit(FILE *fp, const char *file, int ok)
+{
+	char path[1024];
+
+	sprintf(path, "%s.tmp", file);
+	if (ferror(fp)) ok = 0;
+	if (fclose(fp)) ok = 0;
+	if (ok) {
+#ifdef _WIN32
+		remove(file);
+#endif
+		ok = !rename(path, file);
+	}
+	if (!ok) remove(path);
+	return ok;
+}
+/* open a snapshot -------------------------------------------------------------
+* args   : char   *file      I   snapshot file
+*          gtime_t now       I   current time (gpst)
+*          double  maxage    I   max age of the snapshot (s, 0: any)
+*          gtime_t *time     O   time of the snapshot (NULL: not output)
+* return : file positioned at the first section (NULL: none, not valid or
+*          older than maxage)
+* notes  : the gps week of the snapshot is set with set_week_number(), as
+*          the ephemerides decoded before the snapshot had set it.
+*-----------------------------------------------------------------------------*/
+extern FILE *ssrsnap_open(const char *file, gtime_t now, double maxage, gtime_t *time)
+{
+	char magic[4];
+	uint32_t ver, week;
+	int64_t t;
+	gtime_t ts = { 0 };
+	double age;
+	FILE *fp;
+
+	if (!(fp = fopen(file, "rb"))) return NULL;
+	if (fread(magic, 4, 1, fp) < 1 || fread(&ver, 4, 1, fp) < 1 || fread(&t, 8, 1, fp) < 1 ||
+		fread(&ts.sec, 8, 1, fp) < 1 || fread(&week, 4, 1, fp) < 1 ||
+		memcmp(magic, "SPSS", 4) || ver != SSRSNAP_VER) {
+		fclose(fp);
+		return NULL;
+	}
+	ts.time = (time_t)t;
+	age = timediff(now, ts);
+	if (maxage > 0.0 && (age > maxage || age < -maxage)) {
+		fclose(fp);
+		return NULL;
+	}
+	if (time) *time = ts;
+	set_week_number((int)week);
+	return fp;
+}
+/* write a section -------------------------------------------------------------
+* args   : FILE   *fp        I   snapshot
+*          char   *tag       I   section tag (4 characters)
+*          int    *key       I   record keys (NULL: index of the record, only
+*                                records with any nonzero byte are written)
+*          void   *rec       I   records
+*          int     size      I   record size (bytes)
+*          int     n         I   number of records
+* return : records written (-1: error)
+*-----------------------------------------------------------------------------*/
+static int rec_used(const uint8_t *rec, int size)
+{
+	int i;
+	for (i = 0; i < size; i++) if (rec[i]) return 1;
+	return 0;
+}
+extern int ssrsnap_write(FILE *fp, const char *tag, const int *key, const void *rec, int size, int n)
+{
+	const uint8_t *p = (const uint8_t *)rec;
+	uint32_t hdr[2];
+	int32_t k;
+	long pos, end;
+	int i, nw = 0;
+
+	pos = ftell(fp);
+	hdr[0] = (uint32_t)size;
+	hdr[1] = 0;
+	if (fwrite(tag, 4, 1, fp) < 1 || fwrite(hdr, 4, 2, fp) < 2) return -1;
+	for (i = 0; i < n; i++, p += size) {
+		if (!key && !rec_used(p, size)) continue;
+		k = key ? key[i] : i;
+		if (fwrite(&k, 4, 1, fp) < 1 || fwrite(p, size, 1, fp) < 1) return -1;
+		nw++;
+	}
+	/* number of records in the section header */
+	hdr[1] = (uint32_t)nw;
+	end = ftell(fp);
+	if (fseek(fp, pos + 8, SEEK_SET) || fwrite(hdr + 1, 4, 1, fp) < 1 || fseek(fp, end, SEEK_SET)) return -1;
+	return nw;
+}
+/* read a section header, 1: section, 0: end of snapshot, -1: error ----------*/
+extern int ssrsnap_section(FILE *fp, char *tag, int *size, int *n)
+{
+	uint32_t hdr[2];
+
+	if (fread(tag, 4, 1, fp) < 1) return feof(fp) ? 0 : -1;
+	if (fread(hdr, 4, 2, fp) < 2 || hdr[1] > SSRSNAP_MAXREC) return -1;
+	*size = (int)hdr[0];
+	*n = (int)hdr[1];
+	return 1;
+}
+/* read a record of the section, 0: error ------------------------------------*/
+extern int ssrsnap_record(FILE *fp, int size, int *key, void *rec)
+{
+	int32_t k;
+	if (fread(&k, 4, 1, fp) < 1 || fread(rec, size, 1, fp) < 1) return 0;
+	*key = k;
+	return 1;
+}
+/* skip the records of a section, 0: error -----------------------------------*/
+extern int ssrsnap_skip(FILE *fp, int size, int n)
+{
+	return !fseek(fp, (long)(size + 4) * n, SEEK_CUR);
+}
+/* write the decoded state -----------------------------------------------------
+* args   : FILE   *fp        I   snapshot
+*          spartn_t *spartn  I   decoded corrections
+*          nav_t  *nav       I   ephemerides
+* return : 1: ok, 0: error
+*-----------------------------------------------------------------------------*/
+extern int ssrsnap_write_state(FILE *fp, const spartn_t *spartn, const nav_t *nav)
+{
+	ssrsnap_head_t head = { 0 };
+	ssrsnap_navh_t navh = { 0 };
+	int key = 0;
+
+	head.type = spartn->type;
+	head.Subtype = spartn->Subtype;
+	head.len = spartn->len;
+	head.time = spartn->time;
+	head.is_height = spartn->is_height;
+	head.ssr_offset = spartn->ssr_offset;
+	head.eos = spartn->eos;
+	navh.n = nav->n;
+	navh.ng = nav->ng;
+	navh.n_gps = nav->n_gps;
+	navh.n_gal = nav->n_gal;
+	navh.n_bds = nav->n_bds;
+	navh.n_qzs = nav->n_qzs;
+	navh.ephsat = nav->ephsat;
+
+	return ssrsnap_write(fp, "SPHD", &key, &head, sizeof(head), 1) >= 0 &&
+		ssrsnap_write(fp, "OCB ", NULL, spartn->ssr, sizeof(sap_ssr_t), SSR_NUM) >= 0 &&
+		ssrsnap_write(fp, "GAD ", NULL, spartn->ssr_gad, sizeof(gad_ssr_t), RAP_NUM) >= 0 &&
+		ssrsnap_write(fp, "GRID", NULL, spartn->hpac_grid, sizeof(hpac_grid_t), HPAC_MAX_ARAE) >= 0 &&
+		ssrsnap_write(fp, "LPAC", NULL, spartn->vtec, sizeof(vtec_t), AREA_NUM) >= 0 &&
+		ssrsnap_write(fp, "NAVH", &key, &navh, sizeof(navh), 1) >= 0 &&
+		ssrsnap_write(fp, "EPH ", NULL, nav->eph, sizeof(eph_t), nav->n) >= 0 &&
+		ssrsnap_write(fp, "GEPH", NULL, nav->geph, sizeof(geph_t), nav->ng) >= 0;
+}
+/* read the records of a section into slots, 0: error ------------------------*/
+static int read_slots(FILE *fp, int size, int n, void *slot, int recsize, int nslot)
+{
+	int32_t key;
+	int i;
+
+	if (size != recsize) return 0;
+	for (i = 0; i < n; i++) {
+		if (fread(&key, 4, 1, fp) < 1 || key < 0 || key >= nslot) return 0;
+		if (fread((uint8_t *)slot + (size_t)recsize * key, recsize, 1, fp) < 1) return 0;
+	}
+	return 1;
+}
+/* read a section of the decoded state -----------------------------------------
+* args   : FILE   *fp        I   snapshot, after ssrsnap_section()
+*          char   *tag,size,n I  section header
+*          spartn_t *spartn  IO  decoded corrections (cleared by the caller)
+*          nav_t  *nav       IO  ephemerides (cleared by the caller)
+* return : 1: section read, 0: not a section of the state (not read),
+*          -1: error
+*-----------------------------------------------------------------------------*/
+extern int ssrsnap_read_state(FILE *fp, const char *tag, int size, int n, spartn_t *spartn, nav_t *nav)
+{
+	ssrsnap_head_t head;
+	ssrsnap_navh_t navh;
+	int key;
+
+	if (!memcmp(tag, "SPHD", 4)) {
+		if (size != sizeof(head) || n != 1 || !ssrsnap_record(fp, size, &key, &head)) return -1;
+		spartn->type = head.type;
+		spartn->Subtype = head.Subtype;
+		spartn->len = head.len;
+		spartn->time = head.time;
+		spartn->is_height = head.is_height;
+		spartn->ssr_offset = head.ssr_offset;
+		spartn->eos = head.eos;
+		return 1;
+	}
+	if (!memcmp(tag, "NAVH", 4)) {
+		if (size != sizeof(navh) || n != 1 || !ssrsnap_record(fp, size, &key, &navh) ||
+			navh.n > MAXEPH || navh.ng > MAXEPH_R) return -1;
+		nav->n = navh.n;
+		nav->ng = navh.ng;
+		nav->n_gps = navh.n_gps;
+		nav->n_gal = navh.n_gal;
+		nav->n_bds = navh.n_bds;
+		nav->n_qzs = navh.n_qzs;
+		nav->ephsat = (unsigned char)navh.ephsat;
+		return 1;
+	}
+	if (!memcmp(tag, "OCB ", 4)) return read_slots(fp, size, n, spartn->ssr, sizeof(sap_ssr_t), SSR_NUM) ? 1 : -1;
+	if (!memcmp(tag, "GAD ", 4)) return read_slots(fp, size, n, spartn->ssr_gad, sizeof(gad_ssr_t), RAP_NUM) ? 1 : -1;
+	if (!memcmp(tag, "GRID", 4)) return read_slots(fp, size, n, spartn->hpac_grid, sizeof(hpac_grid_t), HPAC_MAX_ARAE) ? 1 : -1;
+	if (!memcmp(tag, "LPAC", 4)) return read_slots(fp, size, n, spartn->vtec, sizeof(vtec_t), AREA_NUM) ? 1 : -1;
+	if (!memcmp(tag, "EPH ", 4)) return read_slots(fp, size, n, nav->eph, sizeof(eph_t), MAXEPH) ? 1 : -1;
+	if (!memcmp(tag, "GEPH", 4)) return read_slots(fp, size, n, nav->geph, sizeof(geph_t), MAXEPH_R) ? 1 : -1;
+	return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef SSR_SNAPSHOT_H
+#define SSR_SNAPSHOT_H
+
+#include <stdio.h>
+#include "rtcm.h"
+#include "spartn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* snapshot of the decoded correction and ephemeris state ---------------------
+* a header ("SPSS", version, snapshot time, gps week) and sections of fixed
+* size records, each record with an int32 key (slot or satellite number):
+*   char tag[4], uint32 record size, uint32 number of records, records
+* only the used slots of the spartn_t and nav_t arrays are written. a reader
+* rejects a section whose record size differs from its own structure.
+*-----------------------------------------------------------------------------*/
+#define SSRSNAP_MAXAGE      300.0       /* max age of a snapshot restored at startup (s) */
+#define SSRSNAP_INTERVAL    60.0        /* snapshot interval of the service (s) */
+
+FILE *ssrsnap_create(const char *file, gtime_t time);
+int ssrsnap_commit(FILE *fp, const char *file, int ok);
+FILE *ssrsnap_open(const char *file, gtime_t now, double maxage, gtime_t *time);
+
+int ssrsnap_write(FILE *fp, const char *tag, const int *key, const void *rec, int size, int n);
+int ssrsnap_section(FILE *fp, char *tag, int *size, int *n);
+int ssrsnap_record(FILE *fp, int size, int *key, void *rec);
+int ssrsnap_skip(FILE *fp, int size, int n);
+
+int ssrsnap_write_state(FILE *fp, const spartn_t *spartn, const nav_t *nav);
+int ssrsnap_read_state(FILE *fp, const char *tag, int size, int n, spartn_t *spartn, nav_t *nav);
+
+/*--------------------------------------------------------------------*/
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -21,8 +21,12 @@
 *           2015/06/11 1.1  fix bug on computing days in tide_oload() (#128)
 *           2017/04/11 1.2  fix bug on calling geterp() in timdedisp()
 *-----------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
 #include "tides.h"
+#ifndef OTL_NO_BUILTIN_GRID
 #include "OTL_GridData.h"
+#endif
 
 #define MJD_J2000   51544.5
 #define SQR(x)      ((x)*(x))
@@ -51,10 +55,11 @@
 #define mMax_lat        89
 #define mMin_lon        -180
 #define mMax_lon        180
-#define mNconst         11
-#define mNcomp          3
-#define mN_lat          (mMax_lat - mMin_lat) / mResolution + 1
-#define mN_lon          (mMax_lon - mMin_lon) / mResolution + 1
+#define mNconst         OTL_NCONST
+#define mNcomp          OTL_NCOMP
+#define mN_lat          ((mMax_lat - mMin_lat) / mResolution + 1)
+#define mN_lon          ((mMax_lon - mMin_lon) / mResolution + 1)
+#define mN_row          (mN_lon * mNconst * mNcomp * 2) /* grid values per latitude row */
 
 /* coordinate rotation matrix ------------------------------------------------*/
 #define Rx(t,X) do { \
@@ -352,13 +357,13 @@ extern int geterp(const erp_t *erp, gtime_t time, double *erpv)
 *                               (NULL: no output)
 * return : none
 * note   : see ref [3] chap 5
-*          not thread-safe
+*          the cache of the last epoch is kept per thread
 *-----------------------------------------------------------------------------*/
 void eci2ecef(gtime_t tutc, const double *erpv, double *U, double *gmst)
 {
     const double ep2000[] = { 2000,1,1,12,0,0 };
-    static gtime_t tutc_;
-    static double U_[9], gmst_;
+    static THREAD_LOCAL gtime_t tutc_;
+    static THREAD_LOCAL double U_[9], gmst_;
     gtime_t tgps;
     double eps, ze, th, z, t, t2, t3, dpsi, deps, gast, f[5];
     double R1[9], R2[9], R3[9], R[9], W[9], N[9], P[9], NP[9];
@@ -527,10 +532,185 @@ static void tide_pl(const double *eu, const double *rp, double GMp,
     trace(5,"tide_pl : dr=%.3f %.3f %.3f\n",dr[0],dr[1],dr[2]);
 }
 
+/* ocean tide loading grid -------------------------------------------------------
+* the grid is read from the builtin sGrid (OTL_GridData.h) or from a grid file
+* opened by otl_grid_open(). the file stores the values as int16 with a scale
+* per constituent/component/cos-sin, or as float, and latitude rows are read
+* on first use, so only the rows around the rovers are held in memory.
+* build with -DOTL_NO_BUILTIN_GRID to leave sGrid out of the binary, a grid
+* file must then be opened before the first site (see otl_grid_ready()).
+* the grid file is made from a build with sGrid by otl_grid_write().
+*
+* file format (little-endian):
+*   char   magic[4]    "OTLG"
+*   int32  type        OTL_GRID_INT16 or OTL_GRID_FLOAT
+*   int32  nlat,nlon,nconst,ncomp
+*   double phase[nconst][3]
+*   double scale[nconst][ncomp][2]
+*   rows   nlat rows of nlon*nconst*ncomp*2 values (int16 or float)
+*
+* rows are paged in by otl_site_init(), not thread-safe: otl_grid_preload()
+* reads all rows before otl_site_init() is called from several threads
+*-----------------------------------------------------------------------------*/
+typedef struct {        /* ocean tide loading grid file */
+    FILE *fp;           /* grid file */
+    int type;           /* storage type (OTL_GRID_???) */
+    double phase[mNconst][3]; /* constituent phase, frequency, acceleration */
+    double scale[mNconst * mNcomp * 2]; /* int16 scale by con/comp/cossin */
+    void *row[mN_lat];  /* latitude rows (NULL: not read) */
+} otl_grid_t;
+
+static otl_grid_t otl_grid = { 0 };
+
+extern int otl_grid_open(const char *file)
+{
+    char magic[4];
+    int head[5];
+
+    otl_grid_close();
+    if (!(otl_grid.fp = fopen(file, "rb"))) return 0;
+    if (fread(magic, 1, 4, otl_grid.fp) != 4 || memcmp(magic, "OTLG", 4) ||
+        fread(head, sizeof(int), 5, otl_grid.fp) != 5 ||
+        (head[0] != OTL_GRID_INT16 && head[0] != OTL_GRID_FLOAT) ||
+        head[1] != mN_lat || head[2] != mN_lon || head[3] != mNconst || head[4] != mNcomp ||
+        fread(otl_grid.phase, sizeof(double), mNconst * 3, otl_grid.fp) != mNconst * 3 ||
+        fread(otl_grid.scale, sizeof(double), mNconst * mNcomp * 2, otl_grid.fp) != mNconst * mNcomp * 2)
+    {
+        otl_grid_close();
+        return 0;
+    }
+    otl_grid.type = head[0];
+    return 1;
+}
+
+extern void otl_grid_close(void)
+{
+    int i;
+    if (otl_grid.fp) fclose(otl_grid.fp);
+    for (i = 0; i < mN_lat; i++) free(otl_grid.row[i]);
+    memset(&otl_grid, 0, sizeof(otl_grid));
+}
+
+static const void *otl_grid_row(int latidx)
+{
+    size_t size = otl_grid.type == OTL_GRID_INT16 ? sizeof(short) : sizeof(float);
+    long off = 4 + 5 * sizeof(int) + (mNconst * 3 + mNconst * mNcomp * 2) * sizeof(double);
+
+    if (latidx < 0 || latidx >= mN_lat) return NULL;
+    if (otl_grid.row[latidx]) return otl_grid.row[latidx];
+    if (!(otl_grid.row[latidx] = malloc(size * mN_row))) return NULL;
+    if (fseek(otl_grid.fp, off + (long)size * mN_row * latidx, SEEK_SET) ||
+        fread(otl_grid.row[latidx], size, mN_row, otl_grid.fp) != (size_t)mN_row)
+    {
+        free(otl_grid.row[latidx]);
+        otl_grid.row[latidx] = NULL;
+    }
+    return otl_grid.row[latidx];
+}
+
+/* grid values available (grid file or builtin grid), 0: no ocean loading ----*/
+extern int otl_grid_ready(void)
+{
+    if (otl_grid.fp) return 1;
+#ifndef OTL_NO_BUILTIN_GRID
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* read all rows of the grid file before sites are set from several threads,
+   0: read error or no grid --------------------------------------------------*/
+extern int otl_grid_preload(void)
+{
+    int i;
+    if (!otl_grid.fp) return otl_grid_ready();
+    for (i = 0; i < mN_lat; i++) if (!otl_grid_row(i)) return 0;
+    return 1;
+}
+
+/* grid value by index of the builtin grid layout ----------------------------*/
+static int otl_grid_value(int latidx, int idx, double *value)
+{
+    const void *row;
+
+    if (otl_grid.fp)
+    {
+        if (!(row = otl_grid_row(latidx))) return 0;
+        if (otl_grid.type == OTL_GRID_INT16) *value = ((const short *)row)[idx] * otl_grid.scale[idx % (mNconst * mNcomp * 2)];
+        else *value = ((const float *)row)[idx];
+        return 1;
+    }
+#ifndef OTL_NO_BUILTIN_GRID
+    if (latidx < 0 || latidx >= mN_lat) return 0;
+    *value = sGrid[latidx * mN_row + idx];
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+static const double *otl_grid_phase(int con)
+{
+    if (otl_grid.fp) return otl_grid.phase[con];
+#ifndef OTL_NO_BUILTIN_GRID
+    return mPhase[con];
+#else
+    return NULL;
+#endif
+}
+
+#ifndef OTL_NO_BUILTIN_GRID
+/* write the builtin grid to a grid file -------------------------------------*/
+extern int otl_grid_write(const char *file, int type)
+{
+    FILE *fp;
+    double phase[mNconst][3], scale[mNconst * mNcomp * 2] = { 0 }, v;
+    int head[5] = { 0, mN_lat, mN_lon, mNconst, mNcomp }, i, j, k;
+    short q;
+    float f;
+
+    if (type != OTL_GRID_INT16 && type != OTL_GRID_FLOAT) return 0;
+    if (!(fp = fopen(file, "wb"))) return 0;
+    head[0] = type;
+    for (i = 0; i < mNconst; i++) for (j = 0; j < 3; j++) phase[i][j] = mPhase[i][j];
+    for (i = 0; i < mN_lat * mN_row; i++)
+    {
+        k = i % (mNconst * mNcomp * 2);
+        if (fabs(sGrid[i]) / 32767.0 > scale[k]) scale[k] = fabs(sGrid[i]) / 32767.0;
+    }
+    fwrite("OTLG", 1, 4, fp);
+    fwrite(head, sizeof(int), 5, fp);
+    fwrite(phase, sizeof(double), mNconst * 3, fp);
+    fwrite(scale, sizeof(double), mNconst * mNcomp * 2, fp);
+    for (i = 0; i < mN_lat * mN_row; i++)
+    {
+        v = sGrid[i];
+        if (type == OTL_GRID_INT16)
+        {
+            k = i % (mNconst * mNcomp * 2);
+            q = (short)(scale[k] > 0.0 ? floor(v / scale[k] + 0.5) : 0);
+            fwrite(&q, sizeof(short), 1, fp);
+        }
+        else
+        {
+            f = (float)v;
+            fwrite(&f, sizeof(float), 1, fp);
+        }
+    }
+    i = ferror(fp);
+    fclose(fp);
+    return !i;
+}
+#endif
+
+int GetLatIdx(const double lat);
+int GetLonIdx(const double lon_given);
+
 //=============================================================================
 // Set Indexes of interpolation corners
 //-----------------------------------------------------------------------------
-int SetIndIntCorner(const double latitudeD,const double longitudeD)
+int SetIndIntCorner(otl_corner_t *corner, const double latitudeD,const double longitudeD)
 {
     //===================
     // Local declarations
@@ -553,26 +733,26 @@ int SetIndIntCorner(const double latitudeD,const double longitudeD)
     else if (lon <= mMin_lon) lon = mMin_lon + eps;
 
     // Latitude
-    mIntCorner[0].lat = (floor((lat - mMin_lat) / mResolution) + 1) * mResolution + mMin_lat;
-    mIntCorner[1].lat = mIntCorner[0].lat;
-    mIntCorner[2].lat = floor((lat - mMin_lat) / mResolution) * mResolution + mMin_lat;
-    mIntCorner[3].lat = mIntCorner[2].lat;
+    corner[0].lat = (floor((lat - mMin_lat) / mResolution) + 1) * mResolution + mMin_lat;
+    corner[1].lat = corner[0].lat;
+    corner[2].lat = floor((lat - mMin_lat) / mResolution) * mResolution + mMin_lat;
+    corner[3].lat = corner[2].lat;
 
-    mIntCorner[0].latidx = GetLatIdx(mIntCorner[0].lat);
-    mIntCorner[1].latidx = mIntCorner[0].latidx;
-    mIntCorner[2].latidx = mIntCorner[0].latidx - 1;
-    mIntCorner[3].latidx = mIntCorner[2].latidx;
+    corner[0].latidx = GetLatIdx(corner[0].lat);
+    corner[1].latidx = corner[0].latidx;
+    corner[2].latidx = corner[0].latidx - 1;
+    corner[3].latidx = corner[2].latidx;
 
     // Longitude
-    mIntCorner[1].lon = (floor((lon - mMin_lon) / mResolution) + 1) * mResolution + mMin_lon;
-    mIntCorner[3].lon = mIntCorner[1].lon;
-    mIntCorner[0].lon = floor((lon - mMin_lon) / mResolution) * mResolution + mMin_lon;
-    mIntCorner[2].lon = mIntCorner[0].lon;
+    corner[1].lon = (floor((lon - mMin_lon) / mResolution) + 1) * mResolution + mMin_lon;
+    corner[3].lon = corner[1].lon;
+    corner[0].lon = floor((lon - mMin_lon) / mResolution) * mResolution + mMin_lon;
+    corner[2].lon = corner[0].lon;
 
-    mIntCorner[1].lonidx = GetLonIdx(mIntCorner[1].lon);
-    mIntCorner[3].lonidx = mIntCorner[1].lonidx;
-    mIntCorner[0].lonidx = mIntCorner[3].lonidx - 1;
-    mIntCorner[2].lonidx = mIntCorner[0].lonidx;
+    corner[1].lonidx = GetLonIdx(corner[1].lon);
+    corner[3].lonidx = corner[1].lonidx;
+    corner[0].lonidx = corner[3].lonidx - 1;
+    corner[2].lonidx = corner[0].lonidx;
 
     return 1;
 }
@@ -621,7 +801,7 @@ int GetLonIdx(const double lon_given)
 //=============================================================================
 // Interpolate amplitudes for given position
 //-----------------------------------------------------------------------------
-int InterpolateAmplitudes(const double latitudeDegrees, const double longitudeDegrees)
+int InterpolateAmplitudes(otl_site_t *site, const double latitudeDegrees, const double longitudeDegrees)
 {
     double longitudeD = longitudeDegrees;
     double latitudeD  = latitudeDegrees;
@@ -636,7 +816,7 @@ int InterpolateAmplitudes(const double latitudeDegrees, const double longitudeDe
     //======================
 
     // Set corners and return 0 if not possible
-    if (!SetIndIntCorner(latitudeD, longitudeD))
+    if (!SetIndIntCorner(site->corner, latitudeD, longitudeD))
     {
         return 0;
     }
@@ -645,32 +825,84 @@ int InterpolateAmplitudes(const double latitudeDegrees, const double longitudeDe
     {
         for (int comp = 0; comp < mNcomp; comp++)
         {
-            mAmplitude[con][comp][0] = 0.0;
-            mAmplitude[con][comp][1] = 0.0;
+            site->amp[con][comp][0] = 0.0;
+            site->amp[con][comp][1] = 0.0;
             for (int node = 0; node < 4; node++)
             {
                 for (int cossin = 0; cossin < 2; cossin++)
                 {
-                    int iHardcodedGrid = cossin + (comp * 2) + (con * 2 * mNcomp) + (mIntCorner[node].lonidx * 2 * mNcomp * mNconst) + (mIntCorner[node].latidx * 2 * mNcomp * mNconst * mN_lon);
-                    mAmplitude[con][comp][cossin] += (1 - fabs(mIntCorner[node].lat - latitudeD) / mResolution) *
-                                                     (1 - fabs(mIntCorner[node].lon - longitudeD) / mResolution) * sGrid[iHardcodedGrid] / 2.0;
+                    // Index within the latitude row of the grid
+                    int iHardcodedGrid = cossin + (comp * 2) + (con * 2 * mNcomp) + (site->corner[node].lonidx * 2 * mNcomp * mNconst);
+                    double value;
+                    if (!otl_grid_value(site->corner[node].latidx, iHardcodedGrid, &value))
+                    {
+                        return 0;
+                    }
+                    site->amp[con][comp][cossin] += (1 - fabs(site->corner[node].lat - latitudeD) / mResolution) *
+                                                     (1 - fabs(site->corner[node].lon - longitudeD) / mResolution) * value / 2.0;
                 }
             }
         }
     }
+    for (int con = 0; con < mNconst; con++)
+    {
+        const double *phase = otl_grid_phase(con);
+        if (!phase)
+        {
+            return 0;
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            site->phase[con][i] = phase[i];
+        }
+    }
     return 1;
 }
 
 //=============================================================================
-// Get UEN Displacement for given time
+// Sum the constituents for given cos/sin of the phase arguments
 //-----------------------------------------------------------------------------
-int GetOtlDisplacement(gtime_t gpsTime, double *stationGeod, double *xyzDisplacement)
+static void SumOtlDisplacement(const otl_site_t *site, const double *cosPhase, const double *sinPhase, double *xyzDisplacement)
 {
-    double elapsedTimeSeconds;
     const int cosine = 0;
     const int sine = 1;
-    double uen[3];
-    double phaseArgument;
+    double uen[3] = { 0 };
+
+    //--------------------------------------------
+    // Perform the summation for every constituent
+    //--------------------------------------------
+    for (int con = 0; con < mNconst; con++)
+    {
+        for (int comp = 0; comp < mNcomp; comp++)
+        {
+            uen[comp] += (site->amp[con][comp][cosine] / 1000) * cosPhase[con]
+                      +  (site->amp[con][comp][sine]   / 1000) * sinPhase[con];
+        }
+    }
+
+    double enuDisplacement[3] = { 0 };
+    enuDisplacement[0] = uen[1];
+    enuDisplacement[1] = uen[2];
+    enuDisplacement[2] = uen[0];
+
+    enu2ecef(site->pos, enuDisplacement, xyzDisplacement);
+}
+
+//=============================================================================
+// Get phase argument of a constituent for elapsed time since 01Jan2000 12h
+//-----------------------------------------------------------------------------
+static double GetOtlPhaseArgument(const otl_site_t *site, int con, double elapsedTimeSeconds)
+{
+    return site->phase[con][0] + elapsedTimeSeconds * (site->phase[con][1] + 0.5 * elapsedTimeSeconds * site->phase[con][2]);
+}
+
+//=============================================================================
+// Get UEN Displacement for given time
+//-----------------------------------------------------------------------------
+int GetOtlDisplacement(const otl_site_t *site, gtime_t gpsTime, double *xyzDisplacement)
+{
+    double elapsedTimeSeconds;
+    double phaseArgument, cosPhase[mNconst], sinPhase[mNconst];
     //========================================
     // Set the reference time to 01Jan2000 12h
     const double ep2000[] = { 2000,1,1,12,0,0 };
@@ -688,49 +920,95 @@ int GetOtlDisplacement(gtime_t gpsTime, double *stationGeod, double *xyzDisplace
     //       Ampl_sin_up * sin {mPhase + freq*(t-t0) + 1/2*accel*(t-t0)**2}
     // (for details see http://gemini.gsfc.nasa.gov/solve_root/help/harpos_format.txt)
     //--------------------------------------------------------------------------------
-
-    //------------------------------
-    // Set the displacements to zero
-    //------------------------------
-    memset(xyzDisplacement, 0, 3* sizeof(double));
-    for (int i = 0; i < 3; i++)
-    {
-        uen[i] = 0;
-    }
-
-    //--------------------------------------------
-    // Perform the summation for every constituent
-    //--------------------------------------------
     for (int con = 0; con < mNconst; con++)
     {
         // Compute the mPhase argument
-        phaseArgument = mPhase[con][0] + elapsedTimeSeconds * (mPhase[con][1] + 0.5 * elapsedTimeSeconds * mPhase[con][2]);
+        phaseArgument = GetOtlPhaseArgument(site, con, elapsedTimeSeconds);
+        cosPhase[con] = cos(phaseArgument);
+        sinPhase[con] = sin(phaseArgument);
+    }
+    SumOtlDisplacement(site, cosPhase, sinPhase, xyzDisplacement);
 
-        // Compute displacements
-        for (int comp = 0; comp < mNcomp; comp++)
+    return 1;
+}
+
+/* stepping ocean tide loading evaluator ----------------------------------------
+* for a rover evaluated at a fixed step the phase arguments advance by an
+* almost constant angle, so cos/sin are rotated by the step angle with the
+* angle-addition formulas instead of being recomputed. the phases are
+* recomputed directly every OTL_RESYNC steps, on a change of step and on a
+* time jump, which bounds the rounding drift and the drift of the step angle
+* by the acceleration term. the largest difference to the direct form seen at
+* a periodic resync is kept in step->err
+*-----------------------------------------------------------------------------*/
+static void otl_step_sync(const otl_site_t *site, otl_step_t *step, gtime_t time, double dt, int check)
+{
+    const double ep2000[] = { 2000,1,1,12,0,0 };
+    double t = timediff(time, epoch2time(ep2000)), ph, c, s;
+    int con;
+
+    for (con = 0; con < mNconst; con++)
+    {
+        ph = GetOtlPhaseArgument(site, con, t);
+        c = cos(ph);
+        s = sin(ph);
+        if (check)
         {
-            uen[comp] += (mAmplitude[con][comp][cosine] / 1000) * cos(phaseArgument)
-                      +  (mAmplitude[con][comp][sine]   / 1000) * sin(phaseArgument);
+            if (fabs(c - step->c[con]) > step->err) step->err = fabs(c - step->c[con]);
+            if (fabs(s - step->s[con]) > step->err) step->err = fabs(s - step->s[con]);
         }
+        step->c[con] = c;
+        step->s[con] = s;
+        ph = GetOtlPhaseArgument(site, con, t + dt) - ph;
+        step->cd[con] = cos(ph);
+        step->sd[con] = sin(ph);
     }
+    step->time = time;
+    step->dt = dt;
+    step->nstep = 0;
+}
 
-    double enuDisplacement[3] = { 0 };
-    enuDisplacement[0] = uen[1];
-    enuDisplacement[1] = uen[2];
-    enuDisplacement[2] = uen[0];
-
-    enu2ecef(stationGeod, enuDisplacement, xyzDisplacement);
+extern int otl_step_disp(const otl_site_t *site, otl_step_t *step, gtime_t gpsTime, double *xyzDisplacement)
+{
+    double dt, c;
+    int con;
 
+    if (!site->stat)
+    {
+        memset(xyzDisplacement, 0, 3 * sizeof(double));
+        return 0;
+    }
+    dt = step->time.time ? timediff(gpsTime, step->time) : 0.0;
+    if (step->time.time && dt > 0.0 && fabs(dt - step->dt) < 1E-6)
+    {
+        for (con = 0; con < mNconst; con++)
+        {
+            c = step->c[con] * step->cd[con] - step->s[con] * step->sd[con];
+            step->s[con] = step->s[con] * step->cd[con] + step->c[con] * step->sd[con];
+            step->c[con] = c;
+        }
+        step->time = gpsTime;
+        if (++step->nstep >= OTL_RESYNC) otl_step_sync(site, step, gpsTime, dt, 1);
+    }
+    else
+    {
+        otl_step_sync(site, step, gpsTime, dt > 0.0 ? dt : step->dt, 0);
+    }
+    SumOtlDisplacement(site, step->c, step->s, xyzDisplacement);
     return 1;
 }
 
-
-int tide_oload_trm(gtime_t gpsTime,const double *stationXYZ, double *xyzDisplacement)
+/* ocean tide loading site -----------------------------------------------------
+* interpolate the grid amplitudes for a station once, the site is then
+* evaluated without shared state by GetOtlDisplacement()
+*-----------------------------------------------------------------------------*/
+extern int otl_site_init(otl_site_t *site, const double *stationXYZ)
 {
     double stationGeod[3];
     //==============================================================
     // Compute the geodetic coordinates (decimal degrees and meters)
     ecef2pos(stationXYZ, stationGeod);
+    memcpy(site->pos, stationGeod, 3 * sizeof(double));
 
     stationGeod[0] = stationGeod[0] * R2D;
     stationGeod[1] = stationGeod[1] * R2D;
@@ -740,16 +1018,25 @@ int tide_oload_trm(gtime_t gpsTime,const double *stationXYZ, double *xyzDisplace
     }
     //=======================
     // Interpolate amplitudes
-    if (!InterpolateAmplitudes(stationGeod[0], stationGeod[1], 0))
+    site->stat = InterpolateAmplitudes(site, stationGeod[0], stationGeod[1]);
+    return site->stat;
+}
+
+extern int otl_site_disp(const otl_site_t *site, gtime_t gpsTime, double *xyzDisplacement)
+{
+    if (!site->stat)
     {
+        memset(xyzDisplacement, 0, 3 * sizeof(double));
         return 0;
     }
+    return GetOtlDisplacement(site, gpsTime, xyzDisplacement);
+}
 
-    stationGeod[0] = stationGeod[0] * D2R;
-    stationGeod[1] = stationGeod[1] * D2R;
-    GetOtlDisplacement(gpsTime, stationGeod, xyzDisplacement);
-
-    return 1;
+int tide_oload_trm(gtime_t gpsTime,const double *stationXYZ, double *xyzDisplacement)
+{
+    otl_site_t site;
+    otl_site_init(&site, stationXYZ);
+    return otl_site_disp(&site, gpsTime, xyzDisplacement);
 }
 
 /* displacement by solid earth tide (ref [2] 7) ------------------------------*/
@@ -1137,12 +1424,14 @@ void ComputeFrequencyDependantCorrections(const double JulianDate,const double S
     }
 }
 
-extern void ComputeSolidEarthTideDisplacement(gtime_t tutc, const double *rr, double *dr)
+// Compute Sun and Moon CTS positions and the Julian date (TDT)
+////////////////////////////////////////////////////////////////////////////
+static void ComputeSunMoonCtsPosition(gtime_t tutc, double *JulianDate, double *SunPos, double *MoonPos)
 {
     const double ep2000[] = { 2000,1,1,12,0,0 };
 
     // Compute the Julian date in Terrestrial Dynamical Time (TDT)
-    double JulianDateTDT = timediff(tutc, epoch2time(ep2000)) / 86400.0 + mJ2000;
+    const double JulianDateTDT = timediff(tutc, epoch2time(ep2000)) / 86400.0 + mJ2000;
 
     // Compute centuries since J2000 (TDT)
     const double dT = timediff(tutc, epoch2time(ep2000)) / 86400.0 / 36525.0; //(JulianDateTDT - mJ2000) / 36525.0;
@@ -1180,7 +1469,6 @@ extern void ComputeSolidEarthTideDisplacement(gtime_t tutc, const double *rr, do
     // Compute the Sun's CTS position
     const double SinGAST = sin(GASTrad);
     const double CosGAST = cos(GASTrad);
-    double SunPos[3];
     SunPos[0] =  CosGAST * APSPos[0] + SinGAST * APSPos[1];
     SunPos[1] = -SinGAST * APSPos[0] + CosGAST * APSPos[1],
     SunPos[2] = APSPos[2];
@@ -1189,11 +1477,57 @@ extern void ComputeSolidEarthTideDisplacement(gtime_t tutc, const double *rr, do
     ComputeMoonApparentPlace(dT, Obliquity, Nutation, APSPos);
 
     // Compute the Moon's CTS position
-    double MoonPos[3];
     MoonPos[0] =  CosGAST * APSPos[0] + SinGAST * APSPos[1];
     MoonPos[1] = -SinGAST * APSPos[0] + CosGAST * APSPos[1],
     MoonPos[2] = APSPos[2];
 
+    *JulianDate = JulianDateTDT;
+}
+
+/* astronomical context of an epoch --------------------------------------------
+* sun/moon positions, eci to ecef matrix and sun direction depend only on time,
+* so they are computed once per epoch by astro_init() into a context owned by
+* the caller and shared by all rovers of that epoch (see tide_cache_disp())
+*-----------------------------------------------------------------------------*/
+extern void astro_init(astro_t *astro, gtime_t tutc, const double *erpv)
+{
+    double rs[3], rm[3];
+    int i;
+
+    astro->tutc = tutc;
+    for (i = 0; i < 5; i++) astro->erpv[i] = erpv ? erpv[i] : 0.0;
+
+    /* sun and moon position in ecef */
+    sunmoonpos_eci(timeadd(tutc, astro->erpv[2]), rs, rm);
+    eci2ecef(tutc, astro->erpv, astro->U, &astro->gmst);
+    matmul("NN", 3, 1, 3, 1.0, astro->U, rs, 0.0, astro->rsun);
+    matmul("NN", 3, 1, 3, 1.0, astro->U, rm, 0.0, astro->rmoon);
+    if (!normv3(astro->rsun, astro->esun)) astro->esun[0] = astro->esun[1] = astro->esun[2] = 0.0;
+
+    /* apparent places for ComputeSolidEarthTideDisplacement */
+    ComputeSunMoonCtsPosition(tutc, &astro->jd_tdt, astro->rsun_cts, astro->rmoon_cts);
+}
+
+/* context of the epoch, reinitialized only when the time differs from its own */
+extern void astro_update(astro_t *astro, gtime_t tutc)
+{
+    if (astro->tutc.time == 0 || fabs(timediff(tutc, astro->tutc)) >= 1E-3) astro_init(astro, tutc, NULL);
+}
+
+extern void ComputeSolidEarthTideDisplacement(gtime_t tutc, const double *rr, double *dr)
+{
+    astro_t astro;
+
+    astro_init(&astro, tutc, NULL);
+    ComputeSolidEarthTideDisplacementEx(&astro, rr, dr);
+}
+
+extern void ComputeSolidEarthTideDisplacementEx(const astro_t *astro, const double *rr, double *dr)
+{
+    const double JulianDateTDT = astro->jd_tdt;
+    const double *SunPos = astro->rsun_cts;
+    const double *MoonPos = astro->rmoon_cts;
+
     // Compute the length of the station vector
     const double VectorLength = norm(rr,3);
     const double SinPhi = rr[2]/ VectorLength;
@@ -1281,17 +1615,18 @@ extern void ComputeSolidEarthTideDisplacement(gtime_t tutc, const double *rr, do
 
 extern void tidedisp(gtime_t tutc, const double *rr, int opt,const double *odisp, double *dr)
 {
-    gtime_t tut;
-    double pos[2],E[9],drt[3],denu[3],rs[3],rm[3],gmst,erpv[5]={0};
+    astro_t astro;
+
+    astro_init(&astro, tutc, NULL);
+    tidedisp_astro(&astro, rr, opt, odisp, dr);
+}
+
+extern void tidedisp_astro(const astro_t *astro, const double *rr, int opt, const double *odisp, double *dr)
+{
+    double pos[2],E[9],drt[3];
     int i;
-#ifdef IERS_MODEL
-    double ep[6],fhr;
-    int year,mon,day;
-#endif
     
-    trace(3,"tidedisp: tutc=%s\n",time_str(tutc,0));
-    
-    tut=timeadd(tutc,erpv[2]);
+    trace(3,"tidedisp: tutc=%s\n",time_str(astro->tutc,0));
     
     dr[0]=dr[1]=dr[2]=0.0;
     
@@ -1302,13 +1637,140 @@ extern void tidedisp(gtime_t tutc, const double *rr, int opt,const double *odisp
     xyz2enu(pos,E);
     
     if (opt&1) { /* solid earth tides */
-        /* sun and moon position in ecef */
-        sunmoonpos(tutc,erpv,rs,rm,&gmst);
-        tide_solid(rs,rm,pos,E,gmst,opt,drt);
+        tide_solid(astro->rsun,astro->rmoon,pos,E,astro->gmst,opt,drt);
         for (i=0;i<3;i++) dr[i]+=drt[i];
     }
 }
 
+/* tide displacement cache -----------------------------------------------------
+* solid earth tide and ocean loading change by less than a millimetre over
+* mMinTimeChange and mMinPosChange, so they are computed once per rover and
+* reused while the rover stays within mMinPosChange. with interpolation the
+* displacements are computed at both ends of a mMinTimeChange interval and
+* interpolated linearly inside it, otherwise the last values are held.
+* intervals are aligned to mMinTimeChange so that ocean loading is evaluated
+* at a regular step by the stepping evaluator. the rovers are hashed by their
+* mMinPosChange cell into TIDE_NCACHE slots, a rover takes the least recently
+* used of the TIDE_NPROBE slots from the slot of its cell, so many rovers
+* share the cache without evicting each other every epoch.
+* the astronomical context of the interval ends is kept here, as all rovers
+* evaluate the same ends. the context of the caller is owned by the epoch
+* loop and passed to every rover, it is used for the epoch time itself
+* without interpolation and reinitialized only when that time differs from
+* its own.
+*-----------------------------------------------------------------------------*/
+static THREAD_LOCAL tide_cache_t tide_cache[TIDE_NCACHE];  /* per thread */
+static THREAD_LOCAL astro_t tide_astro[2];  /* contexts of the interval ends */
+static int tide_interp = 1;
+
+static double tide_cache_dist(const double *r1, const double *r2)
+{
+    return sqrt(SQR(r1[0] - r2[0]) + SQR(r1[1] - r2[1]) + SQR(r1[2] - r2[2]));
+}
+
+/* first slot of the mMinPosChange cell of a rover (fnv-1a) */
+static int tide_cache_slot(const double *rr)
+{
+    unsigned int h = 2166136261u;
+    int i;
+    for (i = 0; i < 3; i++) {
+        h = (h ^ (unsigned int)(int)floor(rr[i] / mMinPosChange)) * 16777619u;
+    }
+    return (int)(h & (TIDE_NCACHE - 1));
+}
+
+/* context of an interval end, the older one is reinitialized */
+static astro_t *tide_end_astro(gtime_t time)
+{
+    int i;
+    for (i = 0; i < 2; i++) {
+        if (tide_astro[i].tutc.time && fabs(timediff(time, tide_astro[i].tutc)) < 1E-3) return tide_astro + i;
+    }
+    i = timediff(tide_astro[0].tutc, tide_astro[1].tutc) < 0.0 ? 0 : 1;
+    astro_init(tide_astro + i, time, NULL);
+    return tide_astro + i;
+}
+
+static void tide_cache_eval(tide_cache_t *cache, astro_t *astro, gtime_t time, const double *rr, double *dsol, double *dotl)
+{
+    if (cache->interp) astro = tide_end_astro(time);
+    else astro_update(astro, time);
+    tidedisp_astro(astro, rr, 1, NULL, dsol);
+    otl_step_disp(&cache->otl, &cache->step, time, dotl);
+}
+
+extern void tide_cache_opt(int interp)
+{
+    tide_interp = interp;
+    memset(tide_cache, 0, sizeof(tide_cache));
+    memset(tide_astro, 0, sizeof(tide_astro));
+}
+
+extern tide_cache_t *tide_cache_find(const double *rr)
+{
+    int i, k, s = tide_cache_slot(rr), j = s;
+    for (i = 0; i < TIDE_NPROBE; i++) {
+        k = (s + i) & (TIDE_NCACHE - 1);
+        if (tide_cache[k].time.time == 0) {
+            j = k;
+            break;
+        }
+        if (tide_cache_dist(tide_cache[k].rr, rr) < mMinPosChange) return tide_cache + k;
+        if (tide_cache[k].tused.time < tide_cache[j].tused.time) j = k;
+    }
+    memset(tide_cache + j, 0, sizeof(tide_cache_t));
+    tide_cache[j].interp = tide_interp;
+    return tide_cache + j;
+}
+
+extern int tide_cache_disp(tide_cache_t *cache, astro_t *astro, gtime_t time, const double *rr, double *dsol, double *dotl)
+{
+    gtime_t t0 = time;
+    double dt, a = 0.0;
+    int i;
+
+    cache->tused = time;
+    if (cache->time.time == 0 || tide_cache_dist(cache->rr, rr) >= mMinPosChange) {
+        memcpy(cache->rr, rr, 3 * sizeof(double));
+        otl_site_init(&cache->otl, rr);
+        memset(&cache->step, 0, sizeof(otl_step_t));
+        cache->time.time = 0;
+    }
+    if (cache->interp) {
+        /* interval on mMinTimeChange boundaries, the end of the last
+           interval is the start of the next one */
+        t0.time -= t0.time % (time_t)mMinTimeChange;
+        t0.sec = 0.0;
+        dt = timediff(t0, cache->time);
+        if (cache->time.time != 0 && fabs(dt - mMinTimeChange) < 1E-9) {
+            for (i = 0; i < 3; i++) {
+                cache->dsol[i] = cache->dsol[i + 3];
+                cache->dotl[i] = cache->dotl[i + 3];
+            }
+            cache->time = t0;
+            tide_cache_eval(cache, astro, timeadd(t0, mMinTimeChange), rr, cache->dsol + 3, cache->dotl + 3);
+        }
+        else if (cache->time.time == 0 || fabs(dt) > 1E-9) {
+            cache->time = t0;
+            tide_cache_eval(cache, astro, t0, rr, cache->dsol, cache->dotl);
+            tide_cache_eval(cache, astro, timeadd(t0, mMinTimeChange), rr, cache->dsol + 3, cache->dotl + 3);
+        }
+        a = timediff(time, t0) / mMinTimeChange;
+    }
+    else {
+        dt = timediff(time, cache->time);
+        if (cache->time.time == 0 || dt < 0.0 || dt > mMinTimeChange) {
+            cache->time = time;
+            tide_cache_eval(cache, astro, time, rr, cache->dsol, cache->dotl);
+        }
+    }
+    for (i = 0; i < 3; i++) {
+        dsol[i] = cache->dsol[i] + a * (cache->dsol[i + 3] - cache->dsol[i]);
+        dotl[i] = cache->dotl[i] + a * (cache->dotl[i + 3] - cache->dotl[i]);
+    }
+    return cache->otl.stat;
+}
+
 /* nominal yaw-angle ---------------------------------------------------------*/
 static double yaw_nominal(double beta, double mu)
 {
@@ -1323,16 +1785,15 @@ extern int yaw_angle(int sat, const char *type, int opt, double beta, double mu,
     return 1;
 }
 
-/* satellite attitude model --------------------------------------------------*/
-static int sat_yaw(gtime_t time, int sat, const char *type, int opt,
+/* satellite attitude model, sun position from the epoch context -------------*/
+static int sat_yaw(const astro_t *astro, int sat, const char *type, int opt,
     const double *rs, double *exs, double *eys)
 {
-    double rsun[3], ri[6], es[3], esun[3], n[3], p[3], en[3], ep[3], ex[3], E, beta, mu;
-    double yaw, cosy, siny, erpv[5] = { 0 };
+    const double *rsun = astro->rsun;
+    double ri[6], es[3], esun[3], n[3], p[3], en[3], ep[3], ex[3], E, beta, mu;
+    double yaw, cosy, siny;
     int i;
 
-    sunmoonpos(gpst2utc(time), erpv, rsun, NULL, NULL);
-
     /* beta and orbit angle */
     matcpy(ri, rs, 6, 1);
     ri[3] -= OMGE * ri[1];
@@ -1363,7 +1824,7 @@ static int sat_yaw(gtime_t time, int sat, const char *type, int opt,
 }
 
 /* phase windup model --------------------------------------------------------*/
-extern int model_phw(gtime_t time, int sat, const char *type, int opt,
+extern int model_phw(const astro_t *astro, int sat, const char *type, int opt,
     const double *rs, const double *rr, double *phw)
 {
     double exs[3], eys[3], ek[3], exr[3], eyr[3], eks[3], ekr[3], E[9];
@@ -1373,7 +1834,7 @@ extern int model_phw(gtime_t time, int sat, const char *type, int opt,
     if (opt <= 0) return 1; /* no phase windup */
 
     /* satellite yaw attitude model */
-    if (!sat_yaw(time, sat, type, opt, rs, exs, eys)) return 0;
+    if (!sat_yaw(astro, sat, type, opt, rs, exs, eys)) return 0;
 
     /* unit vector satellite to receiver */
     for (i = 0; i < 3; i++) r[i] = rr[i] - rs[i];
@@ -1413,11 +1874,11 @@ extern int model_phw(gtime_t time, int sat, const char *type, int opt,
 }
 
 /* phase windup model --------------------------------------------------------*/
-extern int model_phw_bnc(gtime_t time, int sat, const char *type, int opt,
+extern int model_phw_bnc(const astro_t *astro, int sat, const char *type, int opt,
     const double *rs, const double *rr, double *phw)
 {
     double exs[3], eys[3], sz[3],xsun[3], sx[3], sy[3], exr[3], eyr[3], eks[3], ekr[3], E[9];
-    double dr[3], ds[3], drs[3], r[3], pos[3], cosp, ph, erpv[5] = { 0.0 }, rsun[3];
+    double dr[3], ds[3], drs[3], r[3], pos[3], cosp, ph;
     double neu[3], rx[3], ry[3];
     int i;
 
@@ -1427,8 +1888,7 @@ extern int model_phw_bnc(gtime_t time, int sat, const char *type, int opt,
 
     for (i = 0; i < 3; i++) sz[i] = - sz[i];
 
-    sunmoonpos(gpst2utc(time), erpv, rsun, NULL, NULL);
-    if (!normv3(rsun, xsun)) return 0;
+    if (!normv3(astro->rsun, xsun)) return 0;
 
     cross3(sz, xsun, sy);
     cross3(sy, sz, sx);
@@ -1473,7 +1933,7 @@ extern int model_phw_bnc(gtime_t time, int sat, const char *type, int opt,
 }
 
 
-/* phase windup model --------------------------------------------------------*/
+/* phase windup model, satellite axes from the velocity (no sun position) ----*/
 extern int model_phw_sap(gtime_t time, int sat, const double *dSatPrecOrbitEcef_m, const double *dSatVelocity_mps, const double *rr, double *phw)
 {
     double dr[3], ds[3], drs[3], r[3], dRcvrPosLLH[3];
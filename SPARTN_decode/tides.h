@@ -12,19 +12,103 @@ extern "C" {
 #include "gnss_math.h"
 #include "model.h"
 
+#define OTL_NCONST      11              /* number of ocean tide constituents */
+#define OTL_NCOMP       3               /* number of displacement components (u,e,n) */
+#define OTL_GRID_INT16  0               /* otl grid file storage: int16 with scale */
+#define OTL_GRID_FLOAT  1               /* otl grid file storage: float */
+#define OTL_RESYNC      120             /* otl stepping steps between direct evaluations */
+#define TIDE_NCACHE     256             /* number of cached rover positions (power of 2) */
+#define TIDE_NPROBE     8               /* cache slots probed from the slot of a rover cell */
+
+typedef struct {        /* astronomical context of an epoch */
+    gtime_t tutc;       /* time (utc) */
+    double erpv[5];     /* erp values {xp,yp,ut1_utc,lod} (rad,rad,s,s/d) */
+    double U[9];        /* eci to ecef transformation matrix */
+    double gmst;        /* gmst (rad) */
+    double rsun[3];     /* sun position in ecef (m) */
+    double rmoon[3];    /* moon position in ecef (m) */
+    double esun[3];     /* sun direction in ecef (unit vector) */
+    double jd_tdt;      /* julian date (tdt) */
+    double rsun_cts[3]; /* sun apparent place in cts (m) */
+    double rmoon_cts[3];/* moon apparent place in cts (m) */
+} astro_t;
+
+typedef struct {        /* ocean tide loading grid interpolation corner */
+    double lat, lon;    /* corner latitude/longitude (deg) */
+    int latidx, lonidx; /* corner grid index */
+} otl_corner_t;
+
+typedef struct {        /* ocean tide loading site */
+    double pos[3];      /* site geodetic position {lat,lon,h} (rad,m) */
+    otl_corner_t corner[4]; /* interpolation corners */
+    double amp[OTL_NCONST][OTL_NCOMP][2]; /* interpolated amplitudes {cos,sin} (mm) */
+    double phase[OTL_NCONST][3]; /* constituent phase, frequency, acceleration */
+    int stat;           /* status (0:outside grid,1:ok) */
+} otl_site_t;
+
+typedef struct {        /* ocean tide loading stepping evaluator */
+    gtime_t time;       /* time of the current phases */
+    double dt;          /* step (s) */
+    double c[OTL_NCONST], s[OTL_NCONST]; /* cos/sin of the phase arguments */
+    double cd[OTL_NCONST], sd[OTL_NCONST]; /* cos/sin of the phase step */
+    int nstep;          /* steps since last direct evaluation */
+    double err;         /* max difference to direct form at resync */
+} otl_step_t;
+
+typedef struct {        /* tide displacement cache of a rover */
+    gtime_t time;       /* time of the cached displacements (interval start) */
+    gtime_t tused;      /* time of last use */
+    double rr[3];       /* rover position (ecef) (m) */
+    double dsol[6];     /* solid earth tide at time and time+mMinTimeChange (ecef) (m) */
+    double dotl[6];     /* ocean loading at time and time+mMinTimeChange (ecef) (m) */
+    int interp;         /* interpolate in time (0:hold,1:linear) */
+    otl_site_t otl;     /* ocean loading site at rr */
+    otl_step_t step;    /* ocean loading stepping evaluator */
+} tide_cache_t;
+
 /* phase windup model --------------------------------------------------------*/
-extern int model_phw(gtime_t time, int sat, const char *type, int opt, const double *rs, const double *rr, double *phw);
+extern int model_phw(const astro_t *astro, int sat, const char *type, int opt, const double *rs, const double *rr, double *phw);
 
-extern int model_phw_bnc(gtime_t time, int sat, const char *type, int opt, const double *rs, const double *rr, double *phw);
+extern int model_phw_bnc(const astro_t *astro, int sat, const char *type, int opt, const double *rs, const double *rr, double *phw);
 
 extern int model_phw_sap(gtime_t time, int sat, const double *dSatPrecOrbitEcef_m, const double *dSatVelocity_mps, const double *rr, double *phw);
 
 extern void tidedisp(gtime_t tutc, const double *rr, int opt, const double *odisp, double *dr);
 
+extern void tidedisp_astro(const astro_t *astro, const double *rr, int opt, const double *odisp, double *dr);
+
+extern int otl_grid_open(const char *file);
+
+extern void otl_grid_close(void);
+
+extern int otl_grid_preload(void);
+
+extern int otl_grid_ready(void);
+
+extern int otl_grid_write(const char *file, int type);
+
+extern int otl_site_init(otl_site_t *site, const double *stationXYZ);
+
+extern int otl_site_disp(const otl_site_t *site, gtime_t gpsTime, double *xyzDisplacement);
+
+extern int otl_step_disp(const otl_site_t *site, otl_step_t *step, gtime_t gpsTime, double *xyzDisplacement);
+
 extern int tide_oload_trm(gtime_t gpsTime, const double *stationXYZ, double *uenDisplacement);
 
+extern void tide_cache_opt(int interp);
+
+extern tide_cache_t *tide_cache_find(const double *rr);
+
+extern int tide_cache_disp(tide_cache_t *cache, astro_t *astro, gtime_t time, const double *rr, double *dsol, double *dotl);
+
 extern void ComputeSolidEarthTideDisplacement(gtime_t tutc, const double *rr, double *dr);
 
+extern void ComputeSolidEarthTideDisplacementEx(const astro_t *astro, const double *rr, double *dr);
+
+extern void astro_init(astro_t *astro, gtime_t tutc, const double *erpv);
+
+extern void astro_update(astro_t *astro, gtime_t tutc);
+
 #ifdef __cplusplus
 }
 #endif
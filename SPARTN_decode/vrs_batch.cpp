@@ -0,0 +1,297 @@
+/*------------------------------------------------------------------------------
+* vrs_batch.cpp : vrs of many stations or of time chunks from one decoded
+*                 timeline
+*
+* pass 1 decodes the correction and ephemeris streams as gga_ssr2osr_main()
+* does, appends each correction state to <ssrfile>.batch (ssr_archive.h) and
+* keeps a copy of nav_t whenever the ephemerides change. pass 2 runs one
+* worker per core, each taking the next station and replaying the timeline
+* with its own archive reader, so the stations share the decoding and only
+* the station dependent part (geometry, tides, atmosphere) runs per station.
+* gen_vrs_epoch() only reads nav and the correction state, the caches of the
+* models below it are kept per thread. the correction logs may still have
+* records queued to the asynchronous log writer when a station is done, they
+* are closed once all workers have finished.
+* a single station is run in time chunks instead: the timeline is the
+* checkpoint at every epoch (correction state read back from the archive,
+* ephemeris set and vrs time before the epoch), each chunk is generated to
+* temporary files next to the outputs which are then concatenated in order.
+*-----------------------------------------------------------------------------*/
+#include "vrs_batch.h"
+#include "GenVRSObs.h"
+#include "ssr_archive.h"
+#include "tides.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+typedef struct {
+	std::vector<nav_t> nav;			/* ephemeris sets in the order they appeared */
+	std::vector<int> inav;			/* ephemeris set of each archive epoch */
+	std::vector<gtime_t> teph;		/* vrs time before each archive epoch */
+	std::string base;				/* archive of the correction states */
+	gtime_t time0;					/* start of the vrs time */
+} vrs_timeline_t;
+
+/* ephemerides changed since the last set */
+static int nav_changed(const nav_t* last, const nav_t* nav)
+{
+	return last->n != nav->n || last->ng != nav->ng ||
+		memcmp(last->eph, nav->eph, sizeof(eph_t) * nav->n) ||
+		memcmp(last->geph, nav->geph, sizeof(geph_t) * nav->ng);
+}
+
+/* pass 1: decode the streams into the timeline, 0: error */
+static int decode_timeline(FILE* fSSR, FILE* fEPH, double* ep, vrs_timeline_t* tl)
+{
+	gnss_rtcm_t* rtcm = new gnss_rtcm_t();
+	raw_spartn_t* raw = new raw_spartn_t();
+	spartn_t* spartn = new spartn_t();
+	nav_t* nav = &rtcm->nav;
+	ssrarch_t* arch;
+	gtime_t teph = tl->time0;
+	int i, ret_nav, epfEPH = 0, ok = 1;
+
+	set_approximate_time((int)ep[0], time2doy(tl->time0), rtcm->rcv);
+
+	remove((tl->base + ".idx").c_str());	/* a fresh archive, not continued */
+	if (!(arch = ssrarch_create(tl->base.c_str(), tl->time0))) {
+		delete rtcm; delete raw; delete spartn;
+		return 0;
+	}
+	while (1) {
+		nav->ns = 0;
+		memset(nav->nsys, 0, sizeof(nav->nsys));
+		fread_ssr_sapcorda(fSSR, raw, spartn, nav->nsys);
+		for (i = 0; i < NSYSSSR; i++) nav->ns += nav->nsys[i];
+		if (feof(fSSR)) break;
+		if (ssrarch_append(arch, spartn) < 0) {
+			ok = 0;
+			break;
+		}
+		while (1) {
+			ret_nav = fread_eph_rtcm(fEPH, rtcm, nav->nsys);
+			if (ret_nav != 2 && feof(fEPH)) {
+				epfEPH = 1;
+				break;
+			}
+			if (match_ssr_nav_iode(spartn->ssr, nav)) break;
+		}
+		if (epfEPH) break;
+
+		if (tl->nav.empty() || nav_changed(&tl->nav.back(), nav)) tl->nav.push_back(*nav);
+		tl->inav.push_back((int)tl->nav.size() - 1);
+		tl->teph.push_back(teph);
+		vrs_epoch_time(&teph, spartn->ssr);
+	}
+	ssrarch_close(arch);
+	delete rtcm; delete raw; delete spartn;
+	return ok;
+}
+
+/* satellites with corrections of a state, the nav->ns of the decoder */
+static int ssr_count(const spartn_t* spartn)
+{
+	uint32_t nsys[NSYSSSR];
+	return ssr_count_sys(spartn->ssr, nsys);
+}
+
+/* decode the streams into a timeline, 0: error */
+static int open_timeline(const char* ssrfile, const char* ephfile, double* ep, vrs_timeline_t* tl)
+{
+	FILE* fSSR, * fEPH;
+	int ok;
+
+	if (!(fSSR = fopen(ssrfile, "rb"))) return 0;
+	if (!(fEPH = fopen(ephfile, "rb"))) {
+		fclose(fSSR);
+		return 0;
+	}
+	tl->base = std::string(ssrfile) + ".batch";
+	tl->time0 = epoch2time(ep);
+	ok = decode_timeline(fSSR, fEPH, ep, tl);
+	fclose(fSSR);
+	fclose(fEPH);
+	return ok && otl_grid_preload();
+}
+
+/* worker threads, at most the number of tasks */
+static int thread_count(int nthread, int ntask)
+{
+	if (nthread <= 0) nthread = (int)std::thread::hardware_concurrency();
+	if (nthread > ntask) nthread = ntask;
+	return nthread < 1 ? 1 : nthread;
+}
+
+/* pass 2: vrs of the stations taken from next */
+static void station_worker(const vrs_timeline_t* tl, const vrs_station_t* sta, int nsta, FILE** fLOG, std::atomic<int>* next)
+{
+	spartn_t* spartn = new spartn_t();
+	rtcm_t* rtcm = new rtcm_t();
+	ssrarch_t* arch = ssrarch_open(tl->base.c_str());
+	astro_t astro = {};
+	double pos[3];
+	gtime_t teph;
+	int i, k;
+
+	while (arch && (i = next->fetch_add(1)) < nsta) {
+		FILE* fRTCM = fopen(sta[i].rtcm, "wb");
+		if (!fRTCM) continue;
+		fLOG[i] = fopen(sta[i].log, "wb");
+		memcpy(pos, sta[i].pos, sizeof(pos));
+		teph = tl->time0;
+		for (k = 0; k < (int)tl->inav.size() && ssrarch_read(arch, k, spartn); k++) {
+			gen_vrs_epoch(&teph, pos, &astro, rtcm, (nav_t*)&tl->nav[tl->inav[k]], spartn, ssr_count(spartn), fRTCM, fLOG[i]);
+		}
+		fclose(fRTCM);
+	}
+	ssrarch_close(arch);
+	delete rtcm;
+	delete spartn;
+}
+
+/* vrs of a batch of stations --------------------------------------------------
+* args   : char   *ssrfile   I   spartn corrections
+*          char   *ephfile   I   rtcm broadcast ephemerides
+*          double *ep        I   start time {y,m,d,h,m,s} (gpst)
+*          vrs_station_t *sta I  stations
+*          int     nsta      I   number of stations
+*          int     nthread   I   worker threads (0: number of cores)
+* return : number of epochs decoded (-1: error, also without an otl grid)
+* notes  : the output of each station is the one of gga_ssr2osr_main() for
+*          that station. the archive <ssrfile>.batch.* is left on disk and
+*          replaced by the next batch on the same file.
+*-----------------------------------------------------------------------------*/
+extern "C" int vrs_batch(const char* ssrfile, const char* ephfile, double* ep, const vrs_station_t* sta, int nsta, int nthread)
+{
+	vrs_timeline_t tl;
+	std::vector<std::thread> worker;
+	std::vector<FILE*> fLOG(nsta > 0 ? nsta : 1, (FILE*)NULL);
+	std::atomic<int> next(0);
+	int i;
+
+	if (!open_timeline(ssrfile, ephfile, ep, &tl)) return -1;
+	nthread = thread_count(nthread, nsta);
+
+	for (i = 0; i < nthread; i++) {
+		worker.push_back(std::thread(station_worker, &tl, sta, nsta, &fLOG[0], &next));
+	}
+	for (i = 0; i < nthread; i++) worker[i].join();
+	log_async_drain();
+	for (i = 0; i < nsta; i++) if (fLOG[i]) fclose(fLOG[i]);
+	return (int)tl.inav.size();
+}
+
+typedef struct {
+	int k0, k1;						/* archive epochs [k0, k1) */
+	std::string rtcm, log;			/* temporary outputs */
+	FILE* fLOG;
+	int ok;
+} vrs_chunk_t;
+
+/* vrs of the chunks taken from next */
+static void chunk_worker(const vrs_timeline_t* tl, const double* rovpos, vrs_chunk_t* chunk, int nchunk, std::atomic<int>* next)
+{
+	spartn_t* spartn = new spartn_t();
+	rtcm_t* rtcm = new rtcm_t();
+	ssrarch_t* arch = ssrarch_open(tl->base.c_str());
+	astro_t astro = {};
+	double pos[3];
+	gtime_t teph;
+	int i, k;
+
+	memcpy(pos, rovpos, sizeof(pos));
+	while (arch && (i = next->fetch_add(1)) < nchunk) {
+		FILE* fRTCM = fopen(chunk[i].rtcm.c_str(), "wb");
+		if (!fRTCM) continue;
+		chunk[i].fLOG = fopen(chunk[i].log.c_str(), "wb");
+		teph = tl->teph[chunk[i].k0];
+		for (k = chunk[i].k0; k < chunk[i].k1 && ssrarch_read(arch, k, spartn); k++) {
+			gen_vrs_epoch(&teph, pos, &astro, rtcm, (nav_t*)&tl->nav[tl->inav[k]], spartn, ssr_count(spartn), fRTCM, chunk[i].fLOG);
+		}
+		chunk[i].ok = k == chunk[i].k1;
+		fclose(fRTCM);
+	}
+	ssrarch_close(arch);
+	delete rtcm;
+	delete spartn;
+}
+
+/* append a file to out and remove it, 0: error */
+static int append_file(FILE* out, const char* path)
+{
+	char buff[65536];
+	size_t n;
+	int ok = 1;
+	FILE* fp;
+
+	if (!(fp = fopen(path, "rb"))) return 0;
+	while ((n = fread(buff, 1, sizeof(buff), fp)) > 0) {
+		if (out && fwrite(buff, 1, n, out) != n) ok = 0;
+	}
+	fclose(fp);
+	remove(path);
+	return ok;
+}
+
+/* vrs of one station in time chunks -------------------------------------------
+* args   : char   *ssrfile   I   spartn corrections
+*          char   *ephfile   I   rtcm broadcast ephemerides
+*          double *ep        I   start time {y,m,d,h,m,s} (gpst)
+*          double *rovpos    I   station position (ecef, m)
+*          char   *rtcmfile  I   rtcm output file
+*          char   *logfile   I   correction log file (NULL: none)
+*          int     nchunk    I   time chunks (0: one per thread)
+*          int     nthread   I   worker threads (0: number of cores)
+* return : number of epochs decoded (-1: error, also without an otl grid)
+* notes  : the outputs are the ones of gga_ssr2osr_main() for the station.
+*          chunk i is written to <rtcmfile>.<i> and <logfile>.<i> first.
+*-----------------------------------------------------------------------------*/
+extern "C" int vrs_chunked(const char* ssrfile, const char* ephfile, double* ep, const double* rovpos, const char* rtcmfile, const char* logfile, int nchunk, int nthread)
+{
+	vrs_timeline_t tl;
+	std::vector<vrs_chunk_t> chunk;
+	std::vector<std::thread> worker;
+	std::atomic<int> next(0);
+	FILE* fRTCM, * fLOG;
+	int i, n, ok = 1;
+	char ext[16];
+
+	if (!open_timeline(ssrfile, ephfile, ep, &tl)) return -1;
+	n = (int)tl.inav.size();
+	if (nchunk <= 0) nchunk = thread_count(nthread, n);
+	if (nchunk > n) nchunk = n;
+	nthread = thread_count(nthread, nchunk);
+
+	chunk.resize(nchunk);
+	for (i = 0; i < nchunk; i++) {
+		sprintf(ext, ".%d", i);
+		chunk[i].k0 = (int)((long long)n * i / nchunk);
+		chunk[i].k1 = (int)((long long)n * (i + 1) / nchunk);
+		chunk[i].rtcm = std::string(rtcmfile) + ext;
+		chunk[i].log = logfile ? std::string(logfile) + ext : std::string();
+		chunk[i].fLOG = NULL;
+		chunk[i].ok = 0;
+	}
+	for (i = 0; i < nthread; i++) {
+		worker.push_back(std::thread(chunk_worker, &tl, rovpos, chunk.data(), nchunk, &next));
+	}
+	for (i = 0; i < nthread; i++) worker[i].join();
+	log_async_drain();
+	for (i = 0; i < nchunk; i++) if (chunk[i].fLOG) fclose(chunk[i].fLOG);
+
+	fRTCM = fopen(rtcmfile, "wb");
+	fLOG = logfile ? fopen(logfile, "wb") : NULL;
+	for (i = 0; i < nchunk; i++) {
+		if (!chunk[i].ok) ok = 0;
+		if (!append_file(fRTCM, chunk[i].rtcm.c_str())) ok = 0;
+		if (logfile) append_file(fLOG, chunk[i].log.c_str());
+	}
+	if (fRTCM) fclose(fRTCM);
+	if (fLOG) fclose(fLOG);
+	return fRTCM && ok ? n : -1;
+}
@@ -0,0 +1,26 @@
+#ifndef VRS_BATCH_H
+#define VRS_BATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* vrs of many stations from one correction and ephemeris stream --------------
+* the streams are decoded once: the correction states go to an archive (see
+* ssr_archive.h) and the ephemerides matching each epoch are kept in memory,
+* then worker threads replay that timeline for one station at a time, or
+* for one time chunk of a single station.
+*-----------------------------------------------------------------------------*/
+typedef struct {                        /* station of a batch */
+	char rtcm[255];                     /* rtcm output file */
+	char log[255];                      /* correction log file */
+	double pos[3];                      /* station position (ecef, m) */
+} vrs_station_t;
+
+int vrs_batch(const char *ssrfile, const char *ephfile, double *ep, const vrs_station_t *sta, int nsta, int nthread);
+int vrs_chunked(const char *ssrfile, const char *ephfile, double *ep, const double *rovpos, const char *rtcmfile, const char *logfile, int nchunk, int nthread);
+
+#ifdef __cplusplus
+}
+#endif
+#endif